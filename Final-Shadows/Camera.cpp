@@ -156,9 +156,11 @@ void Camera::Update(float dt)
 		int cursorMovementX = input.GetMouseXDelta();
 		int cursorMovementY = input.GetMouseYDelta();
 
-		float pitch = transform.GetRotationPitchYawRoll().x;
-		float yaw = transform.GetRotationPitchYawRoll().y;
-		float roll = transform.GetRotationPitchYawRoll().z;
+		// Read once and set once; SetRotation() keeps these angles, so next frame's read is free
+		XMFLOAT3 pitchYawRoll = transform.GetRotationPitchYawRoll();
+		float pitch = pitchYawRoll.x;
+		float yaw = pitchYawRoll.y;
+		float roll = pitchYawRoll.z;
 
 		if (cursorMovementY > 0)
 		{
@@ -169,8 +171,6 @@ void Camera::Update(float dt)
 			{
 				pitch = Deg2Rad(89.9f);
 			}
-
-			transform.SetRotation(pitch, yaw, roll);
 		}
 		else if (cursorMovementY < 0)
 		{
@@ -181,20 +181,15 @@ void Camera::Update(float dt)
 			{
 				pitch = Deg2Rad(-89.9f);
 			}
-
-			transform.SetRotation(pitch, yaw, roll);
 		}
 
-		if (cursorMovementX > 0)
+		if (cursorMovementX != 0)
 		{
 			yaw += mouseSpeed * dt * (float)cursorMovementX;
-
-			transform.SetRotation(pitch, yaw, roll);
 		}
-		else if (cursorMovementX < 0)
-		{
-			yaw += mouseSpeed * dt * (float)cursorMovementX;
 
+		if (cursorMovementX != 0 || cursorMovementY != 0)
+		{
 			transform.SetRotation(pitch, yaw, roll);
 		}
 	}
@@ -0,0 +1,3 @@
+// ShadowMapVertexShader.hlsl for meshes uploaded as CompactVertex data
+#define COMPACT_VERTEX
+#include "ShadowMapVertexShader.hlsl"
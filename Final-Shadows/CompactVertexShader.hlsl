@@ -0,0 +1,3 @@
+// VertexShader.hlsl for meshes uploaded as CompactVertex data
+#define COMPACT_VERTEX
+#include "VertexShader.hlsl"
@@ -1,5 +1,7 @@
 #include "DXCore.h"
 #include "Input.h"
+#include "GeometryPool.h"
+#include "TransformSystem.h"
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui/imgui_impl_win32.h"
@@ -80,6 +82,12 @@ DXCore::~DXCore()
 
 	// Delete input manager singleton
 	delete& Input::GetInstance();
+
+	// Delete the shared geometry buffers (every Mesh is gone by now)
+	delete& GeometryPool::GetInstance();
+
+	// Delete the transform storage (every entity is gone by now)
+	delete& TransformSystem::GetInstance();
 }
 
 // --------------------------------------------------------
@@ -283,6 +291,9 @@ HRESULT DXCore::InitDirect3D()
 	viewport.MaxDepth	= 1.0f;
 	context->RSSetViewports(1, &viewport);
 
+	// Every Mesh puts its geometry into the pool's shared buffers
+	GeometryPool::GetInstance().Initialize(device, context);
+
 	// Return the "everything is ok" HRESULT value
 	return S_OK;
 }
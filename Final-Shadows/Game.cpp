@@ -1,6 +1,9 @@
 #include "Game.h"
 #include "Vertex.h"
+#include "VertexFormat.h"
 #include "Input.h"
+#include "GeometryPool.h"
+#include "TransformSystem.h"
 #include "Helpers.h"
 #include "ImGuiMenus.h"
 #include "Material.h"
@@ -27,7 +30,11 @@ Game::Game(HINSTANCE hInstance)
 		1280,				// Width of the window's client area
 		720,				// Height of the window's client area
 		false,				// Sync the framerate to the monitor refresh? (lock framerate)
-		true)				// Show extra stats (fps) in title bar?
+		true),				// Show extra stats (fps) in title bar?
+	cameraMeshletStats(),
+	shadowMeshletStats(),
+	firstFrameMilliseconds(0.0),
+	meshesLoadedMilliseconds(0.0)
 {
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -60,6 +67,8 @@ Game::~Game()
 // --------------------------------------------------------
 void Game::Init()
 {
+	initStartTime = std::chrono::high_resolution_clock::now();
+
 	// Helper methods for each init task
 	LoadShaders();
 	CreateGeometry();
@@ -110,8 +119,8 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = std::make_shared<SimpleVertexShader>(device, context,
-		FixPath(L"VertexShader.cso").c_str());
+	// Vertex shaders get their input layouts from the VertexFormat of the vertices they read
+	vertexShader = LoadVertexShader<Vertex>(device, context, FixPath(L"VertexShader.cso"));
 
 	pixelShader = std::make_shared<SimplePixelShader>(device, context,
 		FixPath(L"PixelShader.cso").c_str());
@@ -119,8 +128,15 @@ void Game::LoadShaders()
 	animatedPixelShader = std::make_shared<SimplePixelShader>(device, context,
 		FixPath(L"AnimatedPixelShader.cso").c_str());
 
-	shadowMapVertexShader = std::make_shared<SimpleVertexShader>(device, context,
-		FixPath(L"ShadowMapVertexShader.cso").c_str());
+	shadowMapVertexShader = LoadVertexShader<PositionVertex>(device, context, FixPath(L"ShadowMapVertexShader.cso"));
+
+	compactVertexShader = LoadVertexShader<CompactVertex>(device, context, FixPath(L"CompactVertexShader.cso"));
+	compactShadowMapVertexShader = LoadVertexShader<CompactPositionVertex>(device, context, FixPath(L"CompactShadowMapVertexShader.cso"));
+
+	// A shader without its layout would draw garbage, so close instead (the reason was already logged)
+	// - Nothing before the first frame uses the shaders, and the close message is handled before it
+	if (!vertexShader || !shadowMapVertexShader || !compactVertexShader || !compactShadowMapVertexShader)
+		Quit();
 }
 
 // --------------------------------------------------------
@@ -128,10 +144,28 @@ void Game::LoadShaders()
 // --------------------------------------------------------
 void Game::CreateGeometry()
 {
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/snowglobe.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/christmas_tree.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cube.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/snowman.obj").c_str(), device, context));
+	// Keep the paths around so the import benchmark can reload the same files
+	modelFiles.push_back(FixPath(L"../../Assets/Models/snowglobe.obj"));
+	modelFiles.push_back(FixPath(L"../../Assets/Models/christmas_tree.obj"));
+	modelFiles.push_back(FixPath(L"../../Assets/Models/cube.obj"));
+	modelFiles.push_back(FixPath(L"../../Assets/Models/snowman.obj"));
+
+	// Meshes load on worker threads, so the first frame doesn't wait for them
+	// - Each one draws nothing until Update() uploads it
+	meshLoader = std::make_unique<MeshLoader>(device, context);
+	for (int i = 0; i < modelFiles.size(); i++)
+	{
+		// Entity meshes use CompactVertex data to halve vertex fetch bandwidth
+		// - Except the cube, which the sky draws with its own full Vertex shader
+		MeshImportOptions importOptions;
+		importOptions.compactVertices = (i != 2);
+		importOptions.keepProxySource = (i != 2);
+
+		meshes.push_back(meshLoader->LoadAsync(modelFiles[i], importOptions));
+	}
+
+	// Proxies are made once the static entities' meshes have loaded, by the same workers
+	hlod = std::make_unique<HlodSystem>(meshLoader.get());
 }
 
 // Create a list of Game Entities to be rendered to the screen and initialize their starting transforms
@@ -143,6 +177,14 @@ void Game::CreateEntities()
 	entities.push_back(std::make_shared<GameEntity>(meshes[1], materials[1]));
 	entities.push_back(std::make_shared<GameEntity>(meshes[3], materials[2]));
 
+	// None of the scene moves on its own, so all of it can be merged into HLOD proxies
+	// - Moves are journaled by entity index, which is how HlodSystem finds moved members
+	for (int i = 0; i < entities.size(); i++)
+	{
+		entities[i]->SetStatic(true);
+		entities[i]->GetTransform()->SetJournalId(i);
+	}
+
 	PositionGeometry();
 }
 
@@ -168,6 +210,10 @@ void Game::CreateMaterials()
 	materials.push_back(mSnowglobe);
 	materials.push_back(mChristmasTree);
 	materials.push_back(mSnowman);
+
+	// Every material can draw meshes with compact vertices
+	for (int i = 0; i < materials.size(); i++)
+		materials[i]->SetCompactVertexShader(compactVertexShader);
 }
 
 void Game::SetupLights()
@@ -420,16 +466,23 @@ void Game::UpdateUI(float dt)
 	input.SetMouseCapture(io.WantCaptureMouse);
 }
 
+// --------------------------------------------------------
+// Places the tree and snowman inside the snowglobe
+// - They're children of the globe, so these are relative to
+//   it and they move along when it does
+// --------------------------------------------------------
 void Game::PositionGeometry()
 {
 	std::shared_ptr<GameEntity> snowglobe = entities[0];
 
 	std::shared_ptr<GameEntity> christmasTree = entities[1];
+	christmasTree->GetTransform()->SetParent(snowglobe->GetTransform());
 	christmasTree->GetTransform()->SetScale(0.08f);
 	christmasTree->GetTransform()->SetPosition(-1.58f, 5.44f, -5.2f);
 	christmasTree->GetTransform()->Rotate(0.f, Deg2Rad(-33.6f), 0.f);
 
 	std::shared_ptr<GameEntity> snowman = entities[2];
+	snowman->GetTransform()->SetParent(snowglobe->GetTransform());
 	snowman->GetTransform()->SetScale(.5f);
 	snowman->GetTransform()->SetPosition(3.47f, 5.29f, -4.98f);
 	snowman->GetTransform()->Rotate(0.f, Deg2Rad(-88.2f), 0.f);
@@ -465,9 +518,15 @@ void Game::Update(float deltaTime, float totalTime)
 	if (Input::GetInstance().KeyDown(VK_ESCAPE))
 		Quit();
 
+	// Give meshes that finished loading their GPU buffers
+	meshLoader->UploadFinished();
+	if (meshLoader->GetPendingCount() == 0 && meshesLoadedMilliseconds == 0.0)
+		meshesLoadedMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - initStartTime).count();
+
 	UpdateUI(deltaTime);
-	ImGuiMenus::WindowStats(windowWidth, windowHeight);
-	ImGuiMenus::EditScene(camera, entities, materials, &lights);
+	ImGuiMenus::WindowStats(windowWidth, windowHeight, cameraMeshletStats, shadowMeshletStats, GeometryPool::GetInstance().GetBindCount());
+	ImGuiMenus::EditScene(camera, entities, materials, &lights, &lodSettings, hlod.get(), &hlodSettings);
+	ImGuiMenus::MeshImport(modelFiles, meshLoader->GetPendingCount(), firstFrameMilliseconds, meshesLoadedMilliseconds);
 
 	// Update the camera
 	if (camera != 0)
@@ -477,6 +536,12 @@ void Game::Update(float deltaTime, float totalTime)
 	
 	UpdateGeometry();
 
+	// Rebuild the world matrices of everything that moved in one pass, before anything reads them
+	TransformSystem::GetInstance().UpdateWorldMatrices();
+
+	// Swap far groups of static entities for their proxies
+	hlod->Update(entities, camera->GetTransform()->GetPosition(), hlodSettings);
+
 	// Reset shadows when a light in the scene has started or stopped casting shadows
 	for (int i = 0; i < lights.size(); i++)
 	{
@@ -486,6 +551,9 @@ void Game::Update(float deltaTime, float totalTime)
 			break;
 		}
 	}
+
+	// Everything that reads the transform change journal has, so anything that moves from here on goes in the next one
+	TransformSystem::GetInstance().NextFrame();
 }
 
 // --------------------------------------------------------
@@ -505,34 +573,60 @@ void Game::Draw(float deltaTime, float totalTime)
 		context->ClearDepthStencilView(depthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 	}
 
+	if (firstFrameMilliseconds == 0.0)
+		firstFrameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - initStartTime).count();
+
+	cameraMeshletStats = {};
+	shadowMeshletStats = {};
+	GeometryPool::GetInstance().ResetBindCount();
+
+	// Shadows and the camera draw the same entities, so far clusters cast their proxy's shadow
+	hlod->GetDrawList(entities, drawEntities);
+
 	RenderShadowMaps();
 
+	// Each pass binds the pool's buffers once more, in case anything in between changed them
+	GeometryPool::GetInstance().BeginPass();
+
 	// Render all objects in the scene
-	for (int i = 0; i < entities.size(); i++)
+	for (int i = 0; i < drawEntities.size(); i++)
 	{
-		std::shared_ptr<SimplePixelShader> ps = entities[i]->GetMaterial()->GetPixelShader();
-		std::shared_ptr<SimpleVertexShader> vs = entities[i]->GetMaterial()->GetVertexShader();
+		// Every material the entity's submeshes use needs the scene's data
+		drawEntities[i]->GetMaterials(entityMaterials);
+		for (int m = 0; m < entityMaterials.size(); m++)
+		{
+			std::shared_ptr<SimplePixelShader> ps = entityMaterials[m]->GetPixelShader();
+			std::shared_ptr<SimpleVertexShader> vs = drawEntities[i]->GetVertexShader(entityMaterials[m]);
 
-		// Animated Pixel Shader needs the totalTime var
-		ps->SetFloat("totalTime", totalTime);
+			// Animated Pixel Shader needs the totalTime var
+			ps->SetFloat("totalTime", totalTime);
 
-		if (lights.size() > 0)
-		{
-			ps->SetData("lights", &lights[0], (int)lights.size() * sizeof(Light));
-			// Send all of the Shadow Maps to the pixel shader through a Texture2DArray stored in an SRV
-			ps->SetShaderResourceView("ShadowMaps", srvShadowMapArray);
-			ps->SetSamplerState("ShadowSampler", shadowMapSampler);
-		}
+			if (lights.size() > 0)
+			{
+				ps->SetData("lights", &lights[0], (int)lights.size() * sizeof(Light));
+				// Send all of the Shadow Maps to the pixel shader through a Texture2DArray stored in an SRV
+				ps->SetShaderResourceView("ShadowMaps", srvShadowMapArray);
+				ps->SetSamplerState("ShadowSampler", shadowMapSampler);
+			}
 
-		if (lightViewMatrices.size() > 0)
-		{
-			// The vertex shader needs the view and projection matrices used to create each Shadow Map
-			// so that the pixel shader can interpret the Shadow Maps properly
-			vs->SetData("lightViews", &lightViewMatrices[0], numShadowMaps * sizeof(XMFLOAT4X4));
-			vs->SetData("lightProjs", &lightProjMatrices[0], numShadowMaps * sizeof(XMFLOAT4X4));
+			if (lightViewMatrices.size() > 0)
+			{
+				// The vertex shader needs the view and projection matrices used to create each Shadow Map
+				// so that the pixel shader can interpret the Shadow Maps properly
+				vs->SetData("lightViews", &lightViewMatrices[0], numShadowMaps * sizeof(XMFLOAT4X4));
+				vs->SetData("lightProjs", &lightProjMatrices[0], numShadowMaps * sizeof(XMFLOAT4X4));
+			}
 		}
 
-		entities[i]->Draw(context, camera);
+		// Only draw the meshlets of the chosen LOD that the camera can see
+		int lod = drawEntities[i]->SelectLod(0, camera->GetViewMatrix(), camera->GetProjectionMatrix(), (float)windowHeight, lodSettings);
+		MeshletCulling::View view = MeshletCulling::MakeView(drawEntities[i]->GetTransform()->GetWorldMatrix(),
+			camera->GetViewMatrix(), camera->GetProjectionMatrix());
+		drawEntities[i]->GetMesh()->CullMeshlets(lod, view, cameraMeshletStats, visibleRanges);
+		if (visibleRanges.size() == 0)
+			continue;
+
+		drawEntities[i]->Draw(context, camera, lod, visibleRanges);
 	}
 
 	// Draw the Skybox after each entity in the scene so that only the visible parts of the Skybox are rendered
@@ -566,6 +660,7 @@ void Game::RenderShadowMaps()
 
 	// Set the renderer to the proper settings for only rendering depth buffers
 	context->RSSetState(shadowMapRasterizer.Get());
+	GeometryPool::GetInstance().BeginPass();
 	context->PSSetShader(0, 0, 0);
 
 	D3D11_VIEWPORT lightViewport = {};
@@ -766,15 +861,27 @@ void Game::RenderShadowMaps()
 				context->OMSetRenderTargets(0, 0, dsvShadowMap.Get());
 
 				// Render all of the game entities in the scene to a depth buffer using a custom vertex shader
-				for (int i = 0; i < entities.size(); i++)
+				for (int i = 0; i < drawEntities.size(); i++)
 				{
-					shadowMapVertexShader->SetShader();
-					shadowMapVertexShader->SetMatrix4x4("view", lightView);
-					shadowMapVertexShader->SetMatrix4x4("proj", lightProj);
-					shadowMapVertexShader->SetMatrix4x4("world", entities[i]->GetTransform()->GetWorldMatrix());
-					shadowMapVertexShader->CopyAllBufferData();
-					// Use the Mesh's draw method so no extra constant buffers or render settings are set
-					entities[i]->GetMesh()->Draw();
+					std::shared_ptr<Mesh> mesh = drawEntities[i]->GetMesh();
+					int lod = drawEntities[i]->SelectLod(1 + shadowIndex, lightView, lightProj, (float)shadowMapResolution, lodSettings);
+					MeshletCulling::View view = MeshletCulling::MakeView(drawEntities[i]->GetTransform()->GetWorldMatrix(), lightView, lightProj);
+					mesh->CullMeshlets(lod, view, shadowMeshletStats, visibleRanges);
+					if (visibleRanges.size() == 0)
+						continue;
+
+					std::shared_ptr<SimpleVertexShader> shadowVS = mesh->HasCompactVertices() ? compactShadowMapVertexShader : shadowMapVertexShader;
+					shadowVS->SetShader();
+					shadowVS->SetMatrix4x4("view", lightView);
+					shadowVS->SetMatrix4x4("proj", lightProj);
+					XMFLOAT3X4 world = drawEntities[i]->GetTransform()->GetWorldMatrix3x4();
+					shadowVS->SetData("world", &world, sizeof(XMFLOAT3X4));
+					if (mesh->HasCompactVertices())
+						mesh->SetCompactDecodeData(shadowVS);
+					shadowVS->CopyAllBufferData();
+					// Use the Mesh's depth-only draw so no extra constant buffers or render settings are set,
+					// and only the position stream is fetched
+					mesh->DrawDepth(visibleRanges);
 				}
 
 				// Copy the Texture2D depth buffer that was just rendered into the Texture2DArray that will be sent to the pixel shader
@@ -5,9 +5,12 @@
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include <memory>
 #include <vector>
+#include <chrono>
 #include "WICTextureLoader.h"
 #include "Mesh.h"
+#include "MeshLoader.h"
 #include "GameEntity.h"
+#include "HlodSystem.h"
 #include "Camera.h"
 #include "SimpleShader.h"
 #include "Lights.h"
@@ -56,6 +59,8 @@ private:
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimplePixelShader> animatedPixelShader;
 	std::shared_ptr<SimpleVertexShader> shadowMapVertexShader;
+	std::shared_ptr<SimpleVertexShader> compactVertexShader;
+	std::shared_ptr<SimpleVertexShader> compactShadowMapVertexShader;
 
 	// Textures, SRVs, and Sampler States
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srvSnowglobe[4];
@@ -94,11 +99,32 @@ private:
 
 
 	// Game objects
+	std::vector<std::wstring> modelFiles;
 	std::vector<std::shared_ptr<Mesh>> meshes;
+	std::unique_ptr<MeshLoader> meshLoader;
 	std::vector<std::shared_ptr<GameEntity>> entities;
+	std::vector<std::shared_ptr<GameEntity>> drawEntities;	// Entities drawn this frame, with HLOD proxies in place of far clusters
 	std::vector<std::shared_ptr<Material>> materials;
 	std::shared_ptr<Camera> camera;
 	std::vector<Light> lights;
 	std::shared_ptr<Sky> skybox;
+
+	// Mesh LOD selection, where view 0 is the camera and shadow map n is view 1 + n
+	LodSettings lodSettings;
+
+	// Merged proxies for far away groups of static entities
+	std::unique_ptr<HlodSystem> hlod;
+	HlodSettings hlodSettings;
+
+	// Meshlets left to draw after culling, reused for every entity and view
+	std::vector<MeshletCulling::DrawRange> visibleRanges;
+	std::vector<std::shared_ptr<Material>> entityMaterials;	// Materials of the entity being drawn, reused the same way
+	MeshletCulling::Stats cameraMeshletStats;
+	MeshletCulling::Stats shadowMeshletStats;
+
+	// Startup timing, in milliseconds since Init() began (0 until it happens)
+	std::chrono::high_resolution_clock::time_point initStartTime;
+	double firstFrameMilliseconds;
+	double meshesLoadedMilliseconds;
 };
 
@@ -1,37 +1,262 @@
+#include <cmath>
+#include <algorithm>
 #include "GameEntity.h"
 
+using namespace DirectX;
+
 GameEntity::GameEntity(std::shared_ptr<Mesh> meshRef, std::shared_ptr<Material> mat)
 	:
 	mesh(meshRef),
-	material(mat)
+	material(mat),
+	isStatic(false),
+	worldBoundsMin(0.0f, 0.0f, 0.0f),
+	worldBoundsMax(0.0f, 0.0f, 0.0f),
+	worldSphereCenter(0.0f, 0.0f, 0.0f),
+	worldSphereRadius(0.0f),
+	boundsVersion(0),
+	boundsValid(false)
 {
 	transform = Transform();
 }
 
+// The material's vertex shader that can read this entity's mesh
+std::shared_ptr<SimpleVertexShader> GameEntity::GetVertexShader(std::shared_ptr<Material> mat)
+{
+	return mesh->HasCompactVertices() ? mat->GetCompactVertexShader() : mat->GetVertexShader();
+}
+
+// The material drawn on a submesh, which is the entity's own unless one was set for it
+std::shared_ptr<Material> GameEntity::GetSubmeshMaterial(int materialId)
+{
+	int slot = materialId + 1;
+	return slot < submeshMaterials.size() && submeshMaterials[slot] ? submeshMaterials[slot] : material;
+}
+
+void GameEntity::SetSubmeshMaterial(int materialId, std::shared_ptr<Material> m)
+{
+	int slot = materialId + 1;
+	if (slot >= submeshMaterials.size())
+		submeshMaterials.resize(slot + 1);
+	submeshMaterials[slot] = m;
+}
+
+// Every material this entity draws with, each listed once
+void GameEntity::GetMaterials(std::vector<std::shared_ptr<Material>>& used)
+{
+	used.clear();
+	used.push_back(material);
+	for (int i = 0; i < submeshMaterials.size(); i++)
+	{
+		if (submeshMaterials[i] && std::find(used.begin(), used.end(), submeshMaterials[i]) == used.end())
+			used.push_back(submeshMaterials[i]);
+	}
+}
+
+XMFLOAT3 GameEntity::GetWorldBoundsMin()
+{
+	UpdateWorldBounds();
+	return worldBoundsMin;
+}
+
+XMFLOAT3 GameEntity::GetWorldBoundsMax()
+{
+	UpdateWorldBounds();
+	return worldBoundsMax;
+}
+
+XMFLOAT3 GameEntity::GetWorldSphereCenter()
+{
+	UpdateWorldBounds();
+	return worldSphereCenter;
+}
+
+float GameEntity::GetWorldSphereRadius()
+{
+	UpdateWorldBounds();
+	return worldSphereRadius;
+}
+
+// --------------------------------------------------------
+// Moves the mesh's local bounds into world space, but only
+// when the transform has rebuilt its world matrix since the
+// last time (or the mesh or transform was replaced, or the
+// mesh finished loading)
+//
+// - The box stays axis aligned by growing its extents with
+//   the absolute value of the matrix (Arvo's method), which
+//   is exact for the box but not for the mesh inside it
+// - The sphere's radius is scaled by the longest axis of the
+//   matrix, so non-uniform scales still contain the mesh
+// --------------------------------------------------------
+void GameEntity::UpdateWorldBounds()
+{
+	// Copying the matrix out is only worth it when the bounds need rebuilding
+	transform.UpdateWorldMatrix();
+	if (boundsValid && boundsVersion == transform.GetWorldMatrixVersion())
+		return;
+
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+
+	XMFLOAT3 localMin = mesh->GetBoundsMin();
+	XMFLOAT3 localMax = mesh->GetBoundsMax();
+	float center[3] = { (localMin.x + localMax.x) * 0.5f, (localMin.y + localMax.y) * 0.5f, (localMin.z + localMax.z) * 0.5f };
+	float extent[3] = { (localMax.x - localMin.x) * 0.5f, (localMax.y - localMin.y) * 0.5f, (localMax.z - localMin.z) * 0.5f };
+
+	float worldCenter[3];
+	float worldExtent[3];
+	for (int column = 0; column < 3; column++)
+	{
+		worldCenter[column] = world.m[3][column];
+		worldExtent[column] = 0.0f;
+		for (int row = 0; row < 3; row++)
+		{
+			worldCenter[column] += center[row] * world.m[row][column];
+			worldExtent[column] += extent[row] * fabsf(world.m[row][column]);
+		}
+	}
+	worldBoundsMin = XMFLOAT3(worldCenter[0] - worldExtent[0], worldCenter[1] - worldExtent[1], worldCenter[2] - worldExtent[2]);
+	worldBoundsMax = XMFLOAT3(worldCenter[0] + worldExtent[0], worldCenter[1] + worldExtent[1], worldCenter[2] + worldExtent[2]);
+
+	float maxAxisSq = 0.0f;
+	for (int row = 0; row < 3; row++)
+	{
+		float axisSq = world.m[row][0] * world.m[row][0] + world.m[row][1] * world.m[row][1] + world.m[row][2] * world.m[row][2];
+		maxAxisSq = axisSq > maxAxisSq ? axisSq : maxAxisSq;
+	}
+
+	XMFLOAT3 sphereCenter = mesh->GetBoundingSphereCenter();
+	XMStoreFloat3(&worldSphereCenter, XMVector3TransformCoord(XMLoadFloat3(&sphereCenter), XMLoadFloat4x4(&world)));
+	worldSphereRadius = mesh->GetBoundingSphereRadius() * sqrtf(maxAxisSq);
+
+	// A mesh that's still loading has no bounds yet, so check again next time
+	boundsVersion = transform.GetWorldMatrixVersion();
+	boundsValid = mesh->IsReady();
+}
+
+// --------------------------------------------------------
+// Picks the coarsest LOD of this entity's mesh whose error
+// stays under settings.maxPixelError pixels in a view
+//
+// - The world space bounding sphere is projected with the view's
+//   projection (the camera's FOV, for the main view) and the
+//   viewport height, giving pixels per world unit at the
+//   sphere's nearest point
+// - "view" numbers the camera and each shadow map view, and
+//   each remembers its last level: a coarser level is only
+//   taken once its error is well under the limit, so meshes
+//   near the threshold don't flicker between two levels
+// --------------------------------------------------------
+int GameEntity::SelectLod(int view, XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projMatrix, float viewportHeight,
+	const LodSettings& settings)
+{
+	int lodCount = mesh->GetLodCount();
+	if (lodCount <= 1)
+		return 0;
+
+	if (viewLods.size() <= view)
+		viewLods.resize(view + 1, 0);
+
+	if (settings.forcedLod >= 0)
+	{
+		viewLods[view] = settings.forcedLod < lodCount ? settings.forcedLod : lodCount - 1;
+		return viewLods[view];
+	}
+
+	// LOD errors are in mesh units and grow with the largest axis scale, parents' included
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	float maxScaleSq = 0.0f;
+	for (int row = 0; row < 3; row++)
+	{
+		float axisSq = world.m[row][0] * world.m[row][0] + world.m[row][1] * world.m[row][1] + world.m[row][2] * world.m[row][2];
+		maxScaleSq = axisSq > maxScaleSq ? axisSq : maxScaleSq;
+	}
+	float maxScale = sqrtf(maxScaleSq);
+
+	// The cached world space bounding sphere, moved into the view
+	XMFLOAT3 center = GetWorldSphereCenter();
+	XMVECTOR viewCenter = XMVector3TransformCoord(XMLoadFloat3(&center), XMLoadFloat4x4(&viewMatrix));
+	float radius = GetWorldSphereRadius();
+
+	// The projection scales y by _22 and then divides by w, which is the
+	// view depth for perspective projections and 1 for orthographic ones
+	float w = (XMVectorGetZ(viewCenter) - radius) * projMatrix._34 + projMatrix._44;
+	if (w <= 0.0f)
+	{
+		// The view is inside the sphere
+		viewLods[view] = 0;
+		return 0;
+	}
+
+	// LOD errors are in mesh units, so scale them to world units and then to pixels
+	float pixelsPerMeshUnit = 0.5f * viewportHeight * projMatrix._22 / w * maxScale;
+
+	int lod = viewLods[view] < lodCount ? viewLods[view] : lodCount - 1;
+	while (lod > 0 && mesh->GetLod(lod).error * pixelsPerMeshUnit > settings.maxPixelError)
+		lod--;
+	while (lod + 1 < lodCount && mesh->GetLod(lod + 1).error * pixelsPerMeshUnit <= settings.maxPixelError * (1.0f - settings.hysteresis))
+		lod++;
+
+	viewLods[view] = lod;
+	return lod;
+}
+
+// --------------------------------------------------------
+// Draws the visible ranges of one LOD, one draw per submesh
+// - The mesh's buffers are bound once for all of them, and
+//   shaders only change when the next submesh's material
+//   differs from the last one's
+// --------------------------------------------------------
 void GameEntity::Draw(
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-	std::shared_ptr<Camera> camera)
+	std::shared_ptr<Camera> camera,
+	int lod,
+	const std::vector<MeshletCulling::DrawRange>& ranges)
 {
-	// Set the active shaders to this entity's material
-	material->GetVertexShader()->SetShader();
-	material->GetPixelShader()->SetShader();
+	int lodCount = mesh->GetLodCount();
+	if (lodCount == 0)
+		return;
+	lod = lod < 0 ? 0 : (lod < lodCount ? lod : lodCount - 1);
+
+	std::shared_ptr<Material> prepared;
+	for (int i = 0; i < mesh->GetSubmeshCount(); i++)
+	{
+		MeshOptimizer::Submesh submesh = mesh->GetSubmesh(lod, i);
+		std::shared_ptr<Material> submeshMaterial = GetSubmeshMaterial(submesh.materialId);
+		if (submeshMaterial != prepared)
+		{
+			PrepareMaterial(submeshMaterial, camera);
+			prepared = submeshMaterial;
+		}
+
+		// Render the visible parts of this submesh
+		mesh->Draw(ranges, submesh);
+	}
+}
+
+void GameEntity::PrepareMaterial(std::shared_ptr<Material> mat, std::shared_ptr<Camera> camera)
+{
+	// Set the active shaders to this material
+	std::shared_ptr<SimpleVertexShader> vs = GetVertexShader(mat);
+	vs->SetShader();
+	mat->GetPixelShader()->SetShader();
 
 	// Update each constant buffer's data
-	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
-	vs->SetMatrix4x4("world", transform.GetWorldMatrix());	// Strings here MUST match variable
+	// - World and normal matrices go up as 3x4, since their last row is always the same
+	XMFLOAT3X4 world = transform.GetWorldMatrix3x4();
+	XMFLOAT3X4 normal = transform.GetNormalMatrix3x4();
+	vs->SetData("world", &world, sizeof(XMFLOAT3X4));			// Strings here MUST match variable
 	vs->SetMatrix4x4("view", camera->GetViewMatrix());		// names in the
 	vs->SetMatrix4x4("proj", camera->GetProjectionMatrix()); // shader's cbuffer!
-	vs->SetMatrix4x4("worldInvTranspose", transform.GetWorldInverseTransposeMatrix());
+	vs->SetData("normalMatrix", &normal, sizeof(XMFLOAT3X4));
+	if (mesh->HasCompactVertices())
+		mesh->SetCompactDecodeData(vs);
 
-	std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
+	std::shared_ptr<SimplePixelShader> ps = mat->GetPixelShader();
 	ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
 
-	material->Prepare();
+	mat->Prepare();
 
 	// Copy the constant buffer data from the CPU to the GPU
 	vs->CopyAllBufferData();
 	ps->CopyAllBufferData();
-
-	// Render this game entity's mesh
-	mesh->Draw();
 }
@@ -1,11 +1,20 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include "Transform.h"
 #include "Mesh.h"
 #include "Camera.h"
 #include "Material.h"
 
+// How entities pick a mesh LOD for each view, shared by the whole scene
+struct LodSettings
+{
+	float maxPixelError = 1.0f;	// Largest error a level may show on screen, in pixels
+	float hysteresis = 0.25f;	// A coarser level must be this fraction under the limit before switching to it
+	int forcedLod = -1;			// Draw every mesh at this level instead (-1 picks by screen size)
+};
+
 class GameEntity
 {
 public:
@@ -14,19 +23,50 @@ public:
 	Transform* GetTransform() { return &transform; }
 	std::shared_ptr<Mesh> GetMesh() { return mesh; }
 	std::shared_ptr<Material> GetMaterial() { return material; }
+	std::shared_ptr<SimpleVertexShader> GetVertexShader() { return GetVertexShader(material); }
+	std::shared_ptr<SimpleVertexShader> GetVertexShader(std::shared_ptr<Material> mat);
+	std::shared_ptr<Material> GetSubmeshMaterial(int materialId);
+	void GetMaterials(std::vector<std::shared_ptr<Material>>& used);
+	DirectX::XMFLOAT3 GetWorldBoundsMin();
+	DirectX::XMFLOAT3 GetWorldBoundsMax();
+	DirectX::XMFLOAT3 GetWorldSphereCenter();
+	float GetWorldSphereRadius();
+	int GetSelectedLod(int view) { return view < viewLods.size() ? viewLods[view] : 0; }
+	bool IsStatic() { return isStatic; }
 
-	void SetTransform(Transform t) { transform = t; }
-	void SetMesh(std::shared_ptr<Mesh> m) { mesh = m; }
+	void SetTransform(Transform t) { transform = t; boundsValid = false; }
+	void SetMesh(std::shared_ptr<Mesh> m) { mesh = m; boundsValid = false; }
 	void SetMaterial(std::shared_ptr<Material> m) { material = m; }
+	void SetSubmeshMaterial(int materialId, std::shared_ptr<Material> m);
+	void SetStatic(bool s) { isStatic = s; }
+
+	int SelectLod(int view, DirectX::XMFLOAT4X4 viewMatrix, DirectX::XMFLOAT4X4 projMatrix, float viewportHeight,
+		const LodSettings& settings);
 
 	void Draw(
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-		std::shared_ptr<Camera> camera
+		std::shared_ptr<Camera> camera,
+		int lod,
+		const std::vector<MeshletCulling::DrawRange>& ranges
 	);
 
 private:
-	Transform transform;
+	void UpdateWorldBounds();
+	void PrepareMaterial(std::shared_ptr<Material> mat, std::shared_ptr<Camera> camera);
+
+	Transform transform;		// Index of this entity's slot in TransformSystem
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
+	std::vector<std::shared_ptr<Material>> submeshMaterials;	// By Submesh::materialId + 1, empty ones use material
+	std::vector<int> viewLods;	// Last level picked in each view, for hysteresis
+	bool isStatic;				// Doesn't move during play, so it may be merged into an HLOD proxy
+
+	// The mesh's bounds in world space, rebuilt only when the world matrix was
+	DirectX::XMFLOAT3 worldBoundsMin;
+	DirectX::XMFLOAT3 worldBoundsMax;
+	DirectX::XMFLOAT3 worldSphereCenter;
+	float worldSphereRadius;
+	unsigned int boundsVersion;	// Transform's world matrix version the bounds were made from
+	bool boundsValid;
 };
 
@@ -0,0 +1,305 @@
+#include "GeometryPool.h"
+
+namespace
+{
+	// Starting sizes, in elements, before the first mesh makes a buffer grow
+	const unsigned int initialVertexCapacity = 64 * 1024;
+	const unsigned int initialIndexCapacity = 256 * 1024;
+}
+
+GeometryPool* GeometryPool::instance;
+
+// ------------------------------------------------------------------
+// RangeAllocator
+// ------------------------------------------------------------------
+RangeAllocator::RangeAllocator()
+	:
+	capacity(0),
+	used(0)
+{
+}
+
+// Takes the first free block big enough, so early (long lived) meshes pack at the front
+bool RangeAllocator::Allocate(unsigned int count, unsigned int& offset)
+{
+	for (int i = 0; i < freeBlocks.size(); i++)
+	{
+		if (freeBlocks[i].count < count)
+			continue;
+
+		offset = freeBlocks[i].offset;
+		freeBlocks[i].offset += count;
+		freeBlocks[i].count -= count;
+		if (freeBlocks[i].count == 0)
+			freeBlocks.erase(freeBlocks.begin() + i);
+
+		used += count;
+		return true;
+	}
+
+	return false;
+}
+
+void RangeAllocator::Free(unsigned int offset, unsigned int count)
+{
+	if (count == 0)
+		return;
+
+	// First block after the freed range
+	int next = 0;
+	while (next < freeBlocks.size() && freeBlocks[next].offset < offset)
+		next++;
+
+	bool joinsPrevious = next > 0 && freeBlocks[next - 1].offset + freeBlocks[next - 1].count == offset;
+	bool joinsNext = next < freeBlocks.size() && offset + count == freeBlocks[next].offset;
+
+	if (joinsPrevious && joinsNext)
+	{
+		freeBlocks[next - 1].count += count + freeBlocks[next].count;
+		freeBlocks.erase(freeBlocks.begin() + next);
+	}
+	else if (joinsPrevious)
+	{
+		freeBlocks[next - 1].count += count;
+	}
+	else if (joinsNext)
+	{
+		freeBlocks[next].offset = offset;
+		freeBlocks[next].count += count;
+	}
+	else
+	{
+		Block block = { offset, count };
+		freeBlocks.insert(freeBlocks.begin() + next, block);
+	}
+
+	used -= count;
+}
+
+// Adds [capacity, newCapacity) as free space, merged with a free block at the end
+void RangeAllocator::Grow(unsigned int newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	unsigned int added = newCapacity - capacity;
+	unsigned int oldCapacity = capacity;
+	capacity = newCapacity;
+
+	// Free() counts the range as used space being returned
+	used += added;
+	Free(oldCapacity, added);
+}
+
+unsigned int RangeAllocator::GetLargestFreeBlock()
+{
+	unsigned int largest = 0;
+	for (int i = 0; i < freeBlocks.size(); i++)
+		largest = freeBlocks[i].count > largest ? freeBlocks[i].count : largest;
+	return largest;
+}
+
+// ------------------------------------------------------------------
+// GeometryPool
+// ------------------------------------------------------------------
+GeometryPool::GeometryPool()
+	:
+	indexPool(),
+	boundVertexPool(-1),
+	bindCount(0)
+{
+	indexPool.stride = sizeof(unsigned int);
+	indexPool.bindFlag = D3D11_BIND_INDEX_BUFFER;
+}
+
+void GeometryPool::Initialize(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	this->device = device;
+	this->context = context;
+}
+
+// --------------------------------------------------------
+// Copies a mesh's vertices and indices into the pool
+// - The returned allocation isn't valid if a buffer could
+//   not be created, and the mesh then has nothing to draw
+// --------------------------------------------------------
+GeometryPool::Allocation GeometryPool::Allocate(const void* vertices, unsigned int vertexCount, unsigned int vertexStride,
+	const unsigned int* indices, unsigned int indexCount)
+{
+	Allocation allocation = {};
+	allocation.vertexStride = vertexStride;
+	allocation.vertexCount = vertexCount;
+	allocation.indexCount = indexCount;
+	if (vertexCount == 0 || indexCount == 0)
+		return allocation;
+
+	PoolBuffer& vertexPool = GetVertexPool(vertexStride);
+	if (!AllocateRange(vertexPool, vertexCount, allocation.baseVertex))
+		return allocation;
+	if (!AllocateRange(indexPool, indexCount, allocation.startIndex))
+	{
+		vertexPool.allocator.Free(allocation.baseVertex, vertexCount);
+		return allocation;
+	}
+
+	WriteRange(vertexPool, allocation.baseVertex, vertexCount, vertices);
+	WriteRange(indexPool, allocation.startIndex, indexCount, indices);
+
+	allocation.valid = true;
+	return allocation;
+}
+
+// --------------------------------------------------------
+// Copies vertices into the pool without any indices
+// - For extra streams of a mesh (like positions only) that
+//   are drawn with the indices of its main allocation
+// --------------------------------------------------------
+GeometryPool::Allocation GeometryPool::AllocateVertices(const void* vertices, unsigned int vertexCount, unsigned int vertexStride)
+{
+	Allocation allocation = {};
+	allocation.vertexStride = vertexStride;
+	allocation.vertexCount = vertexCount;
+	if (vertexCount == 0)
+		return allocation;
+
+	PoolBuffer& vertexPool = GetVertexPool(vertexStride);
+	if (!AllocateRange(vertexPool, vertexCount, allocation.baseVertex))
+		return allocation;
+
+	WriteRange(vertexPool, allocation.baseVertex, vertexCount, vertices);
+
+	allocation.valid = true;
+	return allocation;
+}
+
+void GeometryPool::Free(Allocation& allocation)
+{
+	if (!allocation.valid)
+		return;
+
+	for (int i = 0; i < vertexPools.size(); i++)
+	{
+		if (vertexPools[i].stride == allocation.vertexStride)
+			vertexPools[i].allocator.Free(allocation.baseVertex, allocation.vertexCount);
+	}
+	indexPool.allocator.Free(allocation.startIndex, allocation.indexCount);
+	allocation.valid = false;
+}
+
+// The vertex buffer for a stride, made (empty) the first time that stride is used
+GeometryPool::PoolBuffer& GeometryPool::GetVertexPool(unsigned int vertexStride)
+{
+	int poolIndex = 0;
+	while (poolIndex < vertexPools.size() && vertexPools[poolIndex].stride != vertexStride)
+		poolIndex++;
+	if (poolIndex == vertexPools.size())
+	{
+		PoolBuffer pool;
+		pool.stride = vertexStride;
+		pool.bindFlag = D3D11_BIND_VERTEX_BUFFER;
+		vertexPools.push_back(pool);
+	}
+	return vertexPools[poolIndex];
+}
+
+// Buffers are DEFAULT usage, so ranges can be filled in place
+void GeometryPool::WriteRange(PoolBuffer& pool, unsigned int offset, unsigned int count, const void* data)
+{
+	D3D11_BOX box = {};
+	box.left = offset * pool.stride;
+	box.right = (offset + count) * pool.stride;
+	box.bottom = 1;
+	box.back = 1;
+	context->UpdateSubresource(pool.buffer.Get(), 0, &box, data, 0, 0);
+}
+
+// Finds room for count elements, growing the buffer until there is some
+bool GeometryPool::AllocateRange(PoolBuffer& pool, unsigned int count, unsigned int& offset)
+{
+	if (pool.allocator.Allocate(count, offset))
+		return true;
+
+	// Doubling always leaves a big enough block at the end, since it joins any free tail
+	unsigned int capacity = pool.allocator.GetCapacity();
+	unsigned int newCapacity = capacity > 0 ? capacity : (pool.bindFlag == D3D11_BIND_INDEX_BUFFER ? initialIndexCapacity : initialVertexCapacity);
+	while (newCapacity < capacity + count)
+		newCapacity *= 2;
+
+	return Resize(pool, newCapacity) && pool.allocator.Allocate(count, offset);
+}
+
+// Replaces a pool's buffer with a bigger one, keeping its contents
+bool GeometryPool::Resize(PoolBuffer& pool, unsigned int capacity)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = capacity * pool.stride;
+	desc.BindFlags = pool.bindFlag;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	if (FAILED(device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+		return false;
+
+	if (pool.buffer)
+	{
+		D3D11_BOX oldContents = {};
+		oldContents.right = pool.allocator.GetCapacity() * pool.stride;
+		oldContents.bottom = 1;
+		oldContents.back = 1;
+		context->CopySubresourceRegion(buffer.Get(), 0, 0, 0, 0, pool.buffer.Get(), 0, &oldContents);
+	}
+
+	pool.buffer = buffer;
+	pool.allocator.Grow(capacity);
+
+	// The old buffer may still be bound
+	boundVertexPool = -1;
+	return true;
+}
+
+void GeometryPool::Bind(unsigned int vertexStride)
+{
+	int poolIndex = 0;
+	while (poolIndex < vertexPools.size() && vertexPools[poolIndex].stride != vertexStride)
+		poolIndex++;
+	if (poolIndex == vertexPools.size() || poolIndex == boundVertexPool)
+		return;
+
+	UINT stride = vertexStride;
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, vertexPools[poolIndex].buffer.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(indexPool.buffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+
+	boundVertexPool = poolIndex;
+	bindCount++;
+}
+
+void GeometryPool::BeginPass()
+{
+	boundVertexPool = -1;
+}
+
+void GeometryPool::GetStats(std::vector<BufferStats>& stats)
+{
+	stats.clear();
+	for (int i = 0; i < vertexPools.size(); i++)
+		stats.push_back(GetBufferStats(vertexPools[i]));
+	stats.push_back(GetBufferStats(indexPool));
+}
+
+GeometryPool::BufferStats GeometryPool::GetBufferStats(PoolBuffer& pool)
+{
+	BufferStats stats = {};
+	stats.stride = pool.stride;
+	stats.capacity = pool.allocator.GetCapacity();
+	stats.used = pool.allocator.GetUsed();
+	stats.freeBlocks = pool.allocator.GetFreeBlockCount();
+	stats.largestFreeBlock = pool.allocator.GetLargestFreeBlock();
+
+	unsigned int freeElements = stats.capacity - stats.used;
+	stats.fragmentation = freeElements > 0 ? 1.0f - (float)stats.largestFreeBlock / freeElements : 0.0f;
+	return stats;
+}
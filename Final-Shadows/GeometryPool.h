@@ -0,0 +1,140 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
+#include <vector>
+
+// --------------------------------------------------------
+// First-fit free-list over a range of elements [0, capacity)
+// - Free blocks are kept sorted by offset, and neighbours
+//   are merged when a range is freed, so the list stays as
+//   short as the fragmentation allows
+// --------------------------------------------------------
+class RangeAllocator
+{
+public:
+	RangeAllocator();
+
+	bool Allocate(unsigned int count, unsigned int& offset);
+	void Free(unsigned int offset, unsigned int count);
+	void Grow(unsigned int newCapacity);
+
+	unsigned int GetCapacity() { return capacity; }
+	unsigned int GetUsed() { return used; }
+	unsigned int GetFreeBlockCount() { return (unsigned int)freeBlocks.size(); }
+	unsigned int GetLargestFreeBlock();
+
+private:
+	struct Block
+	{
+		unsigned int offset;
+		unsigned int count;
+	};
+
+	std::vector<Block> freeBlocks;
+	unsigned int capacity;
+	unsigned int used;
+};
+
+// --------------------------------------------------------
+// A few large vertex and index buffers that every Mesh puts
+// its geometry into
+//
+// - There is one vertex buffer per vertex stride (Vertex,
+//   CompactVertex and their position-only streams) and one
+//   32-bit index buffer for all
+// - Meshes keep their own local indices and draw with a base
+//   vertex and start index, so buffers only need binding
+//   when the vertex format changes, not once per draw
+// - A full buffer is replaced by one twice as big, with the
+//   old contents copied over on the GPU
+// - Only used from the render thread
+// --------------------------------------------------------
+class GeometryPool
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static GeometryPool& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new GeometryPool();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	GeometryPool(GeometryPool const&) = delete;
+	void operator=(GeometryPool const&) = delete;
+
+private:
+	static GeometryPool* instance;
+	GeometryPool();
+#pragma endregion
+
+public:
+	// Where one mesh's geometry lives in the pool
+	struct Allocation
+	{
+		unsigned int vertexStride;
+		unsigned int baseVertex;
+		unsigned int vertexCount;
+		unsigned int startIndex;
+		unsigned int indexCount;
+		bool valid;
+	};
+
+	// Usage of one of the pool's buffers, in elements
+	struct BufferStats
+	{
+		unsigned int stride;		// Bytes per element
+		unsigned int capacity;
+		unsigned int used;
+		unsigned int freeBlocks;
+		unsigned int largestFreeBlock;
+		float fragmentation;		// 1 - largest free block / all free space
+	};
+
+	void Initialize(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	Allocation Allocate(const void* vertices, unsigned int vertexCount, unsigned int vertexStride,
+		const unsigned int* indices, unsigned int indexCount);
+	Allocation AllocateVertices(const void* vertices, unsigned int vertexCount, unsigned int vertexStride);
+	void Free(Allocation& allocation);
+
+	// Binds the buffers for a vertex stride, unless they're bound already
+	void Bind(unsigned int vertexStride);
+
+	// Forgets what is bound, for the start of a pass (other code may have changed the IA state)
+	void BeginPass();
+
+	void GetStats(std::vector<BufferStats>& stats);
+	unsigned int GetBindCount() { return bindCount; }
+	void ResetBindCount() { bindCount = 0; }
+
+private:
+	struct PoolBuffer
+	{
+		unsigned int stride;
+		D3D11_BIND_FLAG bindFlag;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+		RangeAllocator allocator;
+	};
+
+	PoolBuffer& GetVertexPool(unsigned int vertexStride);
+	void WriteRange(PoolBuffer& pool, unsigned int offset, unsigned int count, const void* data);
+	bool AllocateRange(PoolBuffer& pool, unsigned int count, unsigned int& offset);
+	bool Resize(PoolBuffer& pool, unsigned int capacity);
+	BufferStats GetBufferStats(PoolBuffer& pool);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	std::vector<PoolBuffer> vertexPools;	// One per vertex stride
+	PoolBuffer indexPool;
+
+	int boundVertexPool;		// -1 when nothing is known to be bound
+	unsigned int bindCount;		// Binds since ResetBindCount()
+};
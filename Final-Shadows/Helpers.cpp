@@ -125,3 +125,45 @@ const char* LightTypeToString(int type)
 			return "Unknown";
 	}
 }
+
+// --------------------------------------------------------------------------
+// Opens the JSON results file of a benchmark and writes the fields all of
+// them share, so runs can be compared release over release and across
+// machines
+//
+// - The build configuration is the benchmark's own, since each benchmark
+//    project compiles this file itself
+// - The root object is left open, the caller adds its results and closes it
+// --------------------------------------------------------------------------
+FILE* OpenBenchmarkJson(const char* outputPath, int iterations)
+{
+	FILE* out = 0;
+	if (fopen_s(&out, outputPath, "w") != 0 || !out)
+		return 0;
+
+	fprintf(out, "{\n");
+#ifdef _DEBUG
+	fprintf(out, "  \"configuration\": \"Debug\",\n");
+#else
+	fprintf(out, "  \"configuration\": \"Release\",\n");
+#endif
+	fprintf(out, "  \"hardwareThreads\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(out, "  \"iterations\": %d,\n", iterations);
+	return out;
+}
+
+// --------------------------------------------------------------------------
+// How many threads to split some work over
+//
+// - A threadCount of 0 means one per hardware thread
+// - No thread gets less than minimumWorkPerThread, so small jobs end up
+//    with just the one (calling) thread
+// --------------------------------------------------------------------------
+unsigned int ResolveThreadCount(unsigned int threadCount, size_t workCount, size_t minimumWorkPerThread)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount > workCount / minimumWorkPerThread)
+		threadCount = (unsigned int)(workCount / minimumWorkPerThread);
+	return threadCount > 0 ? threadCount : 1;
+}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdio>
 #include <string>
+#include <thread>
+#include <vector>
 
 // Helpers for determining the actual path to the executable
 std::wstring GetExePath();
@@ -11,4 +14,28 @@ float Deg2Rad(float deg);
 DirectX::XMFLOAT3 Deg2RadFromVector(DirectX::XMFLOAT3 degV);
 float Rad2Deg(float rad);
 DirectX::XMFLOAT3 Rad2DegFromVector(DirectX::XMFLOAT3 radV);
-const char* LightTypeToString(int type);
\ No newline at end of file
+const char* LightTypeToString(int type);
+
+// Opens a benchmark's JSON results and writes the fields every benchmark shares,
+// leaving the root object open for the caller's own (null if it can't be opened)
+FILE* OpenBenchmarkJson(const char* outputPath, int iterations);
+
+// Helpers for splitting work over threads
+// - Threads are started and joined on every call, which costs tens of
+//   microseconds each, so callers give the least work per thread that
+//   makes that worth it
+unsigned int ResolveThreadCount(unsigned int threadCount, size_t workCount, size_t minimumWorkPerThread);
+
+// Runs func(0) ... func(count - 1) at the same time, one per thread
+template<typename Func>
+void RunOnThreads(unsigned int count, Func func)
+{
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < count; i++)
+		workers.emplace_back(func, i);
+
+	func(0);
+
+	for (int i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include "HlodSystem.h"
+#include "TransformSystem.h"
+
+using namespace DirectX;
+
+HlodSystem::HlodSystem(MeshLoader* meshLoader)
+	:
+	meshLoader(meshLoader),
+	builtClusterRadius(0.0f),
+	built(false)
+{
+}
+
+// --------------------------------------------------------
+// Makes or refreshes clusters as needed, then picks which
+// clusters the camera is far enough away from to draw as
+// their proxies
+// - Moving a member only marks its cluster, the proxy is
+//   made again later, on a loader worker, and only if the
+//   cluster gets near the switch distance
+// --------------------------------------------------------
+void HlodSystem::Update(const std::vector<std::shared_ptr<GameEntity>>& entities, XMFLOAT3 cameraPosition, const HlodSettings& settings)
+{
+	// Old clusters may point at entities that changed, so nothing is drawn as a proxy until a new build
+	if (NeedsBuild(entities, settings))
+	{
+		clusters.clear();
+		entityClusters.clear();
+		built = false;
+		if (CanBuild(entities))
+			Build(entities, settings);
+	}
+
+	for (int c = 0; c < clusters.size(); c++)
+		clusters[c].moved = false;
+
+	// Only clusters with a member in the change journal can have moved (the versions then tell
+	// whether it moved since the cluster last checked, and once marked later members don't count)
+	TransformSystem& transforms = TransformSystem::GetInstance();
+	if (transforms.JournalOverflowed())
+	{
+		for (int c = 0; c < clusters.size(); c++)
+		{
+			if (MembersMoved(entities, clusters[c]))
+				MarkMoved(entities, clusters[c]);
+		}
+	}
+	else
+	{
+		// Proxies are only made further down, so no new transform can move the journal's storage here
+		const unsigned int* changedIds = transforms.GetChangedIds();
+		unsigned int changedCount = transforms.GetChangedCount();
+		for (unsigned int i = 0; i < changedCount; i++)
+		{
+			unsigned int id = changedIds[i];
+			int c = id < entityClusters.size() ? entityClusters[id] : -1;
+			if (c >= 0 && MembersMoved(entities, clusters[c]))
+				MarkMoved(entities, clusters[c]);
+		}
+	}
+
+	replaced.assign(entities.size(), false);
+	XMVECTOR camera = XMLoadFloat3(&cameraPosition);
+	for (int c = 0; c < clusters.size(); c++)
+	{
+		Cluster& cluster = clusters[c];
+		float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&cluster.center) - camera)) - cluster.radius;
+
+		// Proxies switch back in closer than they switched out, so clusters near the distance don't flicker
+		float switchBackDistance = settings.switchDistance * (1.0f - settings.hysteresis);
+
+		// A proxy is requested from where an active one would switch back, so it's usually ready by the
+		// time the cluster is past the switch distance (until then, the members are drawn)
+		// - Not while a member is moving, since that proxy would be stale before it was done
+		if (cluster.pendingProxy && cluster.pendingProxy->GetMesh()->IsReady())
+		{
+			cluster.proxy = cluster.pendingProxy;
+			cluster.pendingProxy = 0;
+			cluster.proxyDirty = false;
+		}
+		else if (settings.enabled && cluster.proxyDirty && !cluster.pendingProxy && !cluster.moved && distance > switchBackDistance)
+		{
+			RequestProxy(entities, cluster);
+		}
+
+		float threshold = cluster.proxyActive ? switchBackDistance : settings.switchDistance;
+		cluster.proxyActive = settings.enabled && cluster.proxy && distance > threshold;
+		if (!cluster.proxyActive)
+			continue;
+
+		for (int m = 0; m < cluster.members.size(); m++)
+			replaced[cluster.members[m]] = true;
+	}
+}
+
+// Every entity to draw this frame, with active proxies in place of the members they replace
+void HlodSystem::GetDrawList(const std::vector<std::shared_ptr<GameEntity>>& entities, std::vector<std::shared_ptr<GameEntity>>& drawList)
+{
+	drawList.clear();
+	for (int i = 0; i < entities.size(); i++)
+	{
+		if (i >= replaced.size() || !replaced[i])
+			drawList.push_back(entities[i]);
+	}
+
+	for (int c = 0; c < clusters.size(); c++)
+	{
+		if (clusters[c].proxyActive)
+			drawList.push_back(clusters[c].proxy);
+	}
+}
+
+int HlodSystem::GetActiveProxyCount()
+{
+	int count = 0;
+	for (int c = 0; c < clusters.size(); c++)
+		count += clusters[c].proxyActive ? 1 : 0;
+	return count;
+}
+
+// Proxies are made from the coarsest LOD of each static mesh, so they all have to be loaded
+bool HlodSystem::CanBuild(const std::vector<std::shared_ptr<GameEntity>>& entities)
+{
+	for (int i = 0; i < entities.size(); i++)
+	{
+		if (entities[i]->IsStatic() && !entities[i]->GetMesh()->IsReady())
+			return false;
+	}
+	return true;
+}
+
+// Clusters are made again when the entity list, which entities are static, or the cluster size changed
+bool HlodSystem::NeedsBuild(const std::vector<std::shared_ptr<GameEntity>>& entities, const HlodSettings& settings)
+{
+	if (!built || builtClusterRadius != settings.clusterRadius || builtStatic.size() != entities.size())
+		return true;
+
+	for (int i = 0; i < entities.size(); i++)
+	{
+		if (builtStatic[i] != entities[i]->IsStatic())
+			return true;
+	}
+	return false;
+}
+
+// --------------------------------------------------------
+// Groups static entities into clusters
+// - Greedy: the first entity not in a cluster yet starts one,
+//   and every later one centered within the cluster radius
+//   of it joins
+// - A lone entity's own LODs already do what a proxy would,
+//   so clusters need at least two members
+// - Meshes imported without a proxy source are left out
+// - No proxies are made yet, Update() asks for them once
+//   their clusters are far enough away
+// --------------------------------------------------------
+void HlodSystem::Build(const std::vector<std::shared_ptr<GameEntity>>& entities, const HlodSettings& settings)
+{
+	clusters.clear();
+	builtStatic.resize(entities.size());
+	entityClusters.assign(entities.size(), -1);
+
+	std::vector<bool> available(entities.size());
+	for (int i = 0; i < entities.size(); i++)
+	{
+		builtStatic[i] = entities[i]->IsStatic();
+		available[i] = entities[i]->IsStatic() && entities[i]->GetMesh()->GetProxySource().indices.size() > 0;
+	}
+
+	for (int i = 0; i < entities.size(); i++)
+	{
+		if (!available[i])
+			continue;
+
+		Cluster cluster = {};
+		cluster.members.push_back(i);
+		available[i] = false;
+
+		XMFLOAT3 seedCenter = entities[i]->GetWorldSphereCenter();
+		XMVECTOR seed = XMLoadFloat3(&seedCenter);
+		for (int j = i + 1; j < entities.size(); j++)
+		{
+			XMFLOAT3 center = entities[j]->GetWorldSphereCenter();
+			if (available[j] && XMVectorGetX(XMVector3Length(XMLoadFloat3(&center) - seed)) <= settings.clusterRadius)
+			{
+				cluster.members.push_back(j);
+				available[j] = false;
+			}
+		}
+
+		if (cluster.members.size() < 2)
+			continue;
+
+		for (int m = 0; m < cluster.members.size(); m++)
+		{
+			cluster.memberTriangles += entities[cluster.members[m]]->GetMesh()->GetLod(0).indexCount / 3;
+			entityClusters[cluster.members[m]] = (int)clusters.size();
+		}
+		RecordMembers(entities, cluster);
+		cluster.proxyDirty = true;
+		clusters.push_back(cluster);
+	}
+
+	builtClusterRadius = settings.clusterRadius;
+	built = true;
+}
+
+bool HlodSystem::MembersMoved(const std::vector<std::shared_ptr<GameEntity>>& entities, const Cluster& cluster)
+{
+	for (int m = 0; m < cluster.members.size(); m++)
+	{
+		// Dirty matrices are only rebuilt (and their versions bumped) on demand, so do that first
+		Transform* transform = entities[cluster.members[m]]->GetTransform();
+		transform->UpdateWorldMatrix();
+		if (transform->GetWorldMatrixVersion() != cluster.memberVersions[m])
+			return true;
+	}
+	return false;
+}
+
+// The old proxy shows the old positions, so it's dropped (along with one still being made)
+void HlodSystem::MarkMoved(const std::vector<std::shared_ptr<GameEntity>>& entities, Cluster& cluster)
+{
+	RecordMembers(entities, cluster);
+	cluster.proxy = 0;
+	cluster.pendingProxy = 0;
+	cluster.proxyDirty = true;
+	cluster.proxyActive = false;
+	cluster.moved = true;
+}
+
+// Notes the members' current world matrix versions, and the world space sphere around them
+void HlodSystem::RecordMembers(const std::vector<std::shared_ptr<GameEntity>>& entities, Cluster& cluster)
+{
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	cluster.memberVersions.clear();
+
+	for (int m = 0; m < cluster.members.size(); m++)
+	{
+		// Versions are read after the bounds, which rebuild the matrices if they were dirty
+		std::shared_ptr<GameEntity> entity = entities[cluster.members[m]];
+		XMFLOAT3 entityMin = entity->GetWorldBoundsMin();
+		XMFLOAT3 entityMax = entity->GetWorldBoundsMax();
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&entityMin));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&entityMax));
+		cluster.memberVersions.push_back(entity->GetTransform()->GetWorldMatrixVersion());
+	}
+
+	XMStoreFloat3(&cluster.center, (boundsMin + boundsMax) * 0.5f);
+	cluster.radius = XMVectorGetX(XMVector3Length(boundsMax - boundsMin)) * 0.5f;
+}
+
+// --------------------------------------------------------
+// Merges the members' coarsest LODs into the cluster's next
+// proxy, which the loader's workers then process
+// - Vertices are moved into world space, so the proxy entity
+//   keeps an identity transform
+// - Triangles are grouped by the material they're drawn with,
+//   giving the proxy one submesh per distinct material
+// - The proxy uses compact vertices when every member does,
+//   since then their materials all have compact shaders
+// --------------------------------------------------------
+void HlodSystem::RequestProxy(const std::vector<std::shared_ptr<GameEntity>>& entities, Cluster& cluster)
+{
+	MeshData data;
+	std::vector<std::shared_ptr<Material>> proxyMaterials;
+	std::vector<std::vector<unsigned int>> materialIndices;
+	bool compactVertices = true;
+
+	for (int m = 0; m < cluster.members.size(); m++)
+	{
+		std::shared_ptr<GameEntity> entity = entities[cluster.members[m]];
+		std::shared_ptr<Mesh> mesh = entity->GetMesh();
+		const MeshData& source = mesh->GetProxySource();
+		compactVertices = compactVertices && mesh->HasCompactVertices();
+
+		XMFLOAT4X4 worldMatrix = entity->GetTransform()->GetWorldMatrix();
+		XMFLOAT4X4 normalMatrix = entity->GetTransform()->GetNormalMatrix();
+		XMMATRIX world = XMLoadFloat4x4(&worldMatrix);
+		XMMATRIX normalTransform = XMLoadFloat4x4(&normalMatrix);
+
+		unsigned int baseVertex = (unsigned int)data.vertices.size();
+		for (int v = 0; v < source.vertices.size(); v++)
+		{
+			Vertex vertex = source.vertices[v];
+			XMStoreFloat3(&vertex.position, XMVector3TransformCoord(XMLoadFloat3(&vertex.position), world));
+			XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.normal), normalTransform)));
+			XMStoreFloat3(&vertex.tangent, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.tangent), world)));
+			data.vertices.push_back(vertex);
+		}
+
+		for (int s = 0; s < source.submeshes.size(); s++)
+		{
+			const MeshOptimizer::Submesh& submesh = source.submeshes[s];
+			std::shared_ptr<Material> material = entity->GetSubmeshMaterial(submesh.materialId);
+			int slot = (int)(std::find(proxyMaterials.begin(), proxyMaterials.end(), material) - proxyMaterials.begin());
+			if (slot == proxyMaterials.size())
+			{
+				proxyMaterials.push_back(material);
+				materialIndices.push_back(std::vector<unsigned int>());
+			}
+
+			for (unsigned int i = submesh.indexStart; i < submesh.indexStart + submesh.indexCount; i++)
+				materialIndices[slot].push_back(source.indices[i] + baseVertex);
+		}
+	}
+
+	// The material ranges become the proxy's submeshes, and its material ids are slots in proxyMaterials
+	for (int slot = 0; slot < materialIndices.size(); slot++)
+	{
+		MeshOptimizer::Submesh range = { (unsigned int)data.indices.size(), (unsigned int)materialIndices[slot].size(), slot };
+		data.indices.insert(data.indices.end(), materialIndices[slot].begin(), materialIndices[slot].end());
+		data.submeshes.push_back(range);
+	}
+
+	// With nothing to merge there's no proxy to wait for
+	if (data.indices.size() == 0)
+	{
+		cluster.proxy = 0;
+		cluster.proxyDirty = false;
+		return;
+	}
+
+	// Nothing reads a proxy's import stats, and measuring them would cost more than the rest of the processing
+	MeshImportOptions options;
+	options.compactVertices = compactVertices;
+	options.measureStats = false;
+	std::shared_ptr<Mesh> proxyMesh = meshLoader->ProcessAsync(std::move(data), options);
+
+	cluster.pendingProxy = std::make_shared<GameEntity>(proxyMesh, proxyMaterials[0]);
+	for (int slot = 0; slot < proxyMaterials.size(); slot++)
+		cluster.pendingProxy->SetSubmeshMaterial(slot, proxyMaterials[slot]);
+	cluster.pendingProxy->SetStatic(true);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "GameEntity.h"
+#include "MeshLoader.h"
+
+// How static entities are grouped into HLOD clusters, and when a cluster is drawn as its proxy
+struct HlodSettings
+{
+	bool enabled = true;
+	float clusterRadius = 10.0f;	// Entities centered this close to a cluster's first entity join it
+	float switchDistance = 40.0f;	// Clusters farther than this from the camera (to their bounds) draw as their proxy
+	float hysteresis = 0.1f;		// A proxy stays until the cluster is this fraction closer than the switch distance
+};
+
+// --------------------------------------------------------
+// Hierarchical LOD proxies for groups of static entities
+//
+// - Static entities near each other are grouped into
+//   clusters, and the coarsest LOD of every member is merged,
+//   in world space, into one proxy Mesh per cluster
+// - Past the switch distance a cluster's members are swapped
+//   for its proxy, which costs one draw per material and one
+//   per shadow view, instead of that much per member
+// - The merged mesh goes through the regular import
+//   processing (minus its stats) on MeshLoader's workers, so
+//   it gets its own LODs and meshlets, and those simplify
+//   further than the members' since their error limit grows
+//   with the (bigger) cluster
+// - Proxies are only made for clusters near or past the
+//   switch distance, and the members are drawn until theirs
+//   is ready
+// - Clusters are made once every static mesh has loaded, and
+//   made again when entities change; a cluster whose member
+//   moved drops its proxy, so it never shows stale positions,
+//   and gets a new one once its members hold still
+// - Moved members are found through TransformSystem's change
+//   journal, which lists them by entity index, so a frame
+//   where nothing moved doesn't look at any cluster
+// - Only used from the render thread
+// --------------------------------------------------------
+class HlodSystem
+{
+public:
+	struct Cluster
+	{
+		std::vector<int> members;					// Indices into the entity list
+		std::vector<unsigned int> memberVersions;	// World matrix version of each member when the cluster last checked
+		std::shared_ptr<GameEntity> proxy;			// Null until made, and if the merged mesh came out empty
+		std::shared_ptr<GameEntity> pendingProxy;	// Being processed by a loader worker, not drawable yet
+		DirectX::XMFLOAT3 center;					// World space sphere around every member
+		float radius;
+		unsigned int memberTriangles;				// LOD 0 triangles of every member, to compare with the proxy
+		bool proxyDirty;							// The members changed since the proxy was made, or it never was
+		bool moved;									// A member moved during the last Update()
+		bool proxyActive;							// Drawn as the proxy since the last Update()
+	};
+
+	// The loader must outlive this, since it processes the proxies
+	HlodSystem(MeshLoader* meshLoader);
+
+	void Update(const std::vector<std::shared_ptr<GameEntity>>& entities, DirectX::XMFLOAT3 cameraPosition, const HlodSettings& settings);
+	void GetDrawList(const std::vector<std::shared_ptr<GameEntity>>& entities, std::vector<std::shared_ptr<GameEntity>>& drawList);
+
+	bool IsBuilt() { return built; }
+	const std::vector<Cluster>& GetClusters() { return clusters; }
+	int GetActiveProxyCount();
+
+private:
+	bool CanBuild(const std::vector<std::shared_ptr<GameEntity>>& entities);
+	bool NeedsBuild(const std::vector<std::shared_ptr<GameEntity>>& entities, const HlodSettings& settings);
+	void Build(const std::vector<std::shared_ptr<GameEntity>>& entities, const HlodSettings& settings);
+	bool MembersMoved(const std::vector<std::shared_ptr<GameEntity>>& entities, const Cluster& cluster);
+	void MarkMoved(const std::vector<std::shared_ptr<GameEntity>>& entities, Cluster& cluster);
+	void RecordMembers(const std::vector<std::shared_ptr<GameEntity>>& entities, Cluster& cluster);
+	void RequestProxy(const std::vector<std::shared_ptr<GameEntity>>& entities, Cluster& cluster);
+
+	MeshLoader* meshLoader;
+
+	std::vector<Cluster> clusters;
+	std::vector<int> entityClusters;	// By entity, the cluster it's a member of, or -1
+	std::vector<bool> replaced;			// By entity, whether an active proxy draws it instead
+	std::vector<bool> builtStatic;		// By entity, whether it was static when the clusters were made
+	float builtClusterRadius;
+	bool built;
+};
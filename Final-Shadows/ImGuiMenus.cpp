@@ -1,12 +1,50 @@
 #include <DirectXMath.h>
 #include "ImGuiMenus.h"
 #include "Helpers.h"
+#include "ObjParser.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "TangentGenerator.h"
+#include "GeometryPool.h"
+#include "TransformSystem.h"
 using namespace DirectX;
 
+namespace
+{
+	// One row of the import benchmark table
+	struct ImportBenchmarkRow
+	{
+		std::string fileName;
+		ObjParser::Backend backend;
+		ObjParser::BenchmarkResult result;
+	};
+
+	std::vector<ImportBenchmarkRow> importBenchmarkRows;
+
+	// One model of the mesh codec benchmark table
+	struct CodecBenchmarkRow
+	{
+		std::string fileName;
+		MeshCodec::BenchmarkResult result;
+	};
+
+	std::vector<CodecBenchmarkRow> codecBenchmarkRows;
+
+	// One model of the tangent generation benchmark table
+	struct TangentBenchmarkRow
+	{
+		std::string fileName;
+		TangentGenerator::BenchmarkResult result;
+	};
+
+	std::vector<TangentBenchmarkRow> tangentBenchmarkRows;
+}
+
 // ------------------------------------------------------------------
 // Dislpay the program status in a small window
 // ------------------------------------------------------------------
-void ImGuiMenus::WindowStats(int windowWidth, int windowHeight)
+void ImGuiMenus::WindowStats(int windowWidth, int windowHeight,
+	const MeshletCulling::Stats& cameraMeshlets, const MeshletCulling::Stats& shadowMeshlets, unsigned int geometryBinds)
 {
 	ImGui::Begin("Window Stats");
 
@@ -16,6 +54,62 @@ void ImGuiMenus::WindowStats(int windowWidth, int windowHeight)
 
 	ImGui::Spacing();
 
+	// Culled by the frustum, then by normal cone, as a share of every meshlet tested
+	ImGui::Text("Camera meshlets culled: %.1f%% of %u (frustum %u, cone %u)",
+		MeshletCulling::CulledRatio(cameraMeshlets) * 100.0f, cameraMeshlets.tested,
+		cameraMeshlets.frustumCulled, cameraMeshlets.coneCulled);
+	ImGui::Text("Shadow meshlets culled: %.1f%% of %u (frustum %u, cone %u)",
+		MeshletCulling::CulledRatio(shadowMeshlets) * 100.0f, shadowMeshlets.tested,
+		shadowMeshlets.frustumCulled, shadowMeshlets.coneCulled);
+
+	ImGui::Spacing();
+
+	TransformSystem& transforms = TransformSystem::GetInstance();
+	ImGui::Text("Transforms: %u (%u world matrices rebuilt last frame, %u entities moved)", transforms.GetCount(),
+		transforms.GetLastUpdateCount(), transforms.GetLastChangedCount());
+
+	ImGui::Spacing();
+
+	// Every mesh draws out of these buffers, so binds only happen when the vertex format changes
+	ImGui::Text("Geometry buffer binds last frame: %u", geometryBinds);
+	std::vector<GeometryPool::BufferStats> poolStats;
+	GeometryPool::GetInstance().GetStats(poolStats);
+	if (ImGui::BeginTable("Geometry Pool", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Buffer");
+		ImGui::TableSetupColumn("Used");
+		ImGui::TableSetupColumn("Capacity");
+		ImGui::TableSetupColumn("Free blocks");
+		ImGui::TableSetupColumn("Largest free");
+		ImGui::TableSetupColumn("Fragmentation");
+		ImGui::TableHeadersRow();
+
+		for (int i = 0; i < poolStats.size(); i++)
+		{
+			// The index buffer always comes last
+			bool indexBuffer = i == poolStats.size() - 1;
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			if (indexBuffer)
+				ImGui::Text("Indices");
+			else
+				ImGui::Text("Vertices (%u B)", poolStats[i].stride);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u (%.2f MB)", poolStats[i].used, poolStats[i].used * poolStats[i].stride / (1024.0f * 1024.0f));
+			ImGui::TableNextColumn();
+			ImGui::Text("%u (%.2f MB)", poolStats[i].capacity, poolStats[i].capacity * poolStats[i].stride / (1024.0f * 1024.0f));
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", poolStats[i].freeBlocks);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", poolStats[i].largestFreeBlock);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f%%", poolStats[i].fragmentation * 100.0f);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::Spacing();
+
 	if (ImGui::Button(ImGuiMenus::showUiDemoWindow ? "Hide ImGui demo window" : "Show ImGui demo window"))
 		ImGuiMenus::showUiDemoWindow = !ImGuiMenus::showUiDemoWindow;
 
@@ -34,7 +128,10 @@ void ImGuiMenus::EditScene(
 	std::shared_ptr<Camera> cam,
 	std::vector<std::shared_ptr<GameEntity>> entities,
 	std::vector<std::shared_ptr<Material>> materials,
-	std::vector<Light>* lights
+	std::vector<Light>* lights,
+	LodSettings* lodSettings,
+	HlodSystem* hlod,
+	HlodSettings* hlodSettings
 	)
 {
 	ImGui::Begin("Edit Scene");
@@ -89,6 +186,12 @@ void ImGuiMenus::EditScene(
 		{
 			ImGui::Spacing();
 
+			// LOD selection, shared by every entity
+			ImGui::SliderFloat("LOD max pixel error", &lodSettings->maxPixelError, 0.1f, 16.0f);
+			ImGui::SliderFloat("LOD hysteresis", &lodSettings->hysteresis, 0.0f, 0.9f);
+			ImGui::SliderInt("Force LOD (-1 for auto)", &lodSettings->forcedLod, -1, MeshOptimizer::maxLodCount - 1);
+			ImGui::Spacing();
+
 			for (int i = 0; i < entities.size(); i++)
 			{
 				ImGui::PushID(i);
@@ -100,6 +203,33 @@ void ImGuiMenus::EditScene(
 					XMFLOAT3 rot = Rad2DegFromVector(transform->GetRotationPitchYawRoll());
 					XMFLOAT3 scale = transform->GetScale();
 
+					// Parent, by entity, found from its transform
+					int parent = -1;
+					for (int p = 0; p < entities.size(); p++)
+					{
+						if (entities[p]->GetTransform()->GetIndex() == transform->GetParentIndex())
+							parent = p;
+					}
+
+					std::string parentName = parent >= 0 ? "Entity " + std::to_string(parent) : "None";
+					if (ImGui::BeginCombo("Parent", parentName.c_str()))
+					{
+						if (ImGui::Selectable("None", parent < 0))
+							transform->SetParent(nullptr, true);
+
+						for (int p = 0; p < entities.size(); p++)
+						{
+							// SetParent() refuses itself and its own children
+							std::string name = "Entity " + std::to_string(p);
+							if (ImGui::Selectable(name.c_str(), p == parent))
+								transform->SetParent(entities[p]->GetTransform(), true);
+						}
+						ImGui::EndCombo();
+					}
+
+					if (transform->HasParent())
+						ImGui::Text("Position, rotation and scale are relative to the parent");
+
 					if (ImGui::DragFloat3("Position", &pos.x, 0.01f))
 						transform->SetPosition(pos);
 
@@ -120,9 +250,62 @@ void ImGuiMenus::EditScene(
 					if (ImGui::DragFloat3("Scale", &scale.x, 0.01f))
 						transform->SetScale(scale);
 
+					bool isStatic = entities[i]->IsStatic();
+					if (ImGui::Checkbox("Static (can merge into HLOD proxies)", &isStatic))
+						entities[i]->SetStatic(isStatic);
+
+					XMFLOAT3 boundsMin = entities[i]->GetWorldBoundsMin();
+					XMFLOAT3 boundsMax = entities[i]->GetWorldBoundsMax();
+					XMFLOAT3 sphereCenter = entities[i]->GetWorldSphereCenter();
+					ImGui::Text("World AABB: (%.2f, %.2f, %.2f) to (%.2f, %.2f, %.2f)",
+						boundsMin.x, boundsMin.y, boundsMin.z, boundsMax.x, boundsMax.y, boundsMax.z);
+					ImGui::Text("World sphere: (%.2f, %.2f, %.2f), radius %.2f",
+						sphereCenter.x, sphereCenter.y, sphereCenter.z, entities[i]->GetWorldSphereRadius());
+
 					// Mesh details
 					ImGui::Spacing();
+					MeshOptimizer::ImportStats stats = entities[i]->GetMesh()->GetImportStats();
 					ImGui::Text("Mesh index count: %d", entities[i]->GetMesh()->GetIndexCount());
+					ImGui::Text("Vertices: %d imported, %d after welding", stats.weld.vertexCountBefore, stats.weld.vertexCountAfter);
+					ImGui::Text("Triangles: %d (%d degenerate removed)", stats.weld.triangleCountAfter, stats.weld.degenerateTriangles);
+					ImGui::Text("FIFO %d ACMR: %.3f -> %.3f, ATVR: %.3f -> %.3f", MeshOptimizer::fifoCacheSize,
+						stats.fifoBefore.acmr, stats.fifoAfter.acmr, stats.fifoBefore.atvr, stats.fifoAfter.atvr);
+					ImGui::Text("LRU %d ACMR: %.3f -> %.3f, ATVR: %.3f -> %.3f", MeshOptimizer::lruCacheSize,
+						stats.lruBefore.acmr, stats.lruAfter.acmr, stats.lruBefore.atvr, stats.lruAfter.atvr);
+					ImGui::Text("Overdraw (%d views): %.3f -> %.3f", MeshOptimizer::overdrawDirections,
+						stats.overdrawBefore.overdraw, stats.overdrawAfter.overdraw);
+					ImGui::Text("Vertex fetch hit rate: %.1f%% -> %.1f%%, overfetch: %.2f -> %.2f",
+						stats.fetchBefore.hitRate * 100.0f, stats.fetchAfter.hitRate * 100.0f, stats.fetchBefore.overfetch, stats.fetchAfter.overfetch);
+					ImGui::Text("Loaded from: %s", entities[i]->GetMesh()->WasLoadedFromCache() ? "Mesh cache" : "OBJ text");
+
+					// Levels of detail, with the level the camera picked last frame
+					std::shared_ptr<Mesh> mesh = entities[i]->GetMesh();
+					ImGui::Text("Camera LOD: %d of %d", entities[i]->GetSelectedLod(0), mesh->GetLodCount());
+					for (int l = 0; l < mesh->GetLodCount(); l++)
+					{
+						MeshOptimizer::LodLevel lod = mesh->GetLod(l);
+						ImGui::Text("  LOD %d: %u triangles in %u meshlets, error %.5f (%.3f%% of radius)", l, lod.indexCount / 3, lod.meshletCount, lod.error,
+							mesh->GetBoundingSphereRadius() > 0.0f ? lod.error / mesh->GetBoundingSphereRadius() * 100.0f : 0.0f);
+					}
+
+					// Material ranges of the full mesh, each drawn with its own call
+					ImGui::Text("Submeshes: %d", mesh->GetSubmeshCount());
+					for (int s = 0; s < mesh->GetSubmeshCount(); s++)
+					{
+						MeshOptimizer::Submesh submesh = mesh->GetSubmesh(0, s);
+						const char* materialName = submesh.materialId >= 0 && submesh.materialId < mesh->GetMaterialNames().size() ?
+							mesh->GetMaterialNames()[submesh.materialId].c_str() : "(none)";
+						ImGui::Text("  %d: %u triangles, material %s", s, submesh.indexCount / 3, materialName);
+					}
+
+					ImGui::Text("Vertex format: %s (%u bytes)", entities[i]->GetMesh()->HasCompactVertices() ? "Compact" : "Full",
+						entities[i]->GetMesh()->GetVertexStride());
+					if (entities[i]->GetMesh()->HasCompactVertices())
+					{
+						VertexCompression::ErrorStats error = entities[i]->GetMesh()->GetCompressionError();
+						ImGui::Text("Max error: position %.6f, normal %.4f deg, tangent %.4f deg, uv %.6f",
+							error.maxPositionError, error.maxNormalError, error.maxTangentError, error.maxUvError);
+					}
 
 
 					ImGui::TreePop();
@@ -288,8 +471,245 @@ void ImGuiMenus::EditScene(
 			ImGui::EndTabItem();
 		}
 
+		// Clusters of static entities and the proxies that replace them far from the camera
+		if (ImGui::BeginTabItem("HLOD"))
+		{
+			ImGui::Spacing();
+
+			ImGui::Checkbox("Draw proxies", &hlodSettings->enabled);
+			ImGui::SliderFloat("Cluster radius", &hlodSettings->clusterRadius, 1.0f, 50.0f);
+			ImGui::SliderFloat("Switch distance", &hlodSettings->switchDistance, 1.0f, 200.0f);
+			ImGui::SliderFloat("Switch hysteresis", &hlodSettings->hysteresis, 0.0f, 0.9f);
+			ImGui::Spacing();
+
+			if (!hlod->IsBuilt())
+				ImGui::Text("Waiting for static meshes to load");
+
+			const std::vector<HlodSystem::Cluster>& clusters = hlod->GetClusters();
+			ImGui::Text("Clusters: %d, drawn as proxies: %d", (int)clusters.size(), hlod->GetActiveProxyCount());
+			for (int c = 0; c < clusters.size(); c++)
+			{
+				ImGui::PushID(c);
+				if (ImGui::TreeNode("Cluster Node", "Cluster %d%s", c, clusters[c].proxyActive ? " (proxy)" : ""))
+				{
+					ImGui::Text("Entities:");
+					for (int m = 0; m < clusters[c].members.size(); m++)
+					{
+						ImGui::SameLine();
+						ImGui::Text("%d", clusters[c].members[m]);
+					}
+					ImGui::Text("Sphere: (%.2f, %.2f, %.2f), radius %.2f",
+						clusters[c].center.x, clusters[c].center.y, clusters[c].center.z, clusters[c].radius);
+
+					std::shared_ptr<GameEntity> proxy = clusters[c].proxy;
+					if (proxy)
+					{
+						std::shared_ptr<Mesh> mesh = proxy->GetMesh();
+						ImGui::Text("Proxy: %u triangles (entities: %u), %d submeshes, %d LODs",
+							mesh->GetLod(0).indexCount / 3, clusters[c].memberTriangles, mesh->GetSubmeshCount(), mesh->GetLodCount());
+						ImGui::Text("Camera LOD: %d", proxy->GetSelectedLod(0));
+					}
+					else if (clusters[c].pendingProxy)
+					{
+						ImGui::Text("Proxy: being made");
+					}
+					else if (clusters[c].proxyDirty)
+					{
+						ImGui::Text("Proxy: none yet (made near the switch distance)");
+					}
+					else
+					{
+						ImGui::Text("Proxy: none (merged mesh was empty)");
+					}
+
+					ImGui::TreePop();
+				}
+				ImGui::PopID();
+			}
+
+			ImGui::EndTabItem();
+		}
+
 		ImGui::EndTabBar();
 	}
 
 	ImGui::End();
 }
+
+// ------------------------------------------------------------------
+// Time every OBJ parser backend on the bundled models, and
+// compare cached mesh sizes and decode speeds per format
+// - Runs on demand since it stalls the frame for a few seconds
+// ------------------------------------------------------------------
+void ImGuiMenus::MeshImport(const std::vector<std::wstring>& modelFiles, int meshesLoading,
+	double firstFrameMilliseconds, double meshesLoadedMilliseconds)
+{
+	ImGui::Begin("Mesh Import");
+
+	// Startup times, measured from the start of Game::Init()
+	ImGui::Text("First frame: %.1fms", firstFrameMilliseconds);
+	if (meshesLoading > 0)
+		ImGui::Text("Meshes loading: %d", meshesLoading);
+	else
+		ImGui::Text("All meshes loaded: %.1fms", meshesLoadedMilliseconds);
+
+	ImGui::Spacing();
+
+	if (ImGui::Button("Run import benchmark"))
+	{
+		importBenchmarkRows.clear();
+
+		ObjParser::Backend backends[] = { ObjParser::Stream, ObjParser::Mapped, ObjParser::Parallel };
+		for (int i = 0; i < modelFiles.size(); i++)
+		{
+			std::wstring fileName = modelFiles[i].substr(modelFiles[i].find_last_of(L"\\/") + 1);
+			for (int b = 0; b < ARRAYSIZE(backends); b++)
+			{
+				ImportBenchmarkRow row;
+				row.fileName = WideToNarrow(fileName);
+				row.backend = backends[b];
+				row.result = ObjParser::Benchmark(modelFiles[i].c_str(), backends[b], 5);
+				importBenchmarkRows.push_back(row);
+			}
+		}
+	}
+
+	if (importBenchmarkRows.size() > 0 && ImGui::BeginTable("Import Results", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("File");
+		ImGui::TableSetupColumn("Backend");
+		ImGui::TableSetupColumn("Size (MB)");
+		ImGui::TableSetupColumn("Time (ms)");
+		ImGui::TableSetupColumn("MB/s");
+		ImGui::TableHeadersRow();
+
+		for (int i = 0; i < importBenchmarkRows.size(); i++)
+		{
+			ImportBenchmarkRow& row = importBenchmarkRows[i];
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", row.fileName.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", ObjParser::BackendToString(row.backend));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", row.result.fileBytes / (1024.0 * 1024.0));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", row.result.milliseconds);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", row.result.megabytesPerSecond);
+		}
+
+		ImGui::EndTable();
+	}
+
+	ImGui::Spacing();
+
+	// Uses the cache files written on startup
+	if (ImGui::Button("Run codec benchmark"))
+	{
+		codecBenchmarkRows.clear();
+
+		for (int i = 0; i < modelFiles.size(); i++)
+		{
+			MeshCache::Contents contents;
+			if (!MeshCache::Load(modelFiles[i].c_str(), contents))
+				continue;
+
+			CodecBenchmarkRow row;
+			row.fileName = WideToNarrow(modelFiles[i].substr(modelFiles[i].find_last_of(L"\\/") + 1));
+			row.result = MeshCodec::Benchmark(contents.vertices, contents.indices, 5);
+			codecBenchmarkRows.push_back(row);
+		}
+	}
+
+	if (codecBenchmarkRows.size() > 0 && ImGui::BeginTable("Codec Results", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("File");
+		ImGui::TableSetupColumn("Format");
+		ImGui::TableSetupColumn("Size (MB)");
+		ImGui::TableSetupColumn("Ratio");
+		ImGui::TableSetupColumn("Decode (ms)");
+		ImGui::TableSetupColumn("GB/s");
+		ImGui::TableHeadersRow();
+
+		for (int i = 0; i < codecBenchmarkRows.size(); i++)
+		{
+			CodecBenchmarkRow& row = codecBenchmarkRows[i];
+			for (int f = 0; f < MeshCodec::FormatCount; f++)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", row.fileName.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", MeshCodec::FormatToString((MeshCodec::Format)f));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", row.result.bytes[f] / (1024.0 * 1024.0));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", (double)row.result.bytes[f] / row.result.decodedBytes);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", row.result.milliseconds[f]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", row.result.gigabytesPerSecond[f]);
+			}
+		}
+
+		ImGui::EndTable();
+	}
+
+	ImGui::Spacing();
+
+	// Tangents of LOD 0, the only level they're generated from
+	if (ImGui::Button("Run tangent benchmark"))
+	{
+		tangentBenchmarkRows.clear();
+
+		for (int i = 0; i < modelFiles.size(); i++)
+		{
+			MeshCache::Contents contents;
+			if (!MeshCache::Load(modelFiles[i].c_str(), contents))
+				continue;
+
+			TangentBenchmarkRow row;
+			row.fileName = WideToNarrow(modelFiles[i].substr(modelFiles[i].find_last_of(L"\\/") + 1));
+			row.result = TangentGenerator::Benchmark(contents.vertices, &contents.indices[contents.header.lods[0].indexStart],
+				(int)contents.header.lods[0].indexCount, 10);
+			tangentBenchmarkRows.push_back(row);
+		}
+	}
+
+	if (tangentBenchmarkRows.size() > 0 && ImGui::BeginTable("Tangent Results", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("File");
+		ImGui::TableSetupColumn("Triangles");
+		ImGui::TableSetupColumn("Scalar (ms)");
+		ImGui::TableSetupColumn("SSE (ms)");
+		ImGui::TableSetupColumn("SSE threaded (ms)");
+		ImGui::TableSetupColumn("Speedup");
+		ImGui::TableSetupColumn("Max difference");
+		ImGui::TableHeadersRow();
+
+		for (int i = 0; i < tangentBenchmarkRows.size(); i++)
+		{
+			TangentGenerator::BenchmarkResult& result = tangentBenchmarkRows[i].result;
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", tangentBenchmarkRows[i].fileName.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%d", result.triangleCount);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", result.scalarMilliseconds);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", result.simdMilliseconds);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f (%u threads)", result.threadedMilliseconds, result.threadCount);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2fx", result.threadedMilliseconds > 0.0 ? result.scalarMilliseconds / result.threadedMilliseconds : 0.0);
+			ImGui::TableNextColumn();
+			ImGui::Text("%g", result.maxDifference);
+		}
+
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
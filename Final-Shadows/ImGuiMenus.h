@@ -2,22 +2,30 @@
 
 #include <vector>
 #include <memory>
+#include <string>
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui/imgui_impl_win32.h"
 #include "Camera.h"
 #include "GameEntity.h"
+#include "HlodSystem.h"
 #include "Lights.h"
 
 namespace ImGuiMenus
 {
-	void WindowStats(int windowWidth, int windowHeight);
+	void WindowStats(int windowWidth, int windowHeight,
+		const MeshletCulling::Stats& cameraMeshlets, const MeshletCulling::Stats& shadowMeshlets, unsigned int geometryBinds);
 	void EditScene(
 		std::shared_ptr<Camera> cam,
 		std::vector<std::shared_ptr<GameEntity>> entities,
 		std::vector<std::shared_ptr<Material>> materials,
-		std::vector<Light>* lights
+		std::vector<Light>* lights,
+		LodSettings* lodSettings,
+		HlodSystem* hlod,
+		HlodSettings* hlodSettings
 	);
+	void MeshImport(const std::vector<std::wstring>& modelFiles, int meshesLoading,
+		double firstFrameMilliseconds, double meshesLoadedMilliseconds);
 
 	static bool showUiDemoWindow = false;
 }
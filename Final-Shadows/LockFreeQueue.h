@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+// --------------------------------------------------------
+// Bounded lock-free queue that any number of threads can
+// push to and pop from (Dmitry Vyukov's MPMC ring buffer)
+//
+// - Every cell has a sequence number telling whether it's
+//   ready to be written or read in the current lap around
+//   the ring, so a push or pop is a single compare-exchange
+//   on the enqueue/dequeue position
+// - TryPush() fails when the queue is full and TryPop() when
+//   it's empty, neither ever blocks
+// - Capacity must be a power of two
+// --------------------------------------------------------
+template<typename T>
+class LockFreeQueue
+{
+public:
+	explicit LockFreeQueue(size_t capacity)
+		:
+		cells(capacity),
+		mask(capacity - 1),
+		enqueuePosition(0),
+		dequeuePosition(0)
+	{
+		for (size_t i = 0; i < capacity; i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	bool TryPush(T&& value)
+	{
+		size_t position = enqueuePosition.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;)
+		{
+			cell = &cells[position & mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+			if (difference == 0)
+			{
+				// The cell is free in this lap, try to claim it
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0)
+			{
+				// The cell still holds a value from the previous lap
+				return false;
+			}
+			else
+			{
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->value = std::move(value);
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool TryPop(T& value)
+	{
+		size_t position = dequeuePosition.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;)
+		{
+			cell = &cells[position & mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)(position + 1);
+			if (difference == 0)
+			{
+				// The cell holds a value in this lap, try to claim it
+				if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0)
+			{
+				// Nothing has been pushed here yet
+				return false;
+			}
+			else
+			{
+				position = dequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		value = std::move(cell->value);
+		cell->sequence.store(position + mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	// Cells are never reallocated, so the atomics inside them never move
+	std::vector<Cell> cells;
+	size_t mask;
+
+	// Padded onto separate cache lines, since pushing and popping threads each hammer one
+	// (padding rather than alignas, so heap allocated owners need no over-aligned new)
+	char padding0[64];
+	std::atomic<size_t> enqueuePosition;
+	char padding1[64];
+	std::atomic<size_t> dequeuePosition;
+	char padding2[64];
+};
@@ -0,0 +1,37 @@
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const wchar_t* path)
+	:
+	file(INVALID_HANDLE_VALUE),
+	mapping(0),
+	data(0),
+	size(0)
+{
+	// The file is read front to back, so let the OS read ahead aggressively
+	file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	// Empty files can't be mapped, treat them the same as a missing file
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		return;
+
+	mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping == 0)
+		return;
+
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data != 0)
+		size = (size_t)fileSize.QuadPart;
+}
+
+MappedFile::~MappedFile()
+{
+	if (data != 0)
+		UnmapViewOfFile(data);
+	if (mapping != 0)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Windows.h>
+
+// --------------------------------------------------------
+// A read-only view of an entire file on disk
+//
+// - The OS pages the file in on demand, so nothing is
+//   copied into a separate buffer before it is read
+// - The view is NOT null-terminated, always use GetSize()
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const wchar_t* path);
+	~MappedFile();
+
+	// Owns OS handles, so copying would close them twice
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsOpen() { return data != 0; }
+	const char* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const char* data;
+	size_t size;
+};
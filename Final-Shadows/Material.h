@@ -20,6 +20,7 @@ public:
 	);
 
 	std::shared_ptr<SimpleVertexShader> GetVertexShader() { return vertexShader; }
+	std::shared_ptr<SimpleVertexShader> GetCompactVertexShader() { return compactVertexShader; }
 	std::shared_ptr<SimplePixelShader> GetPixelShader() { return pixelShader; }
 	const char* GetName() { return name; }
 	DirectX::XMFLOAT4 GetColorTint() { return colorTint; }
@@ -29,6 +30,7 @@ public:
 	DirectX::XMFLOAT2 GetTextureOffset() { return textureOffset; }
 
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> vxShader) { vertexShader = vxShader; }
+	void SetCompactVertexShader(std::shared_ptr<SimpleVertexShader> vxShader) { compactVertexShader = vxShader; }
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> pxShader) { pixelShader = pxShader; }
 	void SetName(const char* val) { name = val; }
 	void SetColorTint(DirectX::XMFLOAT4 color) { colorTint = color; }
@@ -48,6 +50,7 @@ public:
 
 private:
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimpleVertexShader> compactVertexShader;	// Same shader for meshes with CompactVertex data
 	std::shared_ptr<SimplePixelShader> pixelShader;
 
 	const char* name;
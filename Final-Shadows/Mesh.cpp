@@ -1,11 +1,13 @@
-#include <fstream>
 #include <vector>
 #include <iostream>
+#include <climits>
+#include <cstring>
 #include "Mesh.h"
 #include "Helpers.h"
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "TinyObj/tiny_obj_loader.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "TangentGenerator.h"
+#include "GeometryPool.h"
 
 using namespace DirectX;
 
@@ -13,495 +15,638 @@ Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCo
            Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
 	:
 	indexCount(indexCount),
+	importStats(),
+	loadedFromCache(false),
+	compactVertices(false),
+	keepProxySource(false),
+	vertexStride(sizeof(Vertex)),
+	decodeParams(),
+	compressionError(),
+	geometry(),
+	positions(),
+	submeshes(),
+	proxySource(),
+	materialNames(),
+	lods(),
+	meshlets(),
+	boundsMin(0.0f, 0.0f, 0.0f),
+	boundsMax(0.0f, 0.0f, 0.0f),
+	boundingSphereCenter(0.0f, 0.0f, 0.0f),
+	boundingSphereRadius(0.0f),
 	context(context)
 {
-	CalculateTangents(vertices, vertexCount, indices, indexCount);
-	CreateVertexIndexBuffers(vertices, vertexCount, indices, indexCount, device);
+	// Hand-built geometry is already indexed and ordered, so nothing gets welded or reordered
+	importStats.weld.vertexCountBefore = importStats.weld.vertexCountAfter = vertexCount;
+	importStats.weld.triangleCountBefore = importStats.weld.triangleCountAfter = indexCount / 3;
+
+	std::vector<unsigned int> indexList(indices, indices + indexCount);
+	importStats.fifoBefore = importStats.fifoAfter = MeshOptimizer::AnalyzeVertexCache(indexList, vertexCount, MeshOptimizer::fifoCacheSize, MeshOptimizer::CacheFIFO);
+	importStats.lruBefore = importStats.lruAfter = MeshOptimizer::AnalyzeVertexCache(indexList, vertexCount, MeshOptimizer::lruCacheSize, MeshOptimizer::CacheLRU);
+
+	std::vector<Vertex> vertexList(vertices, vertices + vertexCount);
+	importStats.overdrawBefore = importStats.overdrawAfter = MeshOptimizer::EstimateOverdraw(vertexList, indexList,
+		MeshOptimizer::overdrawDirections, MeshOptimizer::overdrawResolution);
+	importStats.fetchBefore = importStats.fetchAfter = MeshOptimizer::AnalyzeVertexFetch(indexList, vertexCount, sizeof(Vertex));
+
+	MeshOptimizer::LodLevel full = { 0, (unsigned int)indexCount, 0.0f, 0, 0 };
+	MeshOptimizer::BuildMeshlets(vertexList, indexList, full, meshlets);
+	lods.push_back(full);
+	MeshOptimizer::Submesh all = { 0, (unsigned int)indexCount, -1 };
+	submeshes.push_back(all);
+
+	TangentGenerator::Calculate(vertices, vertexCount, indices, indexCount);
+	CreateVertexIndexBuffers(vertices, vertexCount, indices, indexCount);
+}
+
+// Create a mesh by loading it from a OBJ file with one of the ObjParser backends
+// - Every backend produces identical vertices, Mapped and Parallel are just much faster on large files
+// - This loads on the calling thread, MeshLoader does the same work on worker threads
+Mesh::Mesh(const wchar_t* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	MeshImportOptions options)
+	: Mesh(context, options)
+{
+	MeshData data;
+	if (Import(objFile, options, data))
+		Upload(data, device);
 }
 
-Mesh::Mesh(const wchar_t* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+// Create an empty mesh that draws nothing until Upload() gives it data
+Mesh::Mesh(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, MeshImportOptions options)
+	:
+	indexCount(0),
+	importStats(),
+	loadedFromCache(false),
+	compactVertices(options.compactVertices),
+	keepProxySource(options.keepProxySource),
+	vertexStride(sizeof(Vertex)),
+	decodeParams(),
+	compressionError(),
+	geometry(),
+	positions(),
+	submeshes(),
+	proxySource(),
+	materialNames(),
+	lods(),
+	meshlets(),
+	boundsMin(0.0f, 0.0f, 0.0f),
+	boundsMax(0.0f, 0.0f, 0.0f),
+	boundingSphereCenter(0.0f, 0.0f, 0.0f),
+	boundingSphereRadius(0.0f),
+	context(context)
+{
+}
+
+// Create a mesh by loading it from a OBJ file with the use of tinyobjloader
+// - Faces are grouped by their material, giving one submesh per material the file uses
+Mesh::Mesh(std::string objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
 	:
+	indexCount(0),
+	importStats(),
+	loadedFromCache(false),
+	compactVertices(false),
+	keepProxySource(false),
+	vertexStride(sizeof(Vertex)),
+	decodeParams(),
+	compressionError(),
+	geometry(),
+	positions(),
+	submeshes(),
+	proxySource(),
+	materialNames(),
+	lods(),
+	meshlets(),
+	boundsMin(0.0f, 0.0f, 0.0f),
+	boundsMax(0.0f, 0.0f, 0.0f),
+	boundingSphereCenter(0.0f, 0.0f, 0.0f),
+	boundingSphereRadius(0.0f),
 	context(context)
 {
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-	// 
-	// - You are allowed to directly copy/paste this into your code base
-	//   for assignments, given that you clearly cite that this is not
-	//   code of your own design.
-	//
-	// - NOTE: You'll need to #include <fstream>
-	
-	
-	// File input object
-	std::ifstream obj(objFile);
-	
-	// Check for successful open
-	if (!obj.is_open())
+	MeshData data;
+	std::wstring filePath = FixPath(NarrowToWide(objFile));
+	if (!ObjParser::LoadTinyObj(filePath.c_str(), data.vertices, data.indices, data.submeshes, materialNames))
+		return;
+
+	ProcessImport(data);
+	Upload(data, device);
+}
+
+Mesh::~Mesh()
+{
+	GeometryPool::GetInstance().Free(geometry);
+	GeometryPool::GetInstance().Free(positions);
+}
+
+void Mesh::Draw(int lod)
+{
+	if (lods.size() == 0 || !geometry.valid)
+		return;
+
+	lod = lod < 0 ? 0 : (lod < lods.size() ? lod : (int)lods.size() - 1);
+
+	// Every mesh with this vertex format shares the same buffers,
+	// so they're only set in the input assembler (IA) stage when
+	// the format changes or a new pass begins
+	GeometryPool::GetInstance().Bind(vertexStride);
+
+	// Tell Direct3D to draw
+	//  - Begins the rendering pipeline on the GPU
+	//  - Do this ONCE PER OBJECT you intend to draw
+	//  - This will use all currently set Direct3D resources (shaders, buffers, etc)
+	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
+	//     vertices in the currently set VERTEX BUFFER
+	context->DrawIndexed(
+		lods[lod].indexCount,                         // The number of indices to use (each LOD is a subset of the mesh's indices)
+		geometry.startIndex + lods[lod].indexStart,   // Offset to the first index we want to use
+		geometry.baseVertex);                         // Offset to add to each index when looking up vertices
+}
+
+// Culls the meshlets of one LOD against a view, giving the index ranges still worth drawing
+void Mesh::CullMeshlets(int lod, const MeshletCulling::View& view, MeshletCulling::Stats& stats, std::vector<MeshletCulling::DrawRange>& visible)
+{
+	visible.clear();
+	if (lods.size() == 0)
+		return;
+
+	lod = lod < 0 ? 0 : (lod < lods.size() ? lod : (int)lods.size() - 1);
+	if (lods[lod].meshletCount == 0)
+		return;
+
+	MeshletCulling::Cull(&meshlets[lods[lod].meshletStart], (int)lods[lod].meshletCount, view, stats, visible);
+}
+
+// Draws index ranges from CullMeshlets(), binding the buffers only once for all of them
+void Mesh::Draw(const std::vector<MeshletCulling::DrawRange>& ranges)
+{
+	if (ranges.size() == 0 || !geometry.valid)
+		return;
+
+	GeometryPool::GetInstance().Bind(vertexStride);
+
+	for (int i = 0; i < ranges.size(); i++)
+		context->DrawIndexed(ranges[i].indexCount, geometry.startIndex + ranges[i].indexStart, geometry.baseVertex);
+}
+
+// --------------------------------------------------------
+// Draws index ranges from CullMeshlets() with the position
+// stream, for passes that only write depth
+// - The bound vertex shader must read PositionVertex data,
+//   or CompactPositionVertex data for compact meshes
+// --------------------------------------------------------
+void Mesh::DrawDepth(const std::vector<MeshletCulling::DrawRange>& ranges)
+{
+	if (ranges.size() == 0 || !geometry.valid || !positions.valid)
+		return;
+
+	GeometryPool::GetInstance().Bind(positions.vertexStride);
+
+	// Same indices as the full vertices, only the base vertex differs
+	for (int i = 0; i < ranges.size(); i++)
+		context->DrawIndexed(ranges[i].indexCount, geometry.startIndex + ranges[i].indexStart, positions.baseVertex);
+}
+
+// --------------------------------------------------------
+// Draws the parts of CullMeshlets() ranges inside one submesh
+// - Ranges come out in index order and meshlets never cross
+//   a submesh, so only the ranges touching its ends get cut
+// --------------------------------------------------------
+void Mesh::Draw(const std::vector<MeshletCulling::DrawRange>& ranges, const MeshOptimizer::Submesh& submesh)
+{
+	if (ranges.size() == 0 || !geometry.valid)
 		return;
-	
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-	
-	// Still have data left?
-	while (obj.good())
+
+	GeometryPool::GetInstance().Bind(vertexStride);
+
+	unsigned int submeshEnd = submesh.indexStart + submesh.indexCount;
+	for (int i = 0; i < ranges.size(); i++)
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-	
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
+		unsigned int start = ranges[i].indexStart > submesh.indexStart ? ranges[i].indexStart : submesh.indexStart;
+		unsigned int end = ranges[i].indexStart + ranges[i].indexCount;
+		end = end < submeshEnd ? end : submeshEnd;
+		if (start < end)
+			context->DrawIndexed(end - start, geometry.startIndex + start, geometry.baseVertex);
+	}
+}
+
+// Gives a "Compact" vertex shader the bounds it needs to decode this mesh's vertices
+void Mesh::SetCompactDecodeData(std::shared_ptr<SimpleVertexShader> vs)
+{
+	vs->SetFloat3("positionOffset", decodeParams.positionOffset);
+	vs->SetFloat3("positionScale", decodeParams.positionScale);
+	vs->SetFloat2("uvOffset", decodeParams.uvOffset);
+	vs->SetFloat2("uvScale", decodeParams.uvScale);
+}
+
+// --------------------------------------------------------
+// Loads a OBJ file into finished CPU side mesh data, without
+// touching Direct3D or any Mesh, so any thread can run it
+// - When a valid MeshCache file exists, the finished data
+//   comes straight from it and parsing, welding and tangent
+//   generation are skipped entirely
+// - Otherwise the file is parsed and processed, and a new
+//   cache file is written for next time
+// --------------------------------------------------------
+bool Mesh::Import(const wchar_t* objFile, const MeshImportOptions& options, MeshData& data)
+{
+	// The cache is only valid for the exact contents it was made from
+	MappedFile source(objFile);
+	if (!source.IsOpen())
+		return false;
+
+	unsigned long long sourceHash = MeshCache::HashBytes(source.GetData(), source.GetSize());
+	std::wstring cachePath = MeshCache::GetCachePath(objFile);
+
+	if (options.useCache)
+	{
+		MappedFile cacheFile(cachePath.c_str());
+		MeshCache::Contents cache;
+		if (MeshCache::Open(cacheFile, sourceHash, source.GetSize(), cache))
 		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-	
-			// Add to the list of normals
-			normals.push_back(norm);
+			data.vertices.swap(cache.vertices);
+			data.indices.swap(cache.indices);
+			data.lods.assign(cache.header.lods, cache.header.lods + cache.header.lodCount);
+			data.meshlets.swap(cache.meshlets);
+			data.importStats = cache.header.importStats;
+			data.loadedFromCache = true;
+			return true;
 		}
-		else if (chars[0] == 'v' && chars[1] == 't')
+	}
+
+	if (!ObjParser::Load(objFile, options.backend, data.vertices, data.indices))
+		return false;
+
+	ProcessImport(data, options);
+	if (data.lods.size() == 0)
+		return false;
+
+	if (options.useCache)
+		MeshCache::Write(cachePath.c_str(), sourceHash, source.GetSize(), data.importStats, data.lods, data.meshlets, data.vertices, data.indices);
+	return true;
+}
+
+namespace
+{
+	// One material's triangles while a mesh is being imported
+	struct SubmeshPart
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;			// Every LOD, one after another
+		std::vector<MeshOptimizer::LodLevel> lods;	// Empty until its LODs are made
+		int materialId;
+	};
+
+	// Copies a range of triangles and just the vertices they use
+	// - remap must hold UINT_MAX for every vertex, and is left that way
+	void ExtractPart(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, const MeshOptimizer::Submesh& range,
+		std::vector<unsigned int>& remap, SubmeshPart& part)
+	{
+		part.materialId = range.materialId;
+		part.indices.reserve(range.indexCount);
+		for (unsigned int i = range.indexStart; i < range.indexStart + range.indexCount; i++)
 		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-	
-			// Add to the list of uv's
-			uvs.push_back(uv);
+			unsigned int v = indices[i];
+			if (remap[v] == UINT_MAX)
+			{
+				remap[v] = (unsigned int)part.vertices.size();
+				part.vertices.push_back(verts[v]);
+			}
+			part.indices.push_back(remap[v]);
 		}
-		else if (chars[0] == 'v')
+
+		for (unsigned int i = range.indexStart; i < range.indexStart + range.indexCount; i++)
+			remap[indices[i]] = UINT_MAX;
+	}
+
+	// --------------------------------------------------------
+	// Puts the parts back together into one mesh
+	// - Each LOD holds every part's triangles, one submesh per
+	//   part, so a LOD stays one range of the index list
+	// - Parts with fewer LODs than the others repeat their last
+	// --------------------------------------------------------
+	void JoinParts(const std::vector<SubmeshPart>& parts, MeshData& data)
+	{
+		data.vertices.clear();
+		data.indices.clear();
+		data.lods.clear();
+		data.submeshes.clear();
+
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+		int lodCount = 1;
+		for (int p = 0; p < parts.size(); p++)
 		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-	
-			// Add to the positions
-			positions.push_back(pos);
+			vertexCount += parts[p].vertices.size();
+			indexCount += parts[p].indices.size();
+			lodCount = parts[p].lods.size() > lodCount ? (int)parts[p].lods.size() : lodCount;
 		}
-		else if (chars[0] == 'f')
+		data.vertices.reserve(vertexCount);
+		data.indices.reserve(indexCount);
+
+		std::vector<unsigned int> baseVertex(parts.size());
+		for (int p = 0; p < parts.size(); p++)
 		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-	
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-	
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-	
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
-	
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.position = positions[i[0] - 1];
-			v1.uv = uvs[i[1] - 1];
-			v1.normal = normals[i[2] - 1];
-	
-			Vertex v2;
-			v2.position = positions[i[3] - 1];
-			v2.uv = uvs[i[4] - 1];
-			v2.normal = normals[i[5] - 1];
-	
-			Vertex v3;
-			v3.position = positions[i[6] - 1];
-			v3.uv = uvs[i[7] - 1];
-			v3.normal = normals[i[8] - 1];
-	
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-	
-			// Flip the UV's since they're probably "upside down"
-			v1.uv.y = 1.0f - v1.uv.y;
-			v2.uv.y = 1.0f - v2.uv.y;
-			v3.uv.y = 1.0f - v3.uv.y;
-	
-			// Flip Z (LH vs. RH)
-			v1.position.z *= -1.0f;
-			v2.position.z *= -1.0f;
-			v3.position.z *= -1.0f;
-	
-			// Flip normal's Z
-			v1.normal.z *= -1.0f;
-			v2.normal.z *= -1.0f;
-			v3.normal.z *= -1.0f;
-	
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-	
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-	
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
+			baseVertex[p] = (unsigned int)data.vertices.size();
+			data.vertices.insert(data.vertices.end(), parts[p].vertices.begin(), parts[p].vertices.end());
+		}
+
+		for (int l = 0; l < lodCount; l++)
+		{
+			MeshOptimizer::LodLevel lod = { (unsigned int)data.indices.size(), 0, 0.0f, 0, 0 };
+			for (int p = 0; p < parts.size(); p++)
 			{
-				// Make the last vertex
-				Vertex v4;
-				v4.position = positions[i[9] - 1];
-				v4.uv = uvs[i[10] - 1];
-				v4.normal = normals[i[11] - 1];
-	
-				// Flip the UV, Z pos and normal's Z
-				v4.uv.y = 1.0f - v4.uv.y;
-				v4.position.z *= -1.0f;
-				v4.normal.z *= -1.0f;
-	
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-	
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
+				MeshOptimizer::LodLevel source = { 0, (unsigned int)parts[p].indices.size(), 0.0f, 0, 0 };
+				if (parts[p].lods.size() > 0)
+					source = parts[p].lods[l < parts[p].lods.size() ? l : parts[p].lods.size() - 1];
+
+				MeshOptimizer::Submesh submesh = { (unsigned int)data.indices.size(), source.indexCount, parts[p].materialId };
+				for (unsigned int i = source.indexStart; i < source.indexStart + source.indexCount; i++)
+					data.indices.push_back(parts[p].indices[i] + baseVertex[p]);
+				data.submeshes.push_back(submesh);
+
+				lod.error = source.error > lod.error ? source.error : lod.error;
 			}
+			lod.indexCount = (unsigned int)data.indices.size() - lod.indexStart;
+			data.lods.push_back(lod);
 		}
 	}
-	
-	// Close the file and create the actual buffers
-	obj.close();
-	
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
-	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
-	//
-	// - The vector "indices" is similar. It's a vector of unsigned ints and
-	//    can be used directly for the index buffer: &indices[0] is the address of the first int
-	//
-	// - "vertCounter" is the number of vertices
-	// - "indexCounter" is the number of indices
-	// - Yes, these are effectively the same since OBJs do not index entire vertices!  This means
-	//    an index buffer isn't doing much for us.  We could try to optimize the mesh ourselves
-	//    and detect duplicate vertices, but at that point it would be better to use a more
-	//    sophisticated model loading library like TinyOBJLoader or The Open Asset Importer Library
-	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
-	CreateVertexIndexBuffers(&verts[0], vertCounter, &indices[0], indexCounter, device);
-	indexCount = indexCounter;
 }
 
-// Create a mesh by loading it from a OBJ file with the use of tinyobjloader
-Mesh::Mesh(std::string objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
-	:
-	context(context)
+// --------------------------------------------------------
+// Shared processing of every file-based import
+// - Loaders give each face corner its own vertex, so weld
+//   them first and let neighbouring triangles share vertices
+//   (this also lets tangents average across shared corners)
+// - Triangles are then reordered for the post-transform
+//   vertex cache, and clusters of them for less overdraw,
+//   both measured before and after for the UI
+// - Finally vertices are stored in the order the triangles
+//   use them, so vertex buffer reads stay mostly sequential
+// - Simplified LODs are appended to the index list last, so
+//   the stats above and tangents only use the full mesh
+// - Every LOD is then split into meshlets for culling, which
+//   keeps the triangle order all the passes above picked
+// - Each material range the loader gave is welded, reordered
+//   and simplified on its own, so no pass mixes materials,
+//   and the submeshes then list every LOD's material ranges
+// --------------------------------------------------------
+void Mesh::ProcessImport(MeshData& data, const MeshImportOptions& options)
 {
-	std::string filePath = WideToNarrow(FixPath(NarrowToWide(objFile)));
-	
-	tinyobj::ObjReaderConfig reader_config;
-	reader_config.mtl_search_path = "";
-	tinyobj::ObjReader reader;
+	std::vector<MeshOptimizer::Submesh> materialRanges;
+	materialRanges.swap(data.submeshes);
+	if (materialRanges.size() == 0)
+	{
+		MeshOptimizer::Submesh all = { 0, (unsigned int)data.indices.size(), -1 };
+		materialRanges.push_back(all);
+	}
 
-	if (!reader.ParseFromFile(filePath, reader_config))
+	// A single material needs no copying
+	std::vector<SubmeshPart> parts(materialRanges.size());
+	if (parts.size() == 1)
+	{
+		parts[0].vertices.swap(data.vertices);
+		parts[0].indices.swap(data.indices);
+		parts[0].materialId = materialRanges[0].materialId;
+	}
+	else
+	{
+		std::vector<unsigned int> remap(data.vertices.size(), UINT_MAX);
+		for (int p = 0; p < parts.size(); p++)
+			ExtractPart(data.vertices, data.indices, materialRanges[p], remap, parts[p]);
+	}
+
+	MeshOptimizer::ImportStats& importStats = data.importStats;
+	importStats.weld = {};
+	for (int p = 0; p < parts.size(); p++)
+	{
+		MeshOptimizer::WeldStats weld = MeshOptimizer::WeldVertices(parts[p].vertices, parts[p].indices, MeshOptimizer::DefaultWeldSettings());
+		importStats.weld.vertexCountBefore += weld.vertexCountBefore;
+		importStats.weld.vertexCountAfter += weld.vertexCountAfter;
+		importStats.weld.triangleCountBefore += weld.triangleCountBefore;
+		importStats.weld.triangleCountAfter += weld.triangleCountAfter;
+		importStats.weld.degenerateTriangles += weld.degenerateTriangles;
+	}
+
+	// Welding can leave a material with no triangles at all
+	for (int p = (int)parts.size() - 1; p >= 0; p--)
+	{
+		if (parts[p].indices.size() == 0)
+			parts.erase(parts.begin() + p);
+	}
+	if (parts.size() == 0)
+	{
+		data.vertices.clear();
+		data.indices.clear();
 		return;
+	}
 
-	auto& attributes = reader.GetAttrib();
-	auto& shapes = reader.GetShapes();
-	//auto& materials = reader.GetMaterials();
+	// Stats are measured on the whole mesh, so they match meshes with a single material
+	// - Meshes made at runtime skip them, since the overdraw estimate alone costs more than the rest of the import
+	if (options.measureStats && parts.size() > 1)
+		JoinParts(parts, data);
+	const std::vector<Vertex>& statVerts = parts.size() > 1 ? data.vertices : parts[0].vertices;
+	const std::vector<unsigned int>& statIndices = parts.size() > 1 ? data.indices : parts[0].indices;
 
-	// Variables used while reading the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
+	int weldedVertexCount = (int)statVerts.size();
+	if (options.measureStats)
+	{
+		importStats.fifoBefore = MeshOptimizer::AnalyzeVertexCache(statIndices, weldedVertexCount, MeshOptimizer::fifoCacheSize, MeshOptimizer::CacheFIFO);
+		importStats.lruBefore = MeshOptimizer::AnalyzeVertexCache(statIndices, weldedVertexCount, MeshOptimizer::lruCacheSize, MeshOptimizer::CacheLRU);
+		importStats.overdrawBefore = MeshOptimizer::EstimateOverdraw(statVerts, statIndices, MeshOptimizer::overdrawDirections, MeshOptimizer::overdrawResolution);
+		importStats.fetchBefore = MeshOptimizer::AnalyzeVertexFetch(statIndices, weldedVertexCount, sizeof(Vertex));
+	}
+
+	for (int p = 0; p < parts.size(); p++)
+	{
+		MeshOptimizer::OptimizeVertexCache(parts[p].indices, (int)parts[p].vertices.size());
+		MeshOptimizer::OptimizeOverdraw(parts[p].vertices, parts[p].indices, MeshOptimizer::overdrawThreshold);
+		MeshOptimizer::OptimizeVertexFetch(parts[p].vertices, parts[p].indices);
+	}
 
-	// Loop over shapes
-	for (size_t s = 0; s < shapes.size(); s++)
+	if (options.measureStats)
 	{
-		// Loop over faces(polygon)
-		size_t index_offset = 0;
-		for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+		if (parts.size() > 1)
+			JoinParts(parts, data);
+
+		importStats.fifoAfter = MeshOptimizer::AnalyzeVertexCache(statIndices, weldedVertexCount, MeshOptimizer::fifoCacheSize, MeshOptimizer::CacheFIFO);
+		importStats.lruAfter = MeshOptimizer::AnalyzeVertexCache(statIndices, weldedVertexCount, MeshOptimizer::lruCacheSize, MeshOptimizer::CacheLRU);
+		importStats.overdrawAfter = MeshOptimizer::EstimateOverdraw(statVerts, statIndices, MeshOptimizer::overdrawDirections, MeshOptimizer::overdrawResolution);
+		importStats.fetchAfter = MeshOptimizer::AnalyzeVertexFetch(statIndices, (int)statVerts.size(), sizeof(Vertex));
+	}
+
+	for (int p = 0; p < parts.size(); p++)
+		MeshOptimizer::GenerateLods(parts[p].vertices, parts[p].indices, parts[p].lods);
+
+	if (parts.size() > 1)
+		JoinParts(parts, data);
+	else
+	{
+		data.vertices.swap(parts[0].vertices);
+		data.indices.swap(parts[0].indices);
+		data.lods.swap(parts[0].lods);
+		data.submeshes.clear();
+		for (int i = 0; i < data.lods.size(); i++)
 		{
-			size_t fv = size_t(shapes[s].mesh.num_face_vertices[f]);
+			MeshOptimizer::Submesh submesh = { data.lods[i].indexStart, data.lods[i].indexCount, parts[0].materialId };
+			data.submeshes.push_back(submesh);
+		}
+	}
 
-			// Loop over vertices in the face.
-			for (size_t v = 0; v < fv; v++)
-			{
-				Vertex vertex;
-
-				// access to vertex
-				tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-				tinyobj::real_t vx = attributes.vertices[3 * size_t(idx.vertex_index) + 0];
-				tinyobj::real_t vy = attributes.vertices[3 * size_t(idx.vertex_index) + 1];
-				tinyobj::real_t vz = attributes.vertices[3 * size_t(idx.vertex_index) + 2];
-
-				vertex.position = XMFLOAT3(vx, vy, -vz);
-				indices.push_back(indexCounter);
-				indexCounter++;
-
-				// Check if `normal_index` is zero or positive. negative = no normal data
-				if (idx.normal_index >= 0)
-				{
-					tinyobj::real_t nx = attributes.normals[3 * size_t(idx.normal_index) + 0];
-					tinyobj::real_t ny = attributes.normals[3 * size_t(idx.normal_index) + 1];
-					tinyobj::real_t nz = attributes.normals[3 * size_t(idx.normal_index) + 2];
-
-					vertex.normal = XMFLOAT3(nx, ny, -nz);
-				}
-
-				// Check if `texcoord_index` is zero or positive. negative = no texcoord data
-				if (idx.texcoord_index >= 0)
-				{
-					tinyobj::real_t tx = attributes.texcoords[2 * size_t(idx.texcoord_index) + 0];
-					tinyobj::real_t ty = attributes.texcoords[2 * size_t(idx.texcoord_index) + 1];
-
-					vertex.uv = XMFLOAT2(tx, 1.0f - ty);
-				}
-
-				verts.push_back(vertex);
-				vertCounter++;
-
-				// Optional: vertex colors
-				// tinyobj::real_t red   = attributes.colors[3*size_t(idx.vertex_index)+0];
-				// tinyobj::real_t green = attributes.colors[3*size_t(idx.vertex_index)+1];
-				// tinyobj::real_t blue  = attributes.colors[3*size_t(idx.vertex_index)+2];
-			}
-			index_offset += fv;
+	std::vector<Vertex>& verts = data.vertices;
+	std::vector<unsigned int>& indices = data.indices;
 
-			// per-face material
-			//shapes[s].mesh.material_ids[f];
+	// Meshlets never cross a submesh, so culled ranges can be split up by material
+	int submeshesPerLod = (int)(data.submeshes.size() / data.lods.size());
+	for (int i = 0; i < data.lods.size(); i++)
+	{
+		data.lods[i].meshletStart = (unsigned int)data.meshlets.size();
+		for (int s = 0; s < submeshesPerLod; s++)
+		{
+			MeshOptimizer::Submesh& submesh = data.submeshes[i * submeshesPerLod + s];
+			MeshOptimizer::LodLevel range = { submesh.indexStart, submesh.indexCount, 0.0f, 0, 0 };
+			MeshOptimizer::BuildMeshlets(verts, indices, range, data.meshlets);
 		}
+		data.lods[i].meshletCount = (unsigned int)data.meshlets.size() - data.lods[i].meshletStart;
 	}
 
-	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
-	CreateVertexIndexBuffers(&verts[0], vertCounter, &indices[0], indexCounter, device);
-	indexCount = indexCounter;
+	TangentGenerator::Calculate(&verts[0], (int)verts.size(), &indices[0], (int)data.lods[0].indexCount);
 }
 
-Mesh::~Mesh()
+// --------------------------------------------------------
+// Gives this mesh the imported data and copies it into the GeometryPool
+// - Must run on the thread that owns the device context,
+//   since the mesh may be drawn right after
+// - The data's LOD and meshlet lists are moved into the mesh
+// --------------------------------------------------------
+void Mesh::Upload(MeshData& data, Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
-}
+	if (data.lods.size() == 0 || data.vertices.size() == 0)
+		return;
 
-void Mesh::Draw()
-{
-	// DRAW geometry
-	// - These steps are generally repeated for EACH object you draw
-	// - Other Direct3D calls will also be necessary to do more complex things
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-
-	// Set buffers in the input assembler (IA) stage
-	//  - Do this ONCE PER OBJECT, since each object may have different geometry
-	//  - For this demo, this step *could* simply be done once during Init()
-	//  - However, this needs to be done between EACH DrawIndexed() call
-	//     when drawing different geometry, so it's here as an example
-	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	// Cached meshes come from the OBJ parsers, which don't read materials
+	if (data.submeshes.size() == 0)
+	{
+		for (int i = 0; i < data.lods.size(); i++)
+		{
+			MeshOptimizer::Submesh submesh = { data.lods[i].indexStart, data.lods[i].indexCount, -1 };
+			data.submeshes.push_back(submesh);
+		}
+	}
 
-	// Tell Direct3D to draw
-	//  - Begins the rendering pipeline on the GPU
-	//  - Do this ONCE PER OBJECT you intend to draw
-	//  - This will use all currently set Direct3D resources (shaders, buffers, etc)
-	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
-	//     vertices in the currently set VERTEX BUFFER
-	context->DrawIndexed(
-		indexCount, // The number of indices to use (we could draw a subset if we wanted)
-		0,          // Offset to the first index we want to use
-		0);         // Offset to add to each index when looking up vertices
-}
+	if (keepProxySource)
+		KeepProxySource(data);
 
-void Mesh::CreateVertexIndexBuffers(Vertex* vertices, int vertexCount, unsigned* indices, int indexCount,
-	Microsoft::WRL::ComPtr<ID3D11Device> device)
-{
-	// Create a VERTEX BUFFER
-	// - This holds the vertex data of triangles for a single object
-	// - This buffer is created on the GPU, which is where the data needs to
-	//    be if we want the GPU to act on it (as in: draw it to the screen)
-
-	// First, we need to describe the buffer we want Direct3D to make on the GPU
-	//  - Note that this variable is created on the stack since we only need it once
-	//  - After the buffer is created, this description variable is unnecessary
-	D3D11_BUFFER_DESC vbd = {};
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;	   // Will NEVER change
-	vbd.ByteWidth = sizeof(Vertex) * vertexCount;// 3 = number of vertices in the buffer
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;    // Tells Direct3D this is a vertex buffer
-	vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
-
-	// Create the proper struct to hold the initial vertex data
-	// - This is how we initially fill the buffer with data
-	// - Essentially, we're specifying a pointer to the data to copy
-	D3D11_SUBRESOURCE_DATA initialVertexData = {};
-	initialVertexData.pSysMem = vertices; // pSysMem = Pointer to System Memory
-
-	// Actually create the buffer on the GPU with the initial data
-	// - Once we do this, we'll NEVER CHANGE DATA IN THE BUFFER AGAIN
-	device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
-
-	// Create an INDEX BUFFER
-	// - This holds indices to elements in the vertex buffer
-	// - This is most useful when vertices are shared among neighboring triangles
-	// - This buffer is created on the GPU, which is where the data needs to
-	//    be if we want the GPU to act on it (as in: draw it to the screen)
-
-	// Describe the buffer, as we did above, with two major differences
-	//  - Byte Width (3 unsigned integers vs. 3 whole vertices)
-	//  - Bind Flag (used as an index buffer instead of a vertex buffer) 
-	D3D11_BUFFER_DESC ibd = {};
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;	        // Will NEVER change
-	ibd.ByteWidth = sizeof(unsigned int) * indexCount;// 3 = number of indices in the buffer
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	        // Tells Direct3D this is an index buffer
-	ibd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
-
-	// Specify the initial data for this buffer, similar to above
-	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = indices; // pSysMem = Pointer to System Memory
-
-	// Actually create the buffer with the initial data
-	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-	device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+	importStats = data.importStats;
+	loadedFromCache = data.loadedFromCache;
+	meshlets.swap(data.meshlets);
+	submeshes.swap(data.submeshes);
+	CreateVertexIndexBuffers(&data.vertices[0], (int)data.vertices.size(), &data.indices[0], (int)data.indices.size());
+	indexCount = (int)data.lods[0].indexCount;
+	lods.swap(data.lods);
 }
 
 // --------------------------------------------------------
-// Author: Chris Cascioli
-// Purpose: Calculates the tangents of the vertices in a mesh
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
-//
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// Copies the coarsest LOD, with just the vertices it uses,
+// for HLOD proxies to merge with other meshes later
+// - Its submeshes keep their material ids, with index ranges
+//   rebased onto the copied indices
 // --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+void Mesh::KeepProxySource(const MeshData& data)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	proxySource = MeshData();
+	const MeshOptimizer::LodLevel& coarsest = data.lods.back();
+	int submeshesPerLod = (int)(data.submeshes.size() / data.lods.size());
+
+	std::vector<unsigned int> remap(data.vertices.size(), UINT_MAX);
+	proxySource.indices.reserve(coarsest.indexCount);
+	for (unsigned int i = coarsest.indexStart; i < coarsest.indexStart + coarsest.indexCount; i++)
 	{
-		verts[i].tangent = XMFLOAT3(0, 0, 0);
+		unsigned int v = data.indices[i];
+		if (remap[v] == UINT_MAX)
+		{
+			remap[v] = (unsigned int)proxySource.vertices.size();
+			proxySource.vertices.push_back(data.vertices[v]);
+		}
+		proxySource.indices.push_back(remap[v]);
 	}
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+	for (int s = 0; s < submeshesPerLod; s++)
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->position.x - v1->position.x;
-		float y1 = v2->position.y - v1->position.y;
-		float z1 = v2->position.z - v1->position.z;
-
-		float x2 = v3->position.x - v1->position.x;
-		float y2 = v3->position.y - v1->position.y;
-		float z2 = v3->position.z - v1->position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->uv.x - v1->uv.x;
-		float t1 = v2->uv.y - v1->uv.y;
-
-		float s2 = v3->uv.x - v1->uv.x;
-		float t2 = v3->uv.y - v1->uv.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->tangent.x += tx;
-		v1->tangent.y += ty;
-		v1->tangent.z += tz;
-
-		v2->tangent.x += tx;
-		v2->tangent.y += ty;
-		v2->tangent.z += tz;
-
-		v3->tangent.x += tx;
-		v3->tangent.y += ty;
-		v3->tangent.z += tz;
+		MeshOptimizer::Submesh submesh = data.submeshes[(data.lods.size() - 1) * submeshesPerLod + s];
+		submesh.indexStart -= coarsest.indexStart;
+		proxySource.submeshes.push_back(submesh);
 	}
+}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
+void Mesh::CreateVertexIndexBuffers(const Vertex* vertices, int vertexCount, const unsigned int* indices, int indexCount)
+{
+	CalculateBounds(vertices, vertexCount);
+
+	// Compact meshes quantize their final vertices right before upload,
+	// so the same processed data (and cache files) work for both formats
+	std::vector<CompactVertex> compact;
+	const void* vertexData = vertices;
+	if (compactVertices)
 	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].tangent);
+		decodeParams = VertexCompression::ComputeDecodeParams(vertices, vertexCount);
+		VertexCompression::EncodeVertices(vertices, vertexCount, decodeParams, compact);
+		compressionError = VertexCompression::MeasureError(vertices, &compact[0], vertexCount, decodeParams);
+		vertexData = &compact[0];
+		vertexStride = sizeof(CompactVertex);
+	}
 
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
+	// Copy the geometry into the shared pool, replacing any this mesh had before
+	// - Vertices stay local to the mesh, draws add the allocation's base vertex
+	GeometryPool& pool = GeometryPool::GetInstance();
+	pool.Free(geometry);
+	geometry = pool.Allocate(vertexData, vertexCount, vertexStride, indices, indexCount);
 
-		// Store the tangent
-		XMStoreFloat3(&verts[i].tangent, tangent);
+	// Depth passes only read positions, so those are also kept on their own,
+	// tightly packed, instead of fetching whole vertices to use 12 (or 8) bytes
+	pool.Free(positions);
+	if (compactVertices)
+	{
+		std::vector<CompactPositionVertex> packed(vertexCount);
+		for (int i = 0; i < vertexCount; i++)
+			memcpy(packed[i].position, compact[i].position, sizeof(packed[i].position));
+		positions = pool.AllocateVertices(&packed[0], vertexCount, sizeof(CompactPositionVertex));
+	}
+	else
+	{
+		std::vector<PositionVertex> packed(vertexCount);
+		for (int i = 0; i < vertexCount; i++)
+			packed[i].position = vertices[i].position;
+		positions = pool.AllocateVertices(&packed[0], vertexCount, sizeof(PositionVertex));
 	}
 }
+
+// --------------------------------------------------------
+// Local space bounds of the whole mesh (every LOD shares the
+// same vertices), for culling and LOD selection
+// - The sphere is centered on the box and just reaches the
+//   farthest vertex, so it's usually tighter than the box's
+//   own bounding sphere
+// --------------------------------------------------------
+void Mesh::CalculateBounds(const Vertex* vertices, int vertexCount)
+{
+	if (vertexCount == 0)
+		return;
+
+	XMVECTOR localMin = XMLoadFloat3(&vertices[0].position);
+	XMVECTOR localMax = localMin;
+	for (int i = 1; i < vertexCount; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&vertices[i].position);
+		localMin = XMVectorMin(localMin, position);
+		localMax = XMVectorMax(localMax, position);
+	}
+
+	XMStoreFloat3(&boundsMin, localMin);
+	XMStoreFloat3(&boundsMax, localMax);
+
+	XMVECTOR center = (localMin + localMax) * 0.5f;
+	XMVECTOR radiusSq = XMVectorZero();
+	for (int i = 0; i < vertexCount; i++)
+		radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(XMLoadFloat3(&vertices[i].position) - center));
+
+	XMStoreFloat3(&boundingSphereCenter, center);
+	boundingSphereRadius = sqrtf(XMVectorGetX(radiusSq));
+}
@@ -2,32 +2,109 @@
 
 #include <d3d11.h>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
+#include <memory>
 #include <string>
+#include <vector>
 #include "Vertex.h"
+#include "ObjParser.h"
+#include "MeshOptimizer.h"
+#include "MeshletCulling.h"
+#include "VertexCompression.h"
+#include "GeometryPool.h"
+#include "SimpleShader.h"
+
+// Choices for how a mesh is imported from an OBJ file
+struct MeshImportOptions
+{
+	ObjParser::Backend backend = ObjParser::Parallel;
+	bool useCache = true;		// Load from / save to a binary MeshCache file next to the OBJ
+	bool compactVertices = false;	// Upload CompactVertex data, which needs the "Compact" vertex shaders
+	bool keepProxySource = false;	// Keep the coarsest LOD on the CPU, so HLOD proxies can be made from it
+	bool measureStats = true;		// Analyze the vertex cache, overdraw and vertex fetch before and after optimizing
+};
+
+// Finished CPU side data of an imported mesh, ready to be uploaded
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;					// Every LOD, one after another
+	std::vector<MeshOptimizer::LodLevel> lods;
+	std::vector<MeshOptimizer::Meshlet> meshlets;
+	std::vector<MeshOptimizer::Submesh> submeshes;		// Loaders give material ranges of the full mesh, ProcessImport() those of every LOD
+	MeshOptimizer::ImportStats importStats = {};
+	bool loadedFromCache = false;
+};
 
 class Mesh
 {
 public:
 	Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount,
 		Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
-	Mesh(const wchar_t* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	Mesh(const wchar_t* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		MeshImportOptions options = MeshImportOptions());
 	Mesh(std::string objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	Mesh(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, MeshImportOptions options);
 	~Mesh();
 
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vertexBuffer; }
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() {return indexBuffer; }
+	// Import() and ProcessImport() are safe on any thread, Upload() must happen on the render thread
+	static bool Import(const wchar_t* objFile, const MeshImportOptions& options, MeshData& data);
+	static void ProcessImport(MeshData& data, const MeshImportOptions& options = MeshImportOptions());
+	void Upload(MeshData& data, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	bool IsReady() { return lods.size() > 0; }
+
+	GeometryPool::Allocation GetGeometry() { return geometry; }
+	GeometryPool::Allocation GetPositions() { return positions; }
 	int GetIndexCount() { return indexCount; }
+	int GetLodCount() { return (int)lods.size(); }
+	MeshOptimizer::LodLevel GetLod(int lod) { return lods[lod]; }
+	DirectX::XMFLOAT3 GetBoundsMin() { return boundsMin; }
+	DirectX::XMFLOAT3 GetBoundsMax() { return boundsMax; }
+	DirectX::XMFLOAT3 GetBoundingSphereCenter() { return boundingSphereCenter; }
+	float GetBoundingSphereRadius() { return boundingSphereRadius; }
+	int GetMeshletCount() { return (int)meshlets.size(); }
+	int GetSubmeshCount() { return lods.size() > 0 ? (int)(submeshes.size() / lods.size()) : 0; }
+	MeshOptimizer::Submesh GetSubmesh(int lod, int submesh) { return submeshes[lod * GetSubmeshCount() + submesh]; }
+	const std::vector<std::string>& GetMaterialNames() { return materialNames; }
+	MeshOptimizer::ImportStats GetImportStats() { return importStats; }
+	bool WasLoadedFromCache() { return loadedFromCache; }
+	bool HasCompactVertices() { return compactVertices; }
+	unsigned int GetVertexStride() { return vertexStride; }
+	VertexCompression::ErrorStats GetCompressionError() { return compressionError; }
+	const MeshData& GetProxySource() { return proxySource; }
+
+	void SetCompactDecodeData(std::shared_ptr<SimpleVertexShader> vs);
+
+	void CullMeshlets(int lod, const MeshletCulling::View& view, MeshletCulling::Stats& stats, std::vector<MeshletCulling::DrawRange>& visible);
 
-	void Draw();
+	void Draw(int lod = 0);
+	void Draw(const std::vector<MeshletCulling::DrawRange>& ranges);
+	void Draw(const std::vector<MeshletCulling::DrawRange>& ranges, const MeshOptimizer::Submesh& submesh);
+	void DrawDepth(const std::vector<MeshletCulling::DrawRange>& ranges);
 
 private:
-	void CreateVertexIndexBuffers(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount,
-		Microsoft::WRL::ComPtr<ID3D11Device> device);
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	void CreateVertexIndexBuffers(const Vertex* vertices, int vertexCount, const unsigned int* indices, int indexCount);
+	void CalculateBounds(const Vertex* vertices, int vertexCount);
+	void KeepProxySource(const MeshData& data);
 
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 	int indexCount;
+	MeshOptimizer::ImportStats importStats;
+	bool loadedFromCache;
+	bool compactVertices;
+	bool keepProxySource;
+	unsigned int vertexStride;
+	VertexCompression::DecodeParams decodeParams;
+	VertexCompression::ErrorStats compressionError;
+	GeometryPool::Allocation geometry;		// Where this mesh's vertices and indices live in the shared buffers
+	GeometryPool::Allocation positions;		// Positions alone, drawn with geometry's indices by DrawDepth()
+	std::vector<MeshOptimizer::LodLevel> lods;		// Index ranges of each level, LOD 0 is the full mesh
+	std::vector<MeshOptimizer::Meshlet> meshlets;	// Clusters of every LOD, found through LodLevel::meshletStart
+	std::vector<MeshOptimizer::Submesh> submeshes;	// GetSubmeshCount() material ranges for each LOD, one LOD after another
+	std::vector<std::string> materialNames;			// Names of the file's materials, by Submesh::materialId
+	MeshData proxySource;		// Coarsest LOD's vertices, indices and submeshes, when keepProxySource is set
+	DirectX::XMFLOAT3 boundsMin;		// Local space AABB of every vertex
+	DirectX::XMFLOAT3 boundsMax;
+	DirectX::XMFLOAT3 boundingSphereCenter;
+	float boundingSphereRadius;
 
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
 };
\ No newline at end of file
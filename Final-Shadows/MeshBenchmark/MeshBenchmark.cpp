@@ -0,0 +1,465 @@
+#include <Windows.h>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "../ObjParser.h"
+#include "../TangentGenerator.h"
+#include "../VertexCompression.h"
+#include "../MappedFile.h"
+#include "../Helpers.h"
+
+// --------------------------------------------------------
+// Mesh import benchmark
+//
+// Loads every OBJ file in a folder through each import path
+// and reports, for each one:
+// - Parse time, the fastest of several runs
+// - Tangent generation time on the parsed vertices
+// - Peak heap use while parsing
+// - Vertex, index and submesh counts
+//
+// Results are printed as a table and written as JSON
+//
+// With -verify it instead checks every file, returning 1 if
+// any fails:
+// - The Mapped and Parallel backends must give exactly the
+//   same vertices and indices as Stream, bit for bit
+// - Its vertices, round tripped through VertexCompression,
+//   must stay within the error bounds below
+//
+// Usage: MeshBenchmark [-d modelFolder] [-n iterations] [-o results.json] [-verify]
+// --------------------------------------------------------
+
+namespace
+{
+	// Heap use, tracked by the replacement operator new and delete below
+	// - Memory mapped files aren't on the heap, so the file views of the
+	//   Mapped and Parallel backends aren't counted
+	std::atomic<size_t> heapBytes(0);
+	std::atomic<size_t> peakHeapBytes(0);
+
+	// Room in front of each allocation for its size, keeping malloc's alignment
+	const size_t allocationHeader = 16;
+
+	// The getline/sscanf_s parser, the two memory mapped ones, then tinyobjloader
+	enum ImportPath
+	{
+		PathStream,
+		PathMapped,
+		PathParallel,
+		PathTinyObj,
+		PathCount
+	};
+
+	struct PathResult
+	{
+		ImportPath path;
+		bool loaded;
+		double parseMilliseconds;		// Fastest of all iterations
+		double megabytesPerSecond;
+		size_t peakHeapBytes;			// Most heap in use during a parse, over what was in use before it
+		size_t vertexCount;
+		size_t indexCount;
+		size_t submeshCount;
+		TangentGenerator::BenchmarkResult tangents;
+	};
+
+	// Largest errors -verify allows
+	// - Positions and uvs: half a 16 bit step across the mesh's largest
+	//   extent, plus a few float roundings in the decode math
+	// - Normals and tangents: 16 bit octahedral directions stay well
+	//   under this angle
+	const float maxDirectionErrorDegrees = 0.05f;
+	const float roundingTolerance = 1e-6f;
+
+	struct VerifyResult
+	{
+		bool loaded;
+		size_t vertexCount;
+		VertexCompression::ErrorStats error;
+		float maxPositionError;
+		float maxUvError;
+		bool backendsMatch;			// Mapped and Parallel gave the same bytes as Stream
+		bool passed;
+	};
+
+	struct FileResult
+	{
+		std::wstring fileName;
+		size_t fileBytes;
+		std::vector<PathResult> paths;
+	};
+
+	const char* PathToString(ImportPath path)
+	{
+		switch (path)
+		{
+			case PathStream:
+				return ObjParser::BackendToString(ObjParser::Stream);
+
+			case PathMapped:
+				return ObjParser::BackendToString(ObjParser::Mapped);
+
+			case PathParallel:
+				return ObjParser::BackendToString(ObjParser::Parallel);
+
+			case PathTinyObj:
+				return "TinyObj";
+
+			default:
+				return "Unknown";
+		}
+	}
+
+	bool Load(ImportPath path, const wchar_t* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+		std::vector<MeshOptimizer::Submesh>& submeshes)
+	{
+		submeshes.clear();
+		switch (path)
+		{
+			case PathStream:
+				return ObjParser::Load(objFile, ObjParser::Stream, verts, indices);
+
+			case PathMapped:
+				return ObjParser::Load(objFile, ObjParser::Mapped, verts, indices);
+
+			case PathParallel:
+				return ObjParser::Load(objFile, ObjParser::Parallel, verts, indices);
+
+			case PathTinyObj:
+			{
+				std::vector<std::string> materialNames;
+				return ObjParser::LoadTinyObj(objFile, verts, indices, submeshes, materialNames);
+			}
+
+			default:
+				return false;
+		}
+	}
+
+	PathResult RunPath(ImportPath path, const wchar_t* objFile, size_t fileBytes, int iterations)
+	{
+		PathResult result = {};
+		result.path = path;
+
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		std::vector<MeshOptimizer::Submesh> submeshes;
+		double fastest = DBL_MAX;
+		size_t heapBefore = heapBytes.load();
+		peakHeapBytes = heapBefore;
+
+		for (int i = 0; i < iterations; i++)
+		{
+			// Start every run from empty vectors so allocation is part of the cost
+			std::vector<Vertex>().swap(verts);
+			std::vector<unsigned int>().swap(indices);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			result.loaded = Load(path, objFile, verts, indices, submeshes);
+			auto stop = std::chrono::high_resolution_clock::now();
+
+			double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+			if (ms < fastest)
+				fastest = ms;
+		}
+
+		result.peakHeapBytes = peakHeapBytes.load() - heapBefore;
+		if (!result.loaded)
+			return result;
+
+		result.parseMilliseconds = iterations > 0 ? fastest : 0.0;
+		if (result.parseMilliseconds > 0.0)
+			result.megabytesPerSecond = (fileBytes / (1024.0 * 1024.0)) / (result.parseMilliseconds / 1000.0);
+		result.vertexCount = verts.size();
+		result.indexCount = indices.size();
+		result.submeshCount = submeshes.size() > 0 ? submeshes.size() : 1;
+
+		if (indices.size() > 0)
+			result.tangents = TangentGenerator::Benchmark(verts, &indices[0], (int)indices.size(), iterations);
+		return result;
+	}
+
+	// Half a quantization step of the largest extent, with room for rounding
+	// relative to the largest value the decode can produce
+	float QuantizationBound(float extent, float magnitude)
+	{
+		return extent / 65535.0f / 2.0f + magnitude * roundingTolerance;
+	}
+
+	// The faster backends are only drop-in replacements if they give exactly what the Stream one does
+	bool BackendsMatch(const wchar_t* objFile, const std::vector<Vertex>& streamVerts, const std::vector<unsigned int>& streamIndices)
+	{
+		const ObjParser::Backend backends[] = { ObjParser::Mapped, ObjParser::Parallel };
+		for (int b = 0; b < 2; b++)
+		{
+			std::vector<Vertex> verts;
+			std::vector<unsigned int> indices;
+			if (!ObjParser::Load(objFile, backends[b], verts, indices) ||
+				verts.size() != streamVerts.size() || indices.size() != streamIndices.size() ||
+				memcmp(verts.data(), streamVerts.data(), verts.size() * sizeof(Vertex)) != 0 ||
+				memcmp(indices.data(), streamIndices.data(), indices.size() * sizeof(unsigned int)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	// Loads a file, compares its backends, generates its tangents like a Mesh
+	// would, and measures how far its compressed vertices decode from the originals
+	VerifyResult Verify(const wchar_t* objFile)
+	{
+		VerifyResult result = {};
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		result.loaded = ObjParser::Load(objFile, ObjParser::Stream, verts, indices) && verts.size() > 0;
+		if (!result.loaded)
+			return result;
+
+		result.backendsMatch = BackendsMatch(objFile, verts, indices);
+
+		int vertexCount = (int)verts.size();
+		if (indices.size() > 0)
+			TangentGenerator::Calculate(&verts[0], vertexCount, &indices[0], (int)indices.size());
+
+		VertexCompression::DecodeParams params = VertexCompression::ComputeDecodeParams(&verts[0], vertexCount);
+		std::vector<CompactVertex> compact;
+		VertexCompression::EncodeVertices(&verts[0], vertexCount, params, compact);
+		result.vertexCount = verts.size();
+		result.error = VertexCompression::MeasureError(&verts[0], &compact[0], vertexCount, params);
+
+		const DirectX::XMFLOAT3& offset = params.positionOffset;
+		const DirectX::XMFLOAT3& scale = params.positionScale;
+		float positionExtent = scale.x > scale.y ? scale.x : scale.y;
+		positionExtent = scale.z > positionExtent ? scale.z : positionExtent;
+		float positionMagnitude = fabsf(offset.x) + scale.x;
+		positionMagnitude = fabsf(offset.y) + scale.y > positionMagnitude ? fabsf(offset.y) + scale.y : positionMagnitude;
+		positionMagnitude = fabsf(offset.z) + scale.z > positionMagnitude ? fabsf(offset.z) + scale.z : positionMagnitude;
+
+		float uvExtent = params.uvScale.x > params.uvScale.y ? params.uvScale.x : params.uvScale.y;
+		float uvMagnitude = fabsf(params.uvOffset.x) + params.uvScale.x;
+		uvMagnitude = fabsf(params.uvOffset.y) + params.uvScale.y > uvMagnitude ? fabsf(params.uvOffset.y) + params.uvScale.y : uvMagnitude;
+
+		result.maxPositionError = QuantizationBound(positionExtent, positionMagnitude);
+		result.maxUvError = QuantizationBound(uvExtent, uvMagnitude);
+		result.passed =
+			result.backendsMatch &&
+			result.error.maxPositionError <= result.maxPositionError &&
+			result.error.maxUvError <= result.maxUvError &&
+			result.error.maxNormalError <= maxDirectionErrorDegrees &&
+			result.error.maxTangentError <= maxDirectionErrorDegrees;
+		return result;
+	}
+
+	// Every .obj file directly inside a folder, by name
+	void FindObjFiles(const std::wstring& folder, std::vector<std::wstring>& fileNames)
+	{
+		WIN32_FIND_DATAW found = {};
+		HANDLE search = FindFirstFileW((folder + L"*.obj").c_str(), &found);
+		if (search == INVALID_HANDLE_VALUE)
+			return;
+
+		do
+		{
+			if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				fileNames.push_back(found.cFileName);
+		} while (FindNextFileW(search, &found));
+
+		FindClose(search);
+	}
+
+	// A JSON string, with the few characters file names could need escaped
+	std::string JsonString(const std::string& text)
+	{
+		std::string json = "\"";
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			if (text[i] == '"' || text[i] == '\\')
+				json += '\\';
+			json += text[i];
+		}
+		return json + "\"";
+	}
+
+	bool WriteJson(const char* outputPath, const std::vector<FileResult>& files, int iterations)
+	{
+		FILE* out = OpenBenchmarkJson(outputPath, iterations);
+		if (!out)
+			return false;
+
+		fprintf(out, "  \"files\": [\n");
+		for (size_t f = 0; f < files.size(); f++)
+		{
+			fprintf(out, "    {\n");
+			fprintf(out, "      \"file\": %s,\n", JsonString(WideToNarrow(files[f].fileName)).c_str());
+			fprintf(out, "      \"bytes\": %zu,\n", files[f].fileBytes);
+			fprintf(out, "      \"paths\": [\n");
+			for (size_t p = 0; p < files[f].paths.size(); p++)
+			{
+				const PathResult& path = files[f].paths[p];
+				fprintf(out, "        {\n");
+				fprintf(out, "          \"path\": %s,\n", JsonString(PathToString(path.path)).c_str());
+				fprintf(out, "          \"loaded\": %s,\n", path.loaded ? "true" : "false");
+				fprintf(out, "          \"parseMilliseconds\": %.4f,\n", path.parseMilliseconds);
+				fprintf(out, "          \"megabytesPerSecond\": %.2f,\n", path.megabytesPerSecond);
+				fprintf(out, "          \"peakHeapBytes\": %zu,\n", path.peakHeapBytes);
+				fprintf(out, "          \"vertices\": %zu,\n", path.vertexCount);
+				fprintf(out, "          \"indices\": %zu,\n", path.indexCount);
+				fprintf(out, "          \"submeshes\": %zu,\n", path.submeshCount);
+				fprintf(out, "          \"tangents\": {\n");
+				fprintf(out, "            \"triangles\": %d,\n", path.tangents.triangleCount);
+				fprintf(out, "            \"threads\": %u,\n", path.tangents.threadCount);
+				fprintf(out, "            \"scalarMilliseconds\": %.4f,\n", path.tangents.scalarMilliseconds);
+				fprintf(out, "            \"simdMilliseconds\": %.4f,\n", path.tangents.simdMilliseconds);
+				fprintf(out, "            \"threadedMilliseconds\": %.4f,\n", path.tangents.threadedMilliseconds);
+				fprintf(out, "            \"maxDifference\": %g\n", path.tangents.maxDifference);
+				fprintf(out, "          }\n");
+				fprintf(out, "        }%s\n", p + 1 < files[f].paths.size() ? "," : "");
+			}
+			fprintf(out, "      ]\n");
+			fprintf(out, "    }%s\n", f + 1 < files.size() ? "," : "");
+		}
+		fprintf(out, "  ]\n");
+		fprintf(out, "}\n");
+
+		fclose(out);
+		return true;
+	}
+}
+
+void* operator new(size_t size)
+{
+	char* block = (char*)malloc(size + allocationHeader);
+	if (!block)
+		throw std::bad_alloc();
+	*(size_t*)block = size;
+
+	size_t inUse = heapBytes.fetch_add(size) + size;
+	size_t peak = peakHeapBytes.load();
+	while (inUse > peak && !peakHeapBytes.compare_exchange_weak(peak, inUse))
+	{
+	}
+
+	return block + allocationHeader;
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (!memory)
+		return;
+
+	char* block = (char*)memory - allocationHeader;
+	heapBytes -= *(size_t*)block;
+	free(block);
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	std::wstring folder = FixPath(L"../../Assets/Models/");
+	int iterations = 5;
+	std::string outputPath = "MeshBenchmark.json";
+	bool verify = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::wstring option = argv[i];
+		if (option == L"-verify")
+		{
+			verify = true;
+		}
+		else if (i + 1 >= argc)
+		{
+			break;
+		}
+		else if (option == L"-d")
+		{
+			folder = argv[++i];
+			if (folder.back() != L'/' && folder.back() != L'\\')
+				folder += L'/';
+		}
+		else if (option == L"-n")
+		{
+			iterations = _wtoi(argv[++i]);
+			iterations = iterations > 0 ? iterations : 1;
+		}
+		else if (option == L"-o")
+		{
+			outputPath = WideToNarrow(argv[++i]);
+		}
+	}
+
+	std::vector<std::wstring> fileNames;
+	FindObjFiles(folder, fileNames);
+	if (fileNames.size() == 0)
+	{
+		printf("No .obj files found in %s\n", WideToNarrow(folder).c_str());
+		return 1;
+	}
+
+	if (verify)
+	{
+		printf("%-24s %10s %9s %14s %14s %12s %12s %8s\n", "File", "Vertices", "Backends", "Position err", "Uv err", "Normal deg", "Tangent deg", "Result");
+
+		bool allPassed = true;
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			VerifyResult result = Verify((folder + fileNames[f]).c_str());
+			allPassed = allPassed && result.passed;
+			if (!result.loaded)
+			{
+				printf("%-24s could not be loaded\n", WideToNarrow(fileNames[f]).c_str());
+				continue;
+			}
+
+			printf("%-24s %10zu %9s %6.2e/%6.2e %6.2e/%6.2e %5.3f/%5.3f %5.3f/%5.3f %8s\n",
+				WideToNarrow(fileNames[f]).c_str(), result.vertexCount, result.backendsMatch ? "same" : "DIFFERENT",
+				result.error.maxPositionError, result.maxPositionError, result.error.maxUvError, result.maxUvError,
+				result.error.maxNormalError, maxDirectionErrorDegrees, result.error.maxTangentError, maxDirectionErrorDegrees,
+				result.passed ? "ok" : "FAILED");
+		}
+
+		printf(allPassed ? "All files passed\n" : "Some files failed\n");
+		return allPassed ? 0 : 1;
+	}
+
+	printf("%-24s %-9s %10s %9s %12s %10s %10s %10s %10s\n", "File", "Path", "Parse ms", "MB/s", "Peak heap", "Vertices", "Indices", "Submeshes", "Tangent ms");
+
+	std::vector<FileResult> files;
+	for (size_t f = 0; f < fileNames.size(); f++)
+	{
+		FileResult file;
+		file.fileName = fileNames[f];
+		std::wstring filePath = folder + fileNames[f];
+		{
+			MappedFile mapped(filePath.c_str());
+			file.fileBytes = mapped.GetSize();
+		}
+
+		for (int p = 0; p < PathCount; p++)
+		{
+			PathResult path = RunPath((ImportPath)p, filePath.c_str(), file.fileBytes, iterations);
+			file.paths.push_back(path);
+
+			printf("%-24s %-9s %10.3f %9.1f %9.2f MB %10zu %10zu %10zu %10.3f\n",
+				WideToNarrow(fileNames[f]).c_str(), PathToString(path.path), path.parseMilliseconds, path.megabytesPerSecond,
+				path.peakHeapBytes / (1024.0 * 1024.0), path.vertexCount, path.indexCount, path.submeshCount,
+				path.tangents.threadedMilliseconds);
+		}
+		files.push_back(file);
+	}
+
+	if (!WriteJson(outputPath.c_str(), files, iterations))
+	{
+		printf("Could not write %s\n", outputPath.c_str());
+		return 1;
+	}
+
+	printf("Results written to %s\n", outputPath.c_str());
+	return 0;
+}
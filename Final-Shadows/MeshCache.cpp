@@ -0,0 +1,196 @@
+#include <fstream>
+#include <cstring>
+#include "MeshCache.h"
+#include "MeshCodec.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const char cacheMagic[4] = { 'M', 'S', 'H', 'C' };
+
+	inline unsigned long long RotateLeft64(unsigned long long x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+}
+
+std::wstring MeshCache::GetCachePath(const wchar_t* objFile)
+{
+	return std::wstring(objFile) + L".meshcache";
+}
+
+// --------------------------------------------------------
+// Fast 64-bit content hash (multiply-rotate rounds over 8
+// byte words, in the style of xxHash64)
+// - Runs over the whole OBJ on every launch, so it has to
+//   be much cheaper than parsing it
+// --------------------------------------------------------
+unsigned long long MeshCache::HashBytes(const char* data, size_t size)
+{
+	const unsigned long long prime1 = 0x9E3779B185EBCA87ull;
+	const unsigned long long prime2 = 0xC2B2AE3D27D4EB4Full;
+	const unsigned long long prime3 = 0x165667B19E3779F9ull;
+
+	unsigned long long hash = prime3 + size;
+
+	size_t words = size / 8;
+	for (size_t w = 0; w < words; w++)
+	{
+		unsigned long long k;
+		memcpy(&k, data + w * 8, sizeof(k));
+		k *= prime2;
+		k = RotateLeft64(k, 31);
+		k *= prime1;
+
+		hash ^= k;
+		hash = RotateLeft64(hash, 27) * prime1 + prime3;
+	}
+
+	for (size_t b = words * 8; b < size; b++)
+	{
+		hash ^= (unsigned char)data[b] * prime3;
+		hash = RotateLeft64(hash, 11) * prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+// --------------------------------------------------------
+// Validates a mapped cache file against the source it was
+// made from, and decodes its data if it's usable
+// - Any mismatch (version, vertex layout, source contents,
+//   LOD or meshlet ranges or a truncated file) means the caller should
+//   re-import
+// --------------------------------------------------------
+bool MeshCache::Open(MappedFile& cacheFile, unsigned long long sourceHash, unsigned long long sourceSize, Contents& contents)
+{
+	if (!cacheFile.IsOpen() || cacheFile.GetSize() < sizeof(Header))
+		return false;
+
+	Header header;
+	memcpy(&header, cacheFile.GetData(), sizeof(Header));
+	if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+		header.version != version ||
+		header.vertexStride != sizeof(Vertex) ||
+		header.sourceHash != sourceHash ||
+		header.sourceSize != sourceSize ||
+		header.indexCount == 0 ||
+		header.lodCount == 0 || header.lodCount > MeshOptimizer::maxLodCount)
+		return false;
+
+	for (unsigned int i = 0; i < header.lodCount; i++)
+	{
+		if ((unsigned long long)header.lods[i].indexStart + header.lods[i].indexCount > header.indexCount ||
+			(unsigned long long)header.lods[i].meshletStart + header.lods[i].meshletCount > header.meshletCount)
+			return false;
+	}
+
+	unsigned long long meshletBytes = (unsigned long long)header.meshletCount * sizeof(MeshOptimizer::Meshlet);
+	unsigned long long expectedSize = sizeof(Header) + (unsigned long long)header.vertexBytes + header.indexBytes + meshletBytes;
+	if (cacheFile.GetSize() != expectedSize)
+		return false;
+
+	const unsigned char* vertexData = (const unsigned char*)cacheFile.GetData() + sizeof(Header);
+	const unsigned char* indexData = vertexData + header.vertexBytes;
+	const unsigned char* meshletData = indexData + header.indexBytes;
+
+	contents.vertices.resize(header.vertexCount);
+	contents.indices.resize(header.indexCount);
+	if (!MeshCodec::DecodeVertices(vertexData, header.vertexBytes, contents.vertices.data(), header.vertexCount) ||
+		!MeshCodec::DecodeIndices(indexData, header.indexBytes, contents.indices.data(), header.indexCount))
+		return false;
+
+	// The index stream decodes as deltas, so a damaged file can still
+	// decode cleanly into indices past the end of the vertex buffer
+	for (unsigned int i = 0; i < header.indexCount; i++)
+	{
+		if (contents.indices[i] >= header.vertexCount)
+			return false;
+	}
+
+	contents.meshlets.resize(header.meshletCount);
+	if (header.meshletCount > 0)
+		memcpy(contents.meshlets.data(), meshletData, (size_t)meshletBytes);
+	for (unsigned int i = 0; i < header.meshletCount; i++)
+	{
+		if ((unsigned long long)contents.meshlets[i].indexStart + contents.meshlets[i].indexCount > header.indexCount)
+			return false;
+	}
+
+	contents.header = header;
+	return true;
+}
+
+// Opens the cache file of an OBJ, if there is a valid one
+bool MeshCache::Load(const wchar_t* objFile, Contents& contents)
+{
+	MappedFile source(objFile);
+	if (!source.IsOpen())
+		return false;
+
+	unsigned long long sourceHash = HashBytes(source.GetData(), source.GetSize());
+	MappedFile cacheFile(GetCachePath(objFile).c_str());
+	return Open(cacheFile, sourceHash, source.GetSize(), contents);
+}
+
+// --------------------------------------------------------
+// Writes a cache file for the given processed mesh data
+// - Failing to write (read-only folder, etc.) isn't an
+//   error, the mesh is simply imported again next time
+// --------------------------------------------------------
+bool MeshCache::Write(const wchar_t* cachePath, unsigned long long sourceHash, unsigned long long sourceSize,
+	const MeshOptimizer::ImportStats& importStats, const std::vector<MeshOptimizer::LodLevel>& lods,
+	const std::vector<MeshOptimizer::Meshlet>& meshlets, const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices)
+{
+	if (verts.size() == 0 || indices.size() == 0 || lods.size() == 0 || lods.size() > MeshOptimizer::maxLodCount)
+		return false;
+
+	Header header = {};
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = version;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.vertexStride = sizeof(Vertex);
+	header.vertexCount = (unsigned int)verts.size();
+	header.indexCount = (unsigned int)indices.size();
+	header.importStats = importStats;
+	header.lodCount = (unsigned int)lods.size();
+	for (int i = 0; i < lods.size(); i++)
+		header.lods[i] = lods[i];
+	header.meshletCount = (unsigned int)meshlets.size();
+
+	std::vector<unsigned char> encodedVertices;
+	std::vector<unsigned char> encodedIndices;
+	MeshCodec::EncodeVertices(&verts[0], verts.size(), encodedVertices);
+	MeshCodec::EncodeIndices(&indices[0], indices.size(), encodedIndices);
+	header.vertexBytes = (unsigned int)encodedVertices.size();
+	header.indexBytes = (unsigned int)encodedIndices.size();
+
+	XMVECTOR boundsMin = XMLoadFloat3(&verts[0].position);
+	XMVECTOR boundsMax = boundsMin;
+	for (int i = 1; i < verts.size(); i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&verts[i].position);
+		boundsMin = XMVectorMin(boundsMin, position);
+		boundsMax = XMVectorMax(boundsMax, position);
+	}
+	XMStoreFloat3(&header.boundsMin, boundsMin);
+	XMStoreFloat3(&header.boundsMax, boundsMax);
+
+	std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	file.write((const char*)&header, sizeof(Header));
+	file.write((const char*)&encodedVertices[0], encodedVertices.size());
+	file.write((const char*)&encodedIndices[0], encodedIndices.size());
+	if (meshlets.size() > 0)
+		file.write((const char*)&meshlets[0], meshlets.size() * sizeof(MeshOptimizer::Meshlet));
+	return file.good();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+
+// --------------------------------------------------------
+// Binary cache of fully processed mesh data, stored next to
+// the source OBJ as "<name>.obj.meshcache"
+//
+// - Holds final vertices (tangents included), indices and
+//   meshlets of every LOD, so a valid cache skips parsing and
+//   all import passes, simplification included
+// - Vertices and indices are stored with MeshCodec, which is
+//   about a third smaller and decodes at GB/s
+// - Keyed on a hash of the source file's contents, so an
+//   edited OBJ is re-imported automatically
+// - Bump "version" whenever the import pipeline or the
+//   file layout changes, which invalidates every cache
+// --------------------------------------------------------
+namespace MeshCache
+{
+	const unsigned int version = 7;
+
+	// File layout: Header, encoded vertices (vertexBytes), encoded indices (indexBytes),
+	// then meshletCount plain Meshlets
+	struct Header
+	{
+		char magic[4];					// "MSHC"
+		unsigned int version;
+		unsigned long long sourceHash;
+		unsigned long long sourceSize;
+		unsigned int vertexStride;		// sizeof(Vertex) when written
+		unsigned int vertexCount;
+		unsigned int indexCount;
+		unsigned int vertexBytes;
+		unsigned int indexBytes;
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+		MeshOptimizer::ImportStats importStats;
+		unsigned int lodCount;
+		MeshOptimizer::LodLevel lods[MeshOptimizer::maxLodCount];	// Ranges of the index data
+		unsigned int meshletCount;
+	};
+
+	// Decoded contents of a cache file
+	struct Contents
+	{
+		Header header;
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<MeshOptimizer::Meshlet> meshlets;
+	};
+
+	std::wstring GetCachePath(const wchar_t* objFile);
+	unsigned long long HashBytes(const char* data, size_t size);
+
+	bool Open(MappedFile& cacheFile, unsigned long long sourceHash, unsigned long long sourceSize, Contents& contents);
+	bool Load(const wchar_t* objFile, Contents& contents);
+	bool Write(const wchar_t* cachePath, unsigned long long sourceHash, unsigned long long sourceSize,
+		const MeshOptimizer::ImportStats& importStats, const std::vector<MeshOptimizer::LodLevel>& lods,
+		const std::vector<MeshOptimizer::Meshlet>& meshlets, const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices);
+}
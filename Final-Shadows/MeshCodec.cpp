@@ -0,0 +1,323 @@
+#include <Windows.h>
+#include <compressapi.h>
+#include <intrin.h>
+#include <tmmintrin.h>
+#include <chrono>
+#include <cstring>
+#include <cfloat>
+#include "MeshCodec.h"
+
+// Windows Compression API, only used by the benchmark
+#pragma comment(lib, "Cabinet.lib")
+
+static_assert(sizeof(Vertex) % 4 == 0, "Vertices are encoded as whole 32-bit words");
+
+namespace
+{
+	const size_t vertexWords = sizeof(Vertex) / 4;
+
+	// Byte group lookups for every control byte (four 2-bit lengths)
+	// - shuffle: moves each value's bytes into its own 32-bit lane, 0x80 zeroes the rest
+	// - length: total data bytes used by the four values
+	struct ByteGroupTables
+	{
+		alignas(16) unsigned char shuffle[256][16];
+		unsigned char length[256];
+
+		ByteGroupTables()
+		{
+			for (int control = 0; control < 256; control++)
+			{
+				int offset = 0;
+				for (int lane = 0; lane < 4; lane++)
+				{
+					int bytes = ((control >> (lane * 2)) & 3) + 1;
+					for (int b = 0; b < 4; b++)
+						shuffle[control][lane * 4 + b] = b < bytes ? (unsigned char)(offset + b) : 0x80;
+					offset += bytes;
+				}
+				length[control] = (unsigned char)offset;
+			}
+		}
+	};
+
+	const ByteGroupTables tables;
+
+	bool HasSsse3()
+	{
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 9)) != 0;
+	}
+
+	const bool useSsse3 = HasSsse3();
+
+	// --------------------------------------------------------
+	// Stream layout: byte count of the rest of the stream,
+	// then one control byte per 4 values, then the value bytes
+	// --------------------------------------------------------
+	void EncodeStream(const unsigned int* values, size_t count, std::vector<unsigned char>& encoded)
+	{
+		size_t sizeOffset = encoded.size();
+		encoded.resize(sizeOffset + sizeof(unsigned int));
+
+		size_t controlOffset = encoded.size();
+		encoded.resize(controlOffset + (count + 3) / 4, 0);
+
+		unsigned int previous = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			unsigned int delta = values[i] - previous;
+			unsigned int zigzag = (delta << 1) ^ (unsigned int)((int)delta >> 31);
+			previous = values[i];
+
+			int bytes = zigzag < (1u << 8) ? 1 : (zigzag < (1u << 16) ? 2 : (zigzag < (1u << 24) ? 3 : 4));
+			encoded[controlOffset + i / 4] |= (unsigned char)((bytes - 1) << ((i % 4) * 2));
+			for (int b = 0; b < bytes; b++)
+				encoded.push_back((unsigned char)(zigzag >> (b * 8)));
+		}
+
+		unsigned int streamBytes = (unsigned int)(encoded.size() - controlOffset);
+		memcpy(&encoded[sizeOffset], &streamBytes, sizeof(streamBytes));
+	}
+
+	// Decodes whole groups of 4 while 16 bytes can safely be read, returns how many values it decoded
+	size_t DecodeGroupsSsse3(const unsigned char* control, const unsigned char*& bytes, const unsigned char* end,
+		unsigned int* values, size_t count, unsigned int& previous)
+	{
+		const __m128i one = _mm_set1_epi32(1);
+		__m128i last = _mm_set1_epi32((int)previous);
+
+		size_t i = 0;
+		for (; i + 4 <= count && end - bytes >= 16; i += 4)
+		{
+			unsigned char groupControl = control[i / 4];
+			__m128i packed = _mm_loadu_si128((const __m128i*)bytes);
+			__m128i zigzag = _mm_shuffle_epi8(packed, _mm_load_si128((const __m128i*)tables.shuffle[groupControl]));
+
+			// Undo zigzag: (v >> 1) ^ -(v & 1)
+			__m128i delta = _mm_xor_si128(_mm_srli_epi32(zigzag, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(zigzag, one)));
+
+			// Prefix sum of the 4 deltas, then continue from the last decoded value
+			delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+			delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+			__m128i decoded = _mm_add_epi32(delta, last);
+
+			_mm_storeu_si128((__m128i*)(values + i), decoded);
+			last = _mm_shuffle_epi32(decoded, _MM_SHUFFLE(3, 3, 3, 3));
+			bytes += tables.length[groupControl];
+		}
+
+		previous = (unsigned int)_mm_cvtsi128_si32(last);
+		return i;
+	}
+
+	// Returns the number of bytes the stream used, or 0 if it is malformed
+	size_t DecodeStream(const unsigned char* data, size_t size, unsigned int* values, size_t count)
+	{
+		unsigned int streamBytes;
+		if (size < sizeof(streamBytes))
+			return 0;
+		memcpy(&streamBytes, data, sizeof(streamBytes));
+		if (streamBytes > size - sizeof(streamBytes) || (count + 3) / 4 > streamBytes)
+			return 0;
+
+		const unsigned char* control = data + sizeof(streamBytes);
+		const unsigned char* bytes = control + (count + 3) / 4;
+		const unsigned char* end = control + streamBytes;
+
+		unsigned int previous = 0;
+		size_t i = useSsse3 ? DecodeGroupsSsse3(control, bytes, end, values, count, previous) : 0;
+
+		// Whatever is left near the end of the stream
+		for (; i < count; i++)
+		{
+			int length = ((control[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+			if (end - bytes < length)
+				return 0;
+
+			unsigned int zigzag = 0;
+			for (int b = 0; b < length; b++)
+				zigzag |= (unsigned int)bytes[b] << (b * 8);
+			bytes += length;
+
+			unsigned int delta = (zigzag >> 1) ^ (0u - (zigzag & 1));
+			previous += delta;
+			values[i] = previous;
+		}
+
+		if (bytes != end)
+			return 0;
+		return sizeof(streamBytes) + streamBytes;
+	}
+
+	bool CompressBytes(const std::vector<unsigned char>& input, std::vector<unsigned char>& output)
+	{
+		COMPRESSOR_HANDLE compressor = 0;
+		if (!CreateCompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, 0, &compressor))
+			return false;
+
+		// The first call only reports the size needed
+		SIZE_T compressedSize = 0;
+		Compress(compressor, &input[0], input.size(), 0, 0, &compressedSize);
+		output.resize(compressedSize);
+
+		bool success = Compress(compressor, &input[0], input.size(), &output[0], output.size(), &compressedSize) != FALSE;
+		output.resize(compressedSize);
+
+		CloseCompressor(compressor);
+		return success;
+	}
+
+	bool DecompressBytes(const std::vector<unsigned char>& input, unsigned char* output, size_t outputSize)
+	{
+		DECOMPRESSOR_HANDLE decompressor = 0;
+		if (!CreateDecompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, 0, &decompressor))
+			return false;
+
+		SIZE_T decompressedSize = 0;
+		bool success = Decompress(decompressor, &input[0], input.size(), output, outputSize, &decompressedSize) != FALSE &&
+			decompressedSize == outputSize;
+
+		CloseDecompressor(decompressor);
+		return success;
+	}
+}
+
+void MeshCodec::EncodeIndices(const unsigned int* indices, size_t indexCount, std::vector<unsigned char>& encoded)
+{
+	EncodeStream(indices, indexCount, encoded);
+}
+
+void MeshCodec::EncodeVertices(const Vertex* verts, size_t vertexCount, std::vector<unsigned char>& encoded)
+{
+	// One stream per 32-bit component (position.x, position.y, ... uv.y)
+	std::vector<unsigned int> column(vertexCount);
+	for (size_t word = 0; word < vertexWords; word++)
+	{
+		for (size_t v = 0; v < vertexCount; v++)
+			memcpy(&column[v], (const char*)&verts[v] + word * 4, 4);
+
+		EncodeStream(column.data(), vertexCount, encoded);
+	}
+}
+
+bool MeshCodec::DecodeIndices(const unsigned char* data, size_t size, unsigned int* indices, size_t indexCount)
+{
+	return DecodeStream(data, size, indices, indexCount) == size;
+}
+
+bool MeshCodec::DecodeVertices(const unsigned char* data, size_t size, Vertex* verts, size_t vertexCount)
+{
+	std::vector<unsigned int> column(vertexCount);
+	size_t offset = 0;
+	for (size_t word = 0; word < vertexWords; word++)
+	{
+		size_t used = DecodeStream(data + offset, size - offset, column.data(), vertexCount);
+		if (used == 0)
+			return false;
+		offset += used;
+
+		for (size_t v = 0; v < vertexCount; v++)
+			memcpy((char*)&verts[v] + word * 4, &column[v], 4);
+	}
+	return offset == size;
+}
+
+// --------------------------------------------------------
+// Compares the size of a mesh's data in every Format, and
+// how long it takes to get back to plain vertices/indices
+// - The generic compressor is the Windows XPRESS + Huffman
+//   codec, a typical fast general purpose choice
+// - Times are the fastest of all iterations
+// --------------------------------------------------------
+MeshCodec::BenchmarkResult MeshCodec::Benchmark(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, int iterations)
+{
+	BenchmarkResult result = {};
+	if (verts.size() == 0 || indices.size() == 0)
+		return result;
+
+	size_t vertexBytes = verts.size() * sizeof(Vertex);
+	size_t indexBytes = indices.size() * sizeof(unsigned int);
+	result.decodedBytes = vertexBytes + indexBytes;
+
+	std::vector<unsigned char> raw(result.decodedBytes);
+	memcpy(&raw[0], &verts[0], vertexBytes);
+	memcpy(&raw[vertexBytes], &indices[0], indexBytes);
+
+	// Codec data is the vertex streams followed by the index stream
+	std::vector<unsigned char> codec;
+	EncodeVertices(&verts[0], verts.size(), codec);
+	size_t codecVertexBytes = codec.size();
+	EncodeIndices(&indices[0], indices.size(), codec);
+
+	std::vector<unsigned char> rawCompressed;
+	std::vector<unsigned char> codecCompressed;
+	CompressBytes(raw, rawCompressed);
+	CompressBytes(codec, codecCompressed);
+
+	result.bytes[Raw] = raw.size();
+	result.bytes[RawCompressed] = rawCompressed.size();
+	result.bytes[Codec] = codec.size();
+	result.bytes[CodecCompressed] = codecCompressed.size();
+
+	std::vector<Vertex> decodedVerts(verts.size());
+	std::vector<unsigned int> decodedIndices(indices.size());
+	std::vector<unsigned char> scratch(raw.size() > codec.size() ? raw.size() : codec.size());
+
+	for (int format = 0; format < FormatCount; format++)
+	{
+		double fastest = DBL_MAX;
+		for (int i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			switch (format)
+			{
+				case Raw:
+					memcpy(&decodedVerts[0], &raw[0], vertexBytes);
+					memcpy(&decodedIndices[0], &raw[vertexBytes], indexBytes);
+					break;
+
+				case RawCompressed:
+					DecompressBytes(rawCompressed, &scratch[0], raw.size());
+					memcpy(&decodedVerts[0], &scratch[0], vertexBytes);
+					memcpy(&decodedIndices[0], &scratch[vertexBytes], indexBytes);
+					break;
+
+				case Codec:
+					DecodeVertices(&codec[0], codecVertexBytes, &decodedVerts[0], verts.size());
+					DecodeIndices(&codec[codecVertexBytes], codec.size() - codecVertexBytes, &decodedIndices[0], indices.size());
+					break;
+
+				case CodecCompressed:
+					DecompressBytes(codecCompressed, &scratch[0], codec.size());
+					DecodeVertices(&scratch[0], codecVertexBytes, &decodedVerts[0], verts.size());
+					DecodeIndices(&scratch[codecVertexBytes], codec.size() - codecVertexBytes, &decodedIndices[0], indices.size());
+					break;
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+
+			double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+			if (ms < fastest)
+				fastest = ms;
+		}
+
+		result.milliseconds[format] = iterations > 0 ? fastest : 0.0;
+		if (result.milliseconds[format] > 0.0)
+			result.gigabytesPerSecond[format] = (result.decodedBytes / (1024.0 * 1024.0 * 1024.0)) / (result.milliseconds[format] / 1000.0);
+	}
+
+	return result;
+}
+
+const char* MeshCodec::FormatToString(Format format)
+{
+	switch (format)
+	{
+		case Raw: return "Raw";
+		case RawCompressed: return "Raw + XPRESS";
+		case Codec: return "Codec";
+		case CodecCompressed: return "Codec + XPRESS";
+		default: return "Unknown";
+	}
+}
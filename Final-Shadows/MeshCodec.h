@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Lossless compression of processed vertex and index data,
+// used for MeshCache files
+//
+// - Every stream is delta encoded, zigzagged (so small
+//   negative deltas stay small) and written as byte groups:
+//   a 2 bit length per value, then only the bytes it needs
+// - Indices are one stream, vertices are split into one
+//   stream per 32-bit attribute component, since neighbouring
+//   vertices (after OptimizeVertexFetch) have similar values
+// - Decoding uses SSSE3 shuffles, with a scalar fallback
+// --------------------------------------------------------
+namespace MeshCodec
+{
+	enum Format
+	{
+		Raw,				// Plain Vertex and index arrays
+		RawCompressed,		// Raw, then a generic compressor
+		Codec,				// This codec
+		CodecCompressed,	// This codec, then a generic compressor
+		FormatCount
+	};
+
+	struct BenchmarkResult
+	{
+		size_t decodedBytes;					// Size of the plain vertex and index data
+		size_t bytes[FormatCount];				// Encoded size per format
+		double milliseconds[FormatCount];		// Fastest time to get back to plain data
+		double gigabytesPerSecond[FormatCount];	// Decoded bytes per second
+	};
+
+	void EncodeIndices(const unsigned int* indices, size_t indexCount, std::vector<unsigned char>& encoded);
+	void EncodeVertices(const Vertex* verts, size_t vertexCount, std::vector<unsigned char>& encoded);
+
+	// Return false if the data is too short for the requested count
+	bool DecodeIndices(const unsigned char* data, size_t size, unsigned int* indices, size_t indexCount);
+	bool DecodeVertices(const unsigned char* data, size_t size, Vertex* verts, size_t vertexCount);
+
+	BenchmarkResult Benchmark(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, int iterations);
+	const char* FormatToString(Format format);
+}
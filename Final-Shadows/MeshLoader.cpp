@@ -0,0 +1,140 @@
+#include "MeshLoader.h"
+
+namespace
+{
+	// Finished meshes waiting for the render thread, workers wait for room past this
+	const size_t finishedQueueCapacity = 64;
+}
+
+MeshLoader::MeshLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	unsigned int threadCount)
+	:
+	device(device),
+	context(context),
+	stopping(false),
+	finished(finishedQueueCapacity),
+	pendingCount(0),
+	failedCount(0)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency() / 2;
+	if (threadCount == 0)
+		threadCount = 1;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.emplace_back(&MeshLoader::WorkerLoop, this);
+}
+
+// Waits for the import each worker is busy with, and drops every job not yet started
+MeshLoader::~MeshLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobAvailable.notify_all();
+
+	for (int i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+std::shared_ptr<Mesh> MeshLoader::LoadAsync(const std::wstring& objFile, MeshImportOptions options)
+{
+	Job job;
+	job.mesh = std::make_shared<Mesh>(context, options);
+	job.objFile = objFile;
+	job.options = options;
+	std::shared_ptr<Mesh> mesh = job.mesh;
+
+	Queue(job);
+	return mesh;
+}
+
+// The data is processed like a freshly parsed OBJ, submeshes included, but never cached
+std::shared_ptr<Mesh> MeshLoader::ProcessAsync(MeshData data, MeshImportOptions options)
+{
+	Job job;
+	job.mesh = std::make_shared<Mesh>(context, options);
+	job.data = std::move(data);
+	job.options = options;
+	std::shared_ptr<Mesh> mesh = job.mesh;
+
+	Queue(job);
+	return mesh;
+}
+
+void MeshLoader::Queue(Job& job)
+{
+	pendingCount++;
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+// Uploads every mesh the workers have finished so far
+int MeshLoader::UploadFinished()
+{
+	int uploaded = 0;
+	std::unique_ptr<FinishedMesh> result;
+	while (finished.TryPop(result))
+	{
+		// A mesh nobody holds anymore (like a dropped HLOD proxy) isn't worth a GPU copy
+		// - The worker moved its reference into the result, so the count is only the
+		//   result's plus real owners, and those only change on this thread
+		bool wanted = result->mesh.use_count() > 1;
+		if (result->succeeded && wanted)
+		{
+			result->mesh->Upload(result->data, device);
+			uploaded++;
+		}
+		else if (!result->succeeded)
+		{
+			failedCount++;
+		}
+		pendingCount--;
+	}
+	return uploaded;
+}
+
+void MeshLoader::WorkerLoop()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobAvailable.wait(lock, [this] { return stopping || jobs.size() > 0; });
+			if (stopping)
+				return;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		std::unique_ptr<FinishedMesh> result(new FinishedMesh());
+		// Moved, not copied, so the worker never holds the last reference (Mesh
+		// frees its GeometryPool space, which only the render thread may touch)
+		result->mesh = std::move(job.mesh);
+		if (job.objFile.empty())
+		{
+			result->data = std::move(job.data);
+			Mesh::ProcessImport(result->data, job.options);
+			result->succeeded = result->data.lods.size() > 0;
+		}
+		else
+		{
+			result->succeeded = Mesh::Import(job.objFile.c_str(), job.options, result->data);
+		}
+
+		// Only fills up if the render thread stops uploading, so just wait it out
+		while (!finished.TryPush(std::move(result)))
+		{
+			if (stopping)
+				return;
+			std::this_thread::yield();
+		}
+	}
+}
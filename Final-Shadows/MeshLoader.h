@@ -0,0 +1,80 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "Mesh.h"
+#include "LockFreeQueue.h"
+
+// --------------------------------------------------------
+// Loads meshes on worker threads
+//
+// - LoadAsync() returns an empty Mesh right away, which can
+//   be given to entities and draws nothing until it's ready
+// - Workers run Mesh::Import() (cache read or full import)
+//   and push the finished CPU data to a lock-free queue
+// - ProcessAsync() does the same for mesh data made at
+//   runtime, running just Mesh::ProcessImport() on it
+// - UploadFinished() runs on the render thread once a frame,
+//   creating GPU buffers for whatever has finished, since
+//   the immediate context isn't thread safe
+// --------------------------------------------------------
+class MeshLoader
+{
+public:
+	// threadCount 0 means half the hardware threads, since the Parallel
+	// OBJ backend and tangent generation start threads of their own
+	MeshLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned int threadCount = 0);
+	~MeshLoader();
+
+	std::shared_ptr<Mesh> LoadAsync(const std::wstring& objFile, MeshImportOptions options = MeshImportOptions());
+	std::shared_ptr<Mesh> ProcessAsync(MeshData data, MeshImportOptions options = MeshImportOptions());
+
+	// Returns how many meshes became ready
+	int UploadFinished();
+
+	int GetPendingCount() { return pendingCount.load(); }
+	int GetFailedCount() { return failedCount; }
+
+private:
+	struct Job
+	{
+		std::shared_ptr<Mesh> mesh;
+		std::wstring objFile;		// Empty when the job processes data instead
+		MeshData data;
+		MeshImportOptions options;
+	};
+
+	struct FinishedMesh
+	{
+		std::shared_ptr<Mesh> mesh;
+		MeshData data;
+		bool succeeded;
+	};
+
+	void Queue(Job& job);
+	void WorkerLoop();
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	// Jobs wait here for a worker, which sleeps while there are none
+	std::deque<Job> jobs;
+	std::mutex jobMutex;
+	std::condition_variable jobAvailable;
+	std::atomic<bool> stopping;
+
+	LockFreeQueue<std::unique_ptr<FinishedMesh>> finished;
+	std::atomic<int> pendingCount;		// Queued or being imported, but not yet uploaded
+	int failedCount;
+
+	std::vector<std::thread> workers;
+};
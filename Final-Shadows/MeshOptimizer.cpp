@@ -0,0 +1,1525 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <cmath>
+#include "MeshOptimizer.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// The attributes that decide whether two vertices are the same, as raw integers
+	// - Position in [0..2], normal in [3..5], uv in [6..7]
+	// - Tangents aren't part of it since they are calculated after welding
+	struct WeldKey
+	{
+		unsigned int values[8];
+	};
+
+	const unsigned int emptySlot = 0xFFFFFFFF;
+
+	unsigned int FloatBits(float f)
+	{
+		// -0 and +0 are the same value, so they should weld
+		if (f == 0.0f)
+			return 0;
+
+		unsigned int bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return bits;
+	}
+
+	unsigned int Quantize(float f, float step)
+	{
+		return (unsigned int)(int)floorf(f / step + 0.5f);
+	}
+
+	WeldKey MakeKey(const Vertex& v, const MeshOptimizer::WeldSettings& settings)
+	{
+		WeldKey key;
+		if (settings.mode == MeshOptimizer::WeldQuantized)
+		{
+			key.values[0] = Quantize(v.position.x, settings.positionStep);
+			key.values[1] = Quantize(v.position.y, settings.positionStep);
+			key.values[2] = Quantize(v.position.z, settings.positionStep);
+			key.values[3] = Quantize(v.normal.x, settings.normalStep);
+			key.values[4] = Quantize(v.normal.y, settings.normalStep);
+			key.values[5] = Quantize(v.normal.z, settings.normalStep);
+			key.values[6] = Quantize(v.uv.x, settings.uvStep);
+			key.values[7] = Quantize(v.uv.y, settings.uvStep);
+		}
+		else
+		{
+			key.values[0] = FloatBits(v.position.x);
+			key.values[1] = FloatBits(v.position.y);
+			key.values[2] = FloatBits(v.position.z);
+			key.values[3] = FloatBits(v.normal.x);
+			key.values[4] = FloatBits(v.normal.y);
+			key.values[5] = FloatBits(v.normal.z);
+			key.values[6] = FloatBits(v.uv.x);
+			key.values[7] = FloatBits(v.uv.y);
+		}
+		return key;
+	}
+
+	inline unsigned int RotateLeft(unsigned int x, int r)
+	{
+		return (x << r) | (x >> (32 - r));
+	}
+
+	// MurmurHash3 (x86_32) over the 8 key words
+	unsigned int HashKey(const WeldKey& key)
+	{
+		unsigned int hash = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			unsigned int k = key.values[i];
+			k *= 0xCC9E2D51;
+			k = RotateLeft(k, 15);
+			k *= 0x1B873593;
+
+			hash ^= k;
+			hash = RotateLeft(hash, 13);
+			hash = hash * 5 + 0xE6546B64;
+		}
+
+		hash ^= 32;
+		hash ^= hash >> 16;
+		hash *= 0x85EBCA6B;
+		hash ^= hash >> 13;
+		hash *= 0xC2B2AE35;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	inline bool SamePosition(const WeldKey& a, const WeldKey& b)
+	{
+		return a.values[0] == b.values[0] && a.values[1] == b.values[1] && a.values[2] == b.values[2];
+	}
+}
+
+MeshOptimizer::WeldSettings MeshOptimizer::DefaultWeldSettings(WeldMode mode)
+{
+	WeldSettings settings = {};
+	settings.mode = mode;
+	settings.positionStep = 0.0001f;
+	settings.normalStep = 0.001f;
+	settings.uvStep = 1.0f / 8192.0f;	// Well under a texel of the largest textures
+	return settings;
+}
+
+// --------------------------------------------------------
+// Merges duplicate vertices and rebuilds the index list so
+// neighbouring triangles actually share vertices
+//
+// - OBJ files index each attribute separately, so loaders
+//   give every face corner its own vertex. Corners built
+//   from the same position/uv/normal indices have identical
+//   attributes, so matching on the attributes themselves
+//   welds exactly those (and works for any loader)
+// - Triangles with two corners at the same position are
+//   dropped, and vertices no triangle uses are removed
+// - Surviving vertices keep their first-seen order
+// --------------------------------------------------------
+MeshOptimizer::WeldStats MeshOptimizer::WeldVertices(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, WeldSettings settings)
+{
+	WeldStats stats = {};
+	stats.vertexCountBefore = (int)verts.size();
+	stats.triangleCountBefore = (int)(indices.size() / 3);
+
+	// Open addressing hash table of unique vertex ids, kept at most half full
+	size_t tableSize = 1;
+	while (tableSize < verts.size() * 2)
+		tableSize <<= 1;
+	size_t tableMask = tableSize - 1;
+	std::vector<unsigned int> table(tableSize, emptySlot);
+
+	std::vector<WeldKey> uniqueKeys;
+	std::vector<unsigned int> uniqueSource;		// Which original vertex each unique one came from
+	std::vector<unsigned int> remap(verts.size());
+	uniqueKeys.reserve(verts.size());
+	uniqueSource.reserve(verts.size());
+
+	for (int v = 0; v < verts.size(); v++)
+	{
+		WeldKey key = MakeKey(verts[v], settings);
+
+		size_t slot = HashKey(key) & tableMask;
+		while (table[slot] != emptySlot && memcmp(&uniqueKeys[table[slot]], &key, sizeof(WeldKey)) != 0)
+			slot = (slot + 1) & tableMask;
+
+		if (table[slot] == emptySlot)
+		{
+			table[slot] = (unsigned int)uniqueKeys.size();
+			uniqueKeys.push_back(key);
+			uniqueSource.push_back(v);
+		}
+
+		remap[v] = table[slot];
+	}
+
+	// Rewrite the triangles in terms of unique vertices, skipping degenerate ones
+	std::vector<unsigned int> weldedIndices;
+	std::vector<bool> used(uniqueKeys.size(), false);
+	weldedIndices.reserve(indices.size());
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int a = remap[indices[i]];
+		unsigned int b = remap[indices[i + 1]];
+		unsigned int c = remap[indices[i + 2]];
+
+		if (SamePosition(uniqueKeys[a], uniqueKeys[b]) ||
+			SamePosition(uniqueKeys[b], uniqueKeys[c]) ||
+			SamePosition(uniqueKeys[a], uniqueKeys[c]))
+		{
+			stats.degenerateTriangles++;
+			continue;
+		}
+
+		weldedIndices.push_back(a);
+		weldedIndices.push_back(b);
+		weldedIndices.push_back(c);
+		used[a] = true;
+		used[b] = true;
+		used[c] = true;
+	}
+
+	// Compact: only keep vertices that a remaining triangle uses
+	std::vector<unsigned int> compactIndex(uniqueKeys.size(), emptySlot);
+	std::vector<Vertex> weldedVerts;
+	weldedVerts.reserve(uniqueKeys.size());
+
+	for (int u = 0; u < uniqueKeys.size(); u++)
+	{
+		if (!used[u])
+			continue;
+
+		compactIndex[u] = (unsigned int)weldedVerts.size();
+		weldedVerts.push_back(verts[uniqueSource[u]]);
+	}
+
+	for (int i = 0; i < weldedIndices.size(); i++)
+		weldedIndices[i] = compactIndex[weldedIndices[i]];
+
+	verts.swap(weldedVerts);
+	indices.swap(weldedIndices);
+
+	stats.vertexCountAfter = (int)verts.size();
+	stats.triangleCountAfter = (int)(indices.size() / 3);
+	return stats;
+}
+
+// ------------------------------------------------------------------
+// Vertex cache optimization
+// ------------------------------------------------------------------
+namespace
+{
+	// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	const int forsythCacheSize = 32;
+	const float forsythCacheDecayPower = 1.5f;
+	const float forsythLastTriangleScore = 0.75f;
+	const float forsythValenceBoostScale = 2.0f;
+	const float forsythValenceBoostPower = 0.5f;
+	const int forsythMaxValence = 64;
+
+	// Scores are only ever needed for these inputs, so look them up instead of calling powf
+	struct ForsythScoreTables
+	{
+		float cache[forsythCacheSize];
+		float valence[forsythMaxValence];
+
+		ForsythScoreTables()
+		{
+			for (int i = 0; i < forsythCacheSize; i++)
+			{
+				// The three vertices of the last triangle get a fixed score, so the
+				// next triangle isn't pulled towards reusing all of them again
+				if (i < 3)
+					cache[i] = forsythLastTriangleScore;
+				else
+					cache[i] = powf(1.0f - (i - 3) / (float)(forsythCacheSize - 3), forsythCacheDecayPower);
+			}
+
+			// Vertices with few triangles left are finished off first so they leave the working set
+			valence[0] = 0.0f;
+			for (int i = 1; i < forsythMaxValence; i++)
+				valence[i] = forsythValenceBoostScale * powf((float)i, -forsythValenceBoostPower);
+		}
+	};
+
+	float ForsythVertexScore(const ForsythScoreTables& tables, int cachePosition, unsigned int activeTriangles)
+	{
+		// Nothing left to draw with this vertex
+		if (activeTriangles == 0)
+			return -1.0f;
+
+		float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+		score += tables.valence[activeTriangles < forsythMaxValence ? activeTriangles : forsythMaxValence - 1];
+		return score;
+	}
+}
+
+// --------------------------------------------------------
+// Reorders triangles so consecutive ones reuse vertices that
+// are still in the GPU's post-transform cache
+//
+// - Greedy: always emit the remaining triangle whose vertices
+//   score best, where recently used vertices and vertices
+//   with few triangles left score highest
+// - Only triangles touching the simulated cache are rescored
+//   after each step, which keeps it linear in triangle count
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, int vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	static const ForsythScoreTables tables;
+
+	// Triangle adjacency: vertexTriangles[triangleOffsets[v] .. + activeTriangles[v]] are v's
+	// remaining triangles (emitted ones are swapped past the end)
+	std::vector<unsigned int> activeTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		activeTriangles[indices[i]]++;
+
+	std::vector<unsigned int> triangleOffsets(vertexCount);
+	unsigned int offset = 0;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		triangleOffsets[v] = offset;
+		offset += activeTriangles[v];
+	}
+
+	std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+	std::vector<unsigned int> filled(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t * 3 + c];
+			vertexTriangles[triangleOffsets[v] + filled[v]++] = (unsigned int)t;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+		vertexScore[v] = ForsythVertexScore(tables, -1, activeTriangles[v]);
+
+	// Start from the best scoring triangle of the whole mesh
+	std::vector<bool> emitted(triangleCount, false);
+	int bestTriangle = 0;
+	float bestStartScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (score > bestStartScore)
+		{
+			bestStartScore = score;
+			bestTriangle = (int)t;
+		}
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	// Simulated LRU cache, with room for the 3 new vertices pushing old ones out
+	unsigned int cache[forsythCacheSize + 3];
+	int cacheCount = 0;
+	size_t scanCursor = 0;
+
+	while (bestTriangle >= 0)
+	{
+		const unsigned int* tri = &indices[bestTriangle * 3];
+		emitted[bestTriangle] = true;
+		output.push_back(tri[0]);
+		output.push_back(tri[1]);
+		output.push_back(tri[2]);
+
+		// Remove the triangle from its vertices' remaining lists
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = tri[c];
+			unsigned int* list = &vertexTriangles[triangleOffsets[v]];
+			for (unsigned int i = 0; i < activeTriangles[v]; i++)
+			{
+				if (list[i] == (unsigned int)bestTriangle)
+				{
+					list[i] = list[activeTriangles[v] - 1];
+					activeTriangles[v]--;
+					break;
+				}
+			}
+		}
+
+		// Move the triangle's vertices to the front of the cache
+		unsigned int newCache[forsythCacheSize + 3];
+		int newCount = 0;
+		newCache[newCount++] = tri[0];
+		newCache[newCount++] = tri[1];
+		newCache[newCount++] = tri[2];
+		for (int i = 0; i < cacheCount; i++)
+		{
+			if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+				newCache[newCount++] = cache[i];
+		}
+
+		// Rescore everything that was or still is in the cache
+		for (int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < forsythCacheSize ? i : -1;
+			vertexScore[v] = ForsythVertexScore(tables, cachePosition[v], activeTriangles[v]);
+		}
+
+		// Only triangles around those vertices changed score, so the best one is among them
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			const unsigned int* list = &vertexTriangles[triangleOffsets[v]];
+			for (unsigned int j = 0; j < activeTriangles[v]; j++)
+			{
+				unsigned int t = list[j];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = (int)t;
+				}
+			}
+		}
+
+		cacheCount = newCount < forsythCacheSize ? newCount : forsythCacheSize;
+		for (int i = 0; i < cacheCount; i++)
+			cache[i] = newCache[i];
+
+		// Nothing connected to the cache is left, continue with the next unused triangle
+		if (bestTriangle < 0)
+		{
+			while (scanCursor < triangleCount && emitted[scanCursor])
+				scanCursor++;
+			if (scanCursor < triangleCount)
+				bestTriangle = (int)scanCursor;
+		}
+	}
+
+	// Keep any trailing indices that didn't form a whole triangle
+	for (size_t i = triangleCount * 3; i < indices.size(); i++)
+		output.push_back(indices[i]);
+
+	indices.swap(output);
+}
+
+// --------------------------------------------------------
+// Simulates a post-transform vertex cache over an index list
+// and reports how many vertices would have to be shaded
+// --------------------------------------------------------
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices, int vertexCount, int cacheSize, CacheModel model)
+{
+	VertexCacheStats stats = {};
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return stats;
+
+	unsigned int misses = 0;
+
+	if (model == CacheFIFO)
+	{
+		// A vertex is still cached if fewer than cacheSize misses happened since it was added
+		std::vector<long long> addedAt(vertexCount, -(long long)cacheSize - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			unsigned int v = indices[i];
+			if ((long long)misses - addedAt[v] >= cacheSize)
+			{
+				addedAt[v] = misses;
+				misses++;
+			}
+		}
+	}
+	else
+	{
+		std::vector<unsigned int> cache;
+		cache.reserve(cacheSize + 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			unsigned int v = indices[i];
+
+			int found = -1;
+			for (int c = 0; c < cache.size(); c++)
+			{
+				if (cache[c] == v)
+				{
+					found = c;
+					break;
+				}
+			}
+
+			if (found < 0)
+			{
+				misses++;
+				cache.insert(cache.begin(), v);
+				if (cache.size() > cacheSize)
+					cache.pop_back();
+			}
+			else
+			{
+				cache.erase(cache.begin() + found);
+				cache.insert(cache.begin(), v);
+			}
+		}
+	}
+
+	stats.acmr = (float)misses / triangleCount;
+	stats.atvr = (float)misses / vertexCount;
+	return stats;
+}
+
+// ------------------------------------------------------------------
+// Overdraw optimization
+// ------------------------------------------------------------------
+namespace
+{
+	// FIFO cache simulation that can be flushed in O(1): a vertex is cached while
+	// fewer than cacheSize misses happened since it was added
+	struct FifoCacheSimulator
+	{
+		std::vector<long long> addedAt;
+		long long misses;
+
+		FifoCacheSimulator(int vertexCount) :
+			addedAt(vertexCount, -(long long)MeshOptimizer::fifoCacheSize - 1),
+			misses(0)
+		{
+		}
+
+		// Returns how many of the triangle's vertices had to be shaded
+		int AddTriangle(const unsigned int* tri)
+		{
+			int triangleMisses = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				if (misses - addedAt[tri[c]] >= MeshOptimizer::fifoCacheSize)
+				{
+					addedAt[tri[c]] = misses;
+					misses++;
+					triangleMisses++;
+				}
+			}
+			return triangleMisses;
+		}
+
+		// Pushing cacheSize fake misses evicts everything
+		void Flush() { misses += MeshOptimizer::fifoCacheSize; }
+	};
+
+	struct OverdrawCluster
+	{
+		size_t firstTriangle;
+		size_t triangleCount;
+		float sortKey;
+	};
+}
+
+// --------------------------------------------------------
+// Reorders groups of triangles so the ones most likely to
+// hide the rest of the mesh are drawn first
+// (Sander, Nehab & Barczak, "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw")
+//
+// - Expects an index list already run through
+//   OptimizeVertexCache. It's split into clusters wherever the
+//   cache order starts somewhere new (all 3 vertices miss),
+//   then split further wherever a cluster's ACMR so far is
+//   within "threshold" of the whole run's ACMR, so reordering
+//   whole clusters costs little cache efficiency
+// - Clusters facing away from the mesh's center are on the
+//   outside and occlude the ones behind them from almost any
+//   direction, so they are sorted by
+//   dot(clusterCenter - meshCenter, clusterNormal), largest first
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(const std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || verts.size() == 0)
+		return;
+
+	FifoCacheSimulator cache((int)verts.size());
+
+	// Hard boundaries: the cache order jumped to an unconnected part of the mesh
+	std::vector<size_t> hardStarts;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (cache.AddTriangle(&indices[t * 3]) == 3 || t == 0)
+			hardStarts.push_back(t);
+	}
+	hardStarts.push_back(triangleCount);
+
+	// Soft boundaries: split each run as soon as its ACMR comes close to the run's total
+	std::vector<OverdrawCluster> clusters;
+	for (int h = 0; h + 1 < hardStarts.size(); h++)
+	{
+		size_t start = hardStarts[h];
+		size_t end = hardStarts[h + 1];
+
+		cache.Flush();
+		int runMisses = 0;
+		for (size_t t = start; t < end; t++)
+			runMisses += cache.AddTriangle(&indices[t * 3]);
+		float runAcmr = (float)runMisses / (end - start);
+
+		cache.Flush();
+		size_t clusterStart = start;
+		int clusterMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			clusterMisses += cache.AddTriangle(&indices[t * 3]);
+
+			float clusterAcmr = (float)clusterMisses / (t - clusterStart + 1);
+			if (t + 1 == end || clusterAcmr <= threshold * runAcmr)
+			{
+				OverdrawCluster cluster = {};
+				cluster.firstTriangle = clusterStart;
+				cluster.triangleCount = t - clusterStart + 1;
+				clusters.push_back(cluster);
+
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				cache.Flush();
+			}
+		}
+	}
+
+	// Mesh center as the average of every triangle corner
+	XMVECTOR meshCenter = XMVectorZero();
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		meshCenter += XMLoadFloat3(&verts[indices[i]].position);
+	meshCenter = meshCenter / (float)(triangleCount * 3);
+
+	for (int i = 0; i < clusters.size(); i++)
+	{
+		// Area weighted center and normal of the cluster
+		XMVECTOR centerSum = XMVectorZero();
+		XMVECTOR normalSum = XMVectorZero();
+		float areaSum = 0.0f;
+
+		for (size_t t = clusters[i].firstTriangle; t < clusters[i].firstTriangle + clusters[i].triangleCount; t++)
+		{
+			XMVECTOR a = XMLoadFloat3(&verts[indices[t * 3]].position);
+			XMVECTOR b = XMLoadFloat3(&verts[indices[t * 3 + 1]].position);
+			XMVECTOR c = XMLoadFloat3(&verts[indices[t * 3 + 2]].position);
+
+			// Front faces are clockwise, which makes this point out of the surface
+			XMVECTOR normal = XMVector3Cross(b - a, c - a);
+			float area = XMVectorGetX(XMVector3Length(normal));
+
+			normalSum += normal;
+			centerSum += (a + b + c) * (area / 3.0f);
+			areaSum += area;
+		}
+
+		if (areaSum <= 0.0f)
+			continue;
+
+		XMVECTOR center = centerSum / areaSum;
+		XMVECTOR normal = XMVector3Normalize(normalSum);
+		clusters[i].sortKey = XMVectorGetX(XMVector3Dot(center - meshCenter, normal));
+	}
+
+	// Stable, so equal clusters keep their cache-friendly order
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const OverdrawCluster& a, const OverdrawCluster& b) { return a.sortKey > b.sortKey; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (int c = 0; c < clusters.size(); c++)
+	{
+		size_t first = clusters[c].firstTriangle * 3;
+		output.insert(output.end(), indices.begin() + first, indices.begin() + first + clusters[c].triangleCount * 3);
+	}
+	for (size_t i = triangleCount * 3; i < indices.size(); i++)
+		output.push_back(indices[i]);
+
+	indices.swap(output);
+}
+
+// --------------------------------------------------------
+// Estimates overdraw by rasterizing the mesh on the CPU
+//
+// - Renders orthographic views from directions spread evenly
+//   over a sphere, with back faces culled and a depth test,
+//   submitting triangles in index order like the GPU would
+// - A pixel counts as shaded every time a triangle passes the
+//   depth test there, so drawing front to back lowers it
+// --------------------------------------------------------
+MeshOptimizer::OverdrawStats MeshOptimizer::EstimateOverdraw(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, int directionCount, int resolution)
+{
+	OverdrawStats stats = {};
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || verts.size() == 0 || directionCount <= 0 || resolution <= 0)
+		return stats;
+
+	std::vector<float> depthBuffer((size_t)resolution * resolution);
+	std::vector<XMFLOAT3> projected(verts.size());
+
+	for (int d = 0; d < directionCount; d++)
+	{
+		// Fibonacci sphere for evenly spread view directions
+		float y = 1.0f - 2.0f * (d + 0.5f) / directionCount;
+		float radius = sqrtf(1.0f - y * y);
+		float angle = d * 2.39996323f;	// Golden angle in radians
+		XMVECTOR viewDir = XMVectorSet(cosf(angle) * radius, y, sinf(angle) * radius, 0);
+
+		XMVECTOR up = fabsf(y) < 0.99f ? XMVectorSet(0, 1, 0, 0) : XMVectorSet(1, 0, 0, 0);
+		XMVECTOR right = XMVector3Normalize(XMVector3Cross(up, viewDir));
+		up = XMVector3Cross(viewDir, right);
+
+		// Project into view space and fit the mesh to the render target
+		float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+		for (int v = 0; v < verts.size(); v++)
+		{
+			XMVECTOR position = XMLoadFloat3(&verts[v].position);
+			XMFLOAT3& p = projected[v];
+			p.x = XMVectorGetX(XMVector3Dot(position, right));
+			p.y = XMVectorGetX(XMVector3Dot(position, up));
+			p.z = XMVectorGetX(XMVector3Dot(position, viewDir));
+
+			minX = p.x < minX ? p.x : minX;
+			minY = p.y < minY ? p.y : minY;
+			maxX = p.x > maxX ? p.x : maxX;
+			maxY = p.y > maxY ? p.y : maxY;
+		}
+
+		float extent = (maxX - minX) > (maxY - minY) ? (maxX - minX) : (maxY - minY);
+		float scale = extent > 0.0f ? (resolution - 1) / extent : 0.0f;
+
+		std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			const unsigned int* tri = &indices[t * 3];
+
+			// Back face culling in world space (front faces point against the view direction)
+			XMVECTOR a = XMLoadFloat3(&verts[tri[0]].position);
+			XMVECTOR b = XMLoadFloat3(&verts[tri[1]].position);
+			XMVECTOR c = XMLoadFloat3(&verts[tri[2]].position);
+			if (XMVectorGetX(XMVector3Dot(XMVector3Cross(b - a, c - a), viewDir)) >= 0.0f)
+				continue;
+
+			float x0 = (projected[tri[0]].x - minX) * scale, y0 = (projected[tri[0]].y - minY) * scale;
+			float x1 = (projected[tri[1]].x - minX) * scale, y1 = (projected[tri[1]].y - minY) * scale;
+			float x2 = (projected[tri[2]].x - minX) * scale, y2 = (projected[tri[2]].y - minY) * scale;
+			float z0 = projected[tri[0]].z, z1 = projected[tri[1]].z, z2 = projected[tri[2]].z;
+
+			float area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+			if (area == 0.0f)
+				continue;
+			float sign = area < 0.0f ? -1.0f : 1.0f;
+
+			// Bounding box of pixel centers the triangle could cover
+			float boxMinX = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+			float boxMaxX = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+			float boxMinY = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+			float boxMaxY = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+			int startX = (int)ceilf(boxMinX - 0.5f), endX = (int)floorf(boxMaxX - 0.5f);
+			int startY = (int)ceilf(boxMinY - 0.5f), endY = (int)floorf(boxMaxY - 0.5f);
+			startX = startX < 0 ? 0 : startX;
+			startY = startY < 0 ? 0 : startY;
+			endX = endX >= resolution ? resolution - 1 : endX;
+			endY = endY >= resolution ? resolution - 1 : endY;
+
+			for (int py = startY; py <= endY; py++)
+			{
+				float sy = py + 0.5f;
+				for (int px = startX; px <= endX; px++)
+				{
+					float sx = px + 0.5f;
+
+					// Edge functions, each one is the barycentric weight of the opposite corner
+					float w0 = ((x2 - x1) * (sy - y1) - (y2 - y1) * (sx - x1)) * sign;
+					float w1 = ((x0 - x2) * (sy - y2) - (y0 - y2) * (sx - x2)) * sign;
+					float w2 = ((x1 - x0) * (sy - y0) - (y1 - y0) * (sx - x0)) * sign;
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+						continue;
+
+					float depth = (w0 * z0 + w1 * z1 + w2 * z2) / (area * sign);
+					float& stored = depthBuffer[(size_t)py * resolution + px];
+					if (depth < stored)
+					{
+						stored = depth;
+						stats.pixelsShaded++;
+					}
+				}
+			}
+		}
+
+		for (int p = 0; p < depthBuffer.size(); p++)
+		{
+			if (depthBuffer[p] != FLT_MAX)
+				stats.pixelsCovered++;
+		}
+	}
+
+	stats.overdraw = stats.pixelsCovered > 0 ? (float)stats.pixelsShaded / stats.pixelsCovered : 0.0f;
+	return stats;
+}
+
+// ------------------------------------------------------------------
+// Vertex fetch optimization
+// ------------------------------------------------------------------
+
+// --------------------------------------------------------
+// Rewrites the vertex list in the order the index list first
+// uses each vertex, so the GPU reads the vertex buffer mostly
+// front to back instead of jumping around in OBJ order
+// - Run after every pass that reorders triangles
+// - Vertices no triangle uses are dropped
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned int> remap(verts.size(), emptySlot);
+	std::vector<Vertex> reordered;
+	reordered.reserve(verts.size());
+
+	for (int i = 0; i < indices.size(); i++)
+	{
+		unsigned int v = indices[i];
+		if (remap[v] == emptySlot)
+		{
+			remap[v] = (unsigned int)reordered.size();
+			reordered.push_back(verts[v]);
+		}
+		indices[i] = remap[v];
+	}
+
+	verts.swap(reordered);
+}
+
+// --------------------------------------------------------
+// Simulates the cache between the input assembler and the
+// vertex buffer, with every index reading its whole vertex
+// --------------------------------------------------------
+MeshOptimizer::VertexFetchStats MeshOptimizer::AnalyzeVertexFetch(const std::vector<unsigned int>& indices, int vertexCount, int vertexSize)
+{
+	VertexFetchStats stats = {};
+	if (indices.size() == 0 || vertexCount == 0 || vertexSize <= 0)
+		return stats;
+
+	// Same FIFO trick as the post-transform simulation: a line is cached while fewer
+	// than fetchCacheLines misses happened since it was loaded
+	size_t lineCount = ((size_t)vertexCount * vertexSize + fetchCacheLineSize - 1) / fetchCacheLineSize;
+	std::vector<long long> loadedAt(lineCount, -(long long)fetchCacheLines - 1);
+	long long misses = 0;
+	long long accesses = 0;
+
+	for (int i = 0; i < indices.size(); i++)
+	{
+		size_t firstByte = (size_t)indices[i] * vertexSize;
+		size_t firstLine = firstByte / fetchCacheLineSize;
+		size_t lastLine = (firstByte + vertexSize - 1) / fetchCacheLineSize;
+
+		for (size_t line = firstLine; line <= lastLine; line++)
+		{
+			accesses++;
+			if (misses - loadedAt[line] >= fetchCacheLines)
+			{
+				loadedAt[line] = misses;
+				misses++;
+			}
+		}
+	}
+
+	stats.hitRate = 1.0f - (float)misses / accesses;
+	stats.overfetch = (float)(misses * fetchCacheLineSize) / ((float)vertexCount * vertexSize);
+	return stats;
+}
+
+// ------------------------------------------------------------------
+// Simplification
+// ------------------------------------------------------------------
+namespace
+{
+	// Sum of squared distances to a set of planes, each weighted by the area it came from
+	// - error(p) = p'Ap + 2b'p + c, where A is symmetric so only 6 of its values are kept
+	struct Quadric
+	{
+		double a00, a11, a22, a10, a20, a21;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	// Plane n.p + d = 0, with a unit length normal
+	Quadric QuadricFromPlane(double nx, double ny, double nz, double d, double weight)
+	{
+		Quadric q;
+		q.a00 = nx * nx * weight;
+		q.a11 = ny * ny * weight;
+		q.a22 = nz * nz * weight;
+		q.a10 = ny * nx * weight;
+		q.a20 = nz * nx * weight;
+		q.a21 = nz * ny * weight;
+		q.b0 = nx * d * weight;
+		q.b1 = ny * d * weight;
+		q.b2 = nz * d * weight;
+		q.c = d * d * weight;
+		q.weight = weight;
+		return q;
+	}
+
+	void QuadricAdd(Quadric& q, const Quadric& other)
+	{
+		q.a00 += other.a00;
+		q.a11 += other.a11;
+		q.a22 += other.a22;
+		q.a10 += other.a10;
+		q.a20 += other.a20;
+		q.a21 += other.a21;
+		q.b0 += other.b0;
+		q.b1 += other.b1;
+		q.b2 += other.b2;
+		q.c += other.c;
+		q.weight += other.weight;
+	}
+
+	// Mean squared distance from a point to the quadric's planes
+	double QuadricError(const Quadric& q, const XMFLOAT3& p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double rx = q.a00 * x + q.a10 * y + q.a20 * z;
+		double ry = q.a10 * x + q.a11 * y + q.a21 * z;
+		double rz = q.a20 * x + q.a21 * y + q.a22 * z;
+		double error = x * rx + y * ry + z * rz + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+		return fabs(error) / (q.weight > 0.0 ? q.weight : 1.0);
+	}
+
+	// Keeps open edges in place: they're weighted as if they were this many times longer
+	const double borderWeight = 10.0;
+
+	enum SimplifyVertexKind
+	{
+		KindManifold,	// Surrounded by triangles, one vertex at its position
+		KindBorder,		// On the edge of a hole or an open surface
+		KindSeam,		// Two vertices at one position along a uv or normal seam
+		KindLocked,		// Anything else (corners of seams, non-manifold), never moves
+		KindCount
+	};
+
+	// Which kinds a vertex may collapse onto (source row, target column)
+	// - Border and seam vertices only slide along their own border or seam,
+	//   which keeps outlines and texture seams in shape
+	const bool canCollapse[KindCount][KindCount] =
+	{
+		{ true, true, true, true },
+		{ false, true, false, false },
+		{ false, false, true, false },
+		{ false, false, false, false }
+	};
+
+	// Whether an edge between two kinds is walked in both directions by the
+	// triangles (ignoring attributes), so only one direction needs checking
+	const bool hasOpposite[KindCount][KindCount] =
+	{
+		{ true, true, true, true },
+		{ true, false, true, false },
+		{ true, true, true, true },
+		{ true, false, true, false }
+	};
+
+	struct EdgeCollapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double error;
+	};
+
+	// Groups items by vertex with a counting sort: vertex v's items are
+	// items[offsets[v] .. offsets[v + 1]]
+	struct VertexAdjacency
+	{
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> items;
+	};
+
+	// Outgoing edges of each vertex, as the vertex each one leads to
+	void BuildEdgeAdjacency(const std::vector<unsigned int>& indices, size_t vertexCount, VertexAdjacency& adjacency)
+	{
+		adjacency.offsets.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency.offsets[indices[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+		adjacency.items.resize(indices.size());
+		std::vector<unsigned int> filled(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		for (size_t t = 0; t < indices.size() / 3; t++)
+		{
+			for (int e = 0; e < 3; e++)
+				adjacency.items[filled[indices[t * 3 + e]]++] = indices[t * 3 + (e + 1) % 3];
+		}
+	}
+
+	bool HasEdge(const VertexAdjacency& adjacency, unsigned int a, unsigned int b)
+	{
+		for (unsigned int i = adjacency.offsets[a]; i < adjacency.offsets[a + 1]; i++)
+		{
+			if (adjacency.items[i] == b)
+				return true;
+		}
+		return false;
+	}
+
+	// Triangles touching each position
+	void BuildTriangleAdjacency(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& positionRemap, VertexAdjacency& adjacency)
+	{
+		size_t vertexCount = positionRemap.size();
+		adjacency.offsets.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency.offsets[positionRemap[indices[i]] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+		adjacency.items.resize(indices.size());
+		std::vector<unsigned int> filled(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency.items[filled[positionRemap[indices[i]]]++] = (unsigned int)(i / 3);
+	}
+
+	// Moving corner c of triangle (a, b, c) to d flips it if its normal turns around
+	bool FlipsTriangle(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, const XMFLOAT3& d)
+	{
+		XMVECTOR va = XMLoadFloat3(&a);
+		XMVECTOR edgeB = XMLoadFloat3(&b) - va;
+		XMVECTOR before = XMVector3Cross(edgeB, XMLoadFloat3(&c) - va);
+		XMVECTOR after = XMVector3Cross(edgeB, XMLoadFloat3(&d) - va);
+		return XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f;
+	}
+
+	// Whether moving "from" onto "to" flips any triangle that survives the collapse
+	// - Corners go through collapseRemap, so collapses made earlier in the same pass count
+	bool CollapseFlipsTriangles(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices,
+		const VertexAdjacency& triangles, const std::vector<unsigned int>& positionRemap,
+		const std::vector<unsigned int>& collapseRemap, unsigned int from, unsigned int to)
+	{
+		unsigned int fromPosition = positionRemap[from];
+		unsigned int toPosition = positionRemap[to];
+
+		for (unsigned int i = triangles.offsets[fromPosition]; i < triangles.offsets[fromPosition + 1]; i++)
+		{
+			const unsigned int* tri = &indices[triangles.items[i] * 3];
+			unsigned int a = collapseRemap[tri[0]];
+			unsigned int b = collapseRemap[tri[1]];
+			unsigned int c = collapseRemap[tri[2]];
+
+			// Triangles on the collapsing edge disappear
+			if (positionRemap[a] == toPosition || positionRemap[b] == toPosition || positionRemap[c] == toPosition)
+				continue;
+
+			// Rotate the moving corner to the end, keeping the winding
+			if (positionRemap[a] == fromPosition)
+			{
+				unsigned int moving = a;
+				a = b;
+				b = c;
+				c = moving;
+			}
+			else if (positionRemap[b] == fromPosition)
+			{
+				unsigned int moving = b;
+				b = a;
+				a = c;
+				c = moving;
+			}
+
+			if (FlipsTriangle(verts[a].position, verts[b].position, verts[c].position, verts[to].position))
+				return true;
+		}
+		return false;
+	}
+}
+
+// --------------------------------------------------------
+// Reduces a mesh to about targetIndexCount indices by
+// collapsing edges, cheapest first (Garland & Heckbert,
+// "Surface Simplification Using Quadric Error Metrics")
+//
+// - Vertices only ever move onto other existing vertices,
+//   so the result indexes the same vertex list
+// - Every position gets a quadric of the planes around it;
+//   collapsing an edge merges them, so the error of a later
+//   collapse is measured against the original surface
+// - Vertices are classified first, so borders and uv/normal
+//   seams only slide along themselves and stay watertight
+// - Each pass collapses the cheapest edges whose vertices
+//   haven't moved yet that pass, then rebuilds the triangles
+// - Stops short of the target rather than make a collapse
+//   with an error above maxError (a distance)
+// - Returns the largest error of any collapse, as a distance
+// --------------------------------------------------------
+float MeshOptimizer::SimplifyMesh(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError,
+	std::vector<unsigned int>& simplified)
+{
+	simplified = indices;
+	size_t vertexCount = verts.size();
+	if (indices.size() <= targetIndexCount || vertexCount == 0)
+		return 0.0f;
+
+	// Vertices that only differ in normal or uv share a position, which is
+	// represented by the first of them; wedge links them in a cycle
+	std::vector<unsigned int> positionRemap(vertexCount);
+	std::vector<unsigned int> wedge(vertexCount);
+	{
+		size_t tableSize = 1;
+		while (tableSize < vertexCount * 2)
+			tableSize <<= 1;
+		size_t tableMask = tableSize - 1;
+		std::vector<unsigned int> table(tableSize, emptySlot);
+		std::vector<WeldKey> keys(vertexCount);
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			WeldKey& key = keys[v];
+			memset(&key, 0, sizeof(WeldKey));
+			key.values[0] = FloatBits(verts[v].position.x);
+			key.values[1] = FloatBits(verts[v].position.y);
+			key.values[2] = FloatBits(verts[v].position.z);
+
+			size_t slot = HashKey(key) & tableMask;
+			while (table[slot] != emptySlot && !SamePosition(keys[table[slot]], key))
+				slot = (slot + 1) & tableMask;
+
+			if (table[slot] == emptySlot)
+			{
+				table[slot] = (unsigned int)v;
+				positionRemap[v] = (unsigned int)v;
+				wedge[v] = (unsigned int)v;
+			}
+			else
+			{
+				unsigned int first = table[slot];
+				positionRemap[v] = first;
+				wedge[v] = wedge[first];
+				wedge[first] = (unsigned int)v;
+			}
+		}
+	}
+
+	// Open edges have no triangle going the other way: record where each vertex's open edge
+	// leads and comes from (the vertex itself if there is more than one)
+	VertexAdjacency edges;
+	BuildEdgeAdjacency(indices, vertexCount, edges);
+
+	std::vector<unsigned int> openOut(vertexCount, emptySlot);
+	std::vector<unsigned int> openIn(vertexCount, emptySlot);
+	for (size_t t = 0; t < indices.size() / 3; t++)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int a = indices[t * 3 + e];
+			unsigned int b = indices[t * 3 + (e + 1) % 3];
+			if (!HasEdge(edges, b, a))
+			{
+				openOut[a] = openOut[a] == emptySlot ? b : a;
+				openIn[b] = openIn[b] == emptySlot ? a : b;
+			}
+		}
+	}
+
+	// Classify each position, and give all its vertices the same kind
+	std::vector<unsigned char> kind(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (positionRemap[v] != v)
+		{
+			kind[v] = kind[positionRemap[v]];
+			continue;
+		}
+
+		bool openInValid = openIn[v] != emptySlot && openIn[v] != v;
+		bool openOutValid = openOut[v] != emptySlot && openOut[v] != v;
+
+		if (wedge[v] == v)
+		{
+			if (openIn[v] == emptySlot && openOut[v] == emptySlot)
+				kind[v] = KindManifold;
+			else if (openInValid && openOutValid)
+				kind[v] = KindBorder;
+			else
+				kind[v] = KindLocked;
+		}
+		else if (wedge[wedge[v]] == v)
+		{
+			// A seam: the other vertex's open edges run the opposite way between the same positions
+			unsigned int w = wedge[v];
+			bool wedgeValid = openIn[w] != emptySlot && openIn[w] != w && openOut[w] != emptySlot && openOut[w] != w;
+			if (openInValid && openOutValid && wedgeValid &&
+				positionRemap[openIn[w]] == positionRemap[openOut[v]] &&
+				positionRemap[openOut[w]] == positionRemap[openIn[v]])
+				kind[v] = KindSeam;
+			else
+				kind[v] = KindLocked;
+		}
+		else
+		{
+			kind[v] = KindLocked;
+		}
+	}
+
+	// Quadrics of each position: the planes of its triangles, plus planes through open edges
+	// (perpendicular to their triangle) so borders and seams resist moving sideways
+	std::vector<Quadric> quadrics(vertexCount, Quadric());
+	for (size_t t = 0; t < indices.size() / 3; t++)
+	{
+		const unsigned int* tri = &indices[t * 3];
+		XMVECTOR p0 = XMLoadFloat3(&verts[tri[0]].position);
+		XMVECTOR p1 = XMLoadFloat3(&verts[tri[1]].position);
+		XMVECTOR p2 = XMLoadFloat3(&verts[tri[2]].position);
+
+		XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+		float length = XMVectorGetX(XMVector3Length(normal));
+		if (length == 0.0f)
+			continue;
+
+		normal = XMVector3Normalize(normal);
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, normal);
+		float d = -XMVectorGetX(XMVector3Dot(normal, p0));
+		Quadric plane = QuadricFromPlane(n.x, n.y, n.z, d, length * 0.5);
+		for (int c = 0; c < 3; c++)
+			QuadricAdd(quadrics[positionRemap[tri[c]]], plane);
+
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int a = tri[e];
+			unsigned int b = tri[(e + 1) % 3];
+			if ((kind[a] != KindBorder && kind[a] != KindSeam) || openOut[a] != b)
+				continue;
+
+			XMVECTOR pa = XMLoadFloat3(&verts[a].position);
+			XMVECTOR edge = XMLoadFloat3(&verts[b].position) - pa;
+			float edgeLengthSq = XMVectorGetX(XMVector3LengthSq(edge));
+			if (edgeLengthSq == 0.0f)
+				continue;
+
+			XMVECTOR edgeNormal = XMVector3Normalize(XMVector3Cross(edge, normal));
+			XMFLOAT3 en;
+			XMStoreFloat3(&en, edgeNormal);
+			float ed = -XMVectorGetX(XMVector3Dot(edgeNormal, pa));
+			Quadric edgePlane = QuadricFromPlane(en.x, en.y, en.z, ed, edgeLengthSq * borderWeight);
+			QuadricAdd(quadrics[positionRemap[a]], edgePlane);
+			QuadricAdd(quadrics[positionRemap[b]], edgePlane);
+		}
+	}
+
+	std::vector<EdgeCollapse> collapses;
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> collapseRemap(vertexCount);
+	std::vector<bool> collapseLocked(vertexCount);
+	VertexAdjacency triangles;
+	double resultError = 0.0;
+
+	while (simplified.size() > targetIndexCount)
+	{
+		// Every edge that may collapse, in its cheaper allowed direction
+		collapses.clear();
+		for (size_t t = 0; t < simplified.size() / 3; t++)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int i0 = simplified[t * 3 + e];
+				unsigned int i1 = simplified[t * 3 + (e + 1) % 3];
+				int k0 = kind[i0];
+				int k1 = kind[i1];
+
+				if (!canCollapse[k0][k1] && !canCollapse[k1][k0])
+					continue;
+
+				// Edges walked both ways are only needed once
+				if (hasOpposite[k0][k1] && positionRemap[i1] > positionRemap[i0])
+					continue;
+
+				// Two border (or seam) vertices that aren't joined by that border
+				if (k0 == k1 && (k0 == KindBorder || k0 == KindSeam) && openOut[i0] != i1)
+					continue;
+
+				EdgeCollapse collapse;
+				double error01 = canCollapse[k0][k1] ? QuadricError(quadrics[positionRemap[i0]], verts[i1].position) : DBL_MAX;
+				double error10 = canCollapse[k1][k0] ? QuadricError(quadrics[positionRemap[i1]], verts[i0].position) : DBL_MAX;
+				if (error01 <= error10)
+				{
+					collapse.from = i0;
+					collapse.to = i1;
+					collapse.error = error01;
+				}
+				else
+				{
+					collapse.from = i1;
+					collapse.to = i0;
+					collapse.error = error10;
+				}
+				collapses.push_back(collapse);
+			}
+		}
+
+		if (collapses.size() == 0)
+			break;
+
+		order.resize(collapses.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = (unsigned int)i;
+		std::sort(order.begin(), order.end(),
+			[&](unsigned int a, unsigned int b) { return collapses[a].error < collapses[b].error; });
+
+		// Most collapses remove two triangles; stop a pass a bit past the error of the
+		// collapse that would reach the target, so cheap edges are always taken first
+		size_t triangleGoal = (simplified.size() - targetIndexCount) / 3;
+		size_t edgeGoal = triangleGoal / 2 < order.size() ? triangleGoal / 2 : order.size() - 1;
+		double errorLimit = collapses[order[edgeGoal]].error * 1.5;
+		if (errorLimit > (double)maxError * maxError)
+			errorLimit = (double)maxError * maxError;
+
+		BuildTriangleAdjacency(simplified, positionRemap, triangles);
+		for (size_t v = 0; v < vertexCount; v++)
+			collapseRemap[v] = (unsigned int)v;
+		collapseLocked.assign(vertexCount, false);
+
+		size_t trianglesCollapsed = 0;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			const EdgeCollapse& collapse = collapses[order[i]];
+			unsigned int fromPosition = positionRemap[collapse.from];
+			unsigned int toPosition = positionRemap[collapse.to];
+
+			if (collapseLocked[fromPosition] || collapseLocked[toPosition])
+				continue;
+
+			if (collapse.error > errorLimit)
+				break;
+
+			if (CollapseFlipsTriangles(verts, simplified, triangles, positionRemap, collapseRemap, collapse.from, collapse.to))
+				continue;
+
+			// The other side of a seam moves onto the matching vertex on its own side
+			if (kind[collapse.from] == KindSeam)
+			{
+				unsigned int fromWedge = wedge[collapse.from];
+				unsigned int toWedge = openOut[collapse.from] == collapse.to ? openIn[fromWedge] : openOut[fromWedge];
+				collapseRemap[fromWedge] = toWedge;
+			}
+			collapseRemap[collapse.from] = collapse.to;
+
+			collapseLocked[fromPosition] = true;
+			collapseLocked[toPosition] = true;
+			QuadricAdd(quadrics[toPosition], quadrics[fromPosition]);
+			resultError = collapse.error > resultError ? collapse.error : resultError;
+
+			trianglesCollapsed += kind[collapse.from] == KindBorder ? 1 : 2;
+			if (trianglesCollapsed >= triangleGoal)
+				break;
+		}
+
+		if (trianglesCollapsed == 0)
+			break;
+
+		// Rewrite the triangles, dropping the ones that collapsed
+		size_t written = 0;
+		for (size_t t = 0; t < simplified.size() / 3; t++)
+		{
+			unsigned int a = collapseRemap[simplified[t * 3 + 0]];
+			unsigned int b = collapseRemap[simplified[t * 3 + 1]];
+			unsigned int c = collapseRemap[simplified[t * 3 + 2]];
+			if (positionRemap[a] == positionRemap[b] || positionRemap[b] == positionRemap[c] || positionRemap[c] == positionRemap[a])
+				continue;
+
+			simplified[written++] = a;
+			simplified[written++] = b;
+			simplified[written++] = c;
+		}
+		simplified.resize(written);
+	}
+
+	return (float)sqrt(resultError);
+}
+
+// --------------------------------------------------------
+// Appends simplified versions of a mesh to its index list,
+// so every level of detail shares the same vertex buffer
+//
+// - Levels are always simplified from the full mesh, so
+//   each one's error is measured against the real surface
+// - Stops early when a level would barely be smaller than
+//   the one before, either because the rest is held by
+//   borders and seams or because simplifying further would
+//   go over lodMaxError
+// - Each level gets its own vertex cache order
+// --------------------------------------------------------
+void MeshOptimizer::GenerateLods(const std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<LodLevel>& lods)
+{
+	lods.clear();
+	LodLevel full = { 0, (unsigned int)indices.size(), 0.0f, 0, 0 };
+	lods.push_back(full);
+	if (verts.size() == 0)
+		return;
+
+	// Size of the mesh: half the diagonal of its bounding box
+	XMVECTOR boundsMin = XMLoadFloat3(&verts[0].position);
+	XMVECTOR boundsMax = boundsMin;
+	for (int i = 1; i < verts.size(); i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&verts[i].position);
+		boundsMin = XMVectorMin(boundsMin, position);
+		boundsMax = XMVectorMax(boundsMax, position);
+	}
+	float maxError = XMVectorGetX(XMVector3Length(boundsMax - boundsMin)) * 0.5f * lodMaxError;
+
+	std::vector<unsigned int> fullIndices(indices);
+	std::vector<unsigned int> simplified;
+	for (int level = 1; level < maxLodCount; level++)
+	{
+		size_t target = (size_t)(lods.back().indexCount / 3 * lodReduction) * 3;
+		if (target < minLodTriangles * 3)
+			break;
+
+		float error = SimplifyMesh(verts, fullIndices, target, maxError, simplified);
+		if (simplified.size() > lods.back().indexCount * (1.0f + lodReduction) / 2.0f)
+			break;
+
+		OptimizeVertexCache(simplified, (int)verts.size());
+
+		LodLevel lod = { (unsigned int)indices.size(), (unsigned int)simplified.size(), error, 0, 0 };
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		lods.push_back(lod);
+	}
+}
+
+// ------------------------------------------------------------------
+// Meshlets
+// ------------------------------------------------------------------
+namespace
+{
+	// Cones whose normals are spread wider than this (cosine from the axis) can
+	// almost never be culled, so they aren't worth testing
+	const float minConeSpread = 0.1f;
+
+	MeshOptimizer::Meshlet MakeMeshlet(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, unsigned int indexStart, unsigned int indexCount)
+	{
+		MeshOptimizer::Meshlet meshlet = {};
+		meshlet.indexStart = indexStart;
+		meshlet.indexCount = indexCount;
+
+		// Bounding sphere around the box of the meshlet's corners
+		XMVECTOR boundsMin = XMLoadFloat3(&verts[indices[indexStart]].position);
+		XMVECTOR boundsMax = boundsMin;
+		for (unsigned int i = indexStart + 1; i < indexStart + indexCount; i++)
+		{
+			XMVECTOR position = XMLoadFloat3(&verts[indices[i]].position);
+			boundsMin = XMVectorMin(boundsMin, position);
+			boundsMax = XMVectorMax(boundsMax, position);
+		}
+
+		XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+		XMVECTOR radiusSq = XMVectorZero();
+		for (unsigned int i = indexStart; i < indexStart + indexCount; i++)
+			radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(XMLoadFloat3(&verts[indices[i]].position) - center));
+
+		XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = sqrtf(XMVectorGetX(radiusSq));
+
+		// Normal cone: the average triangle normal, widened to reach the furthest one
+		std::vector<XMVECTOR> normals;
+		normals.reserve(indexCount / 3);
+		XMVECTOR normalSum = XMVectorZero();
+		for (unsigned int i = indexStart; i + 2 < indexStart + indexCount; i += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&verts[indices[i + 0]].position);
+			XMVECTOR p1 = XMLoadFloat3(&verts[indices[i + 1]].position);
+			XMVECTOR p2 = XMLoadFloat3(&verts[indices[i + 2]].position);
+			XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+			if (XMVectorGetX(XMVector3LengthSq(normal)) == 0.0f)
+				continue;
+
+			normal = XMVector3Normalize(normal);
+			normals.push_back(normal);
+			normalSum = normalSum + normal;
+		}
+
+		meshlet.coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		meshlet.coneCutoff = 1.0f;
+		if (normals.size() == 0 || XMVectorGetX(XMVector3LengthSq(normalSum)) == 0.0f)
+			return meshlet;
+
+		XMVECTOR axis = XMVector3Normalize(normalSum);
+		float minDot = 1.0f;
+		for (int i = 0; i < normals.size(); i++)
+		{
+			float dot = XMVectorGetX(XMVector3Dot(axis, normals[i]));
+			minDot = dot < minDot ? dot : minDot;
+		}
+
+		if (minDot <= minConeSpread)
+			return meshlet;
+
+		// Back facing for every normal in the cone means the view direction is within
+		// 90 degrees minus the cone's half angle of the axis, i.e. cos(90 - angle) = sin(angle)
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+		return meshlet;
+	}
+}
+
+// --------------------------------------------------------
+// Splits one level's index range into meshlets of at most
+// maxMeshletVertices vertices and maxMeshletTriangles
+// triangles, and records them in the level
+//
+// - Triangles keep their order, which is already optimized
+//   for the vertex cache and overdraw, so a meshlet ends
+//   when the next triangle doesn't fit. Cache-ordered
+//   triangles come in compact patches, which keeps each
+//   meshlet's bounds and normal cone tight
+// - Each meshlet gets a bounding sphere and normal cone for
+//   culling on the CPU (see MeshletCulling)
+// --------------------------------------------------------
+void MeshOptimizer::BuildMeshlets(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, LodLevel& lod, std::vector<Meshlet>& meshlets)
+{
+	lod.meshletStart = (unsigned int)meshlets.size();
+	lod.meshletCount = 0;
+	if (lod.indexCount == 0 || verts.size() == 0)
+		return;
+
+	// The meshlet that last used each vertex, so counting unique vertices needs no clearing
+	std::vector<unsigned int> usedBy(verts.size(), emptySlot);
+	unsigned int meshletId = 0;
+	unsigned int meshletStart = lod.indexStart;
+	int meshletVertices = 0;
+
+	unsigned int indexEnd = lod.indexStart + lod.indexCount;
+	for (unsigned int i = lod.indexStart; i + 2 < indexEnd; i += 3)
+	{
+		int newVertices = 0;
+		for (int c = 0; c < 3; c++)
+			newVertices += usedBy[indices[i + c]] != meshletId ? 1 : 0;
+
+		if (meshletVertices + newVertices > maxMeshletVertices || (i - meshletStart) / 3 >= maxMeshletTriangles)
+		{
+			meshlets.push_back(MakeMeshlet(verts, indices, meshletStart, i - meshletStart));
+			meshletId++;
+			meshletStart = i;
+			meshletVertices = 0;
+			newVertices = 3;
+		}
+
+		for (int c = 0; c < 3; c++)
+			usedBy[indices[i + c]] = meshletId;
+		meshletVertices += newVertices;
+	}
+
+	if (meshletStart < indexEnd)
+		meshlets.push_back(MakeMeshlet(verts, indices, meshletStart, indexEnd - meshletStart));
+
+	lod.meshletCount = (unsigned int)meshlets.size() - lod.meshletStart;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// CPU-side passes that clean up and reorder imported mesh
+// data before it is uploaded to the GPU
+//
+// - All passes work on plain vertex/index lists, so they can
+//   run on any loader's output without a Direct3D device
+// --------------------------------------------------------
+namespace MeshOptimizer
+{
+	enum WeldMode
+	{
+		WeldExact,		// Merge vertices whose position, normal and uv are bit-for-bit equal
+		WeldQuantized	// Merge vertices whose attributes fall into the same quantization cell
+	};
+
+	// Cell sizes used by WeldQuantized
+	struct WeldSettings
+	{
+		WeldMode mode;
+		float positionStep;
+		float normalStep;
+		float uvStep;
+	};
+
+	struct WeldStats
+	{
+		int vertexCountBefore;
+		int vertexCountAfter;
+		int triangleCountBefore;
+		int triangleCountAfter;
+		int degenerateTriangles;	// Triangles dropped because two corners shared a position
+	};
+
+	enum CacheModel
+	{
+		CacheFIFO,		// Vertices leave in the order they entered, hits don't refresh them
+		CacheLRU		// Hits move a vertex back to the front
+	};
+
+	// Cache sizes used when reporting post-transform cache efficiency
+	const int fifoCacheSize = 16;
+	const int lruCacheSize = 32;
+
+	// Post-transform vertex cache efficiency of an index order
+	// - ACMR: vertices shaded per triangle (0.5 is ideal for large grids, 3 is the worst)
+	// - ATVR: vertices shaded per unique vertex (1 is ideal)
+	struct VertexCacheStats
+	{
+		float acmr;
+		float atvr;
+	};
+
+	// How much the overdraw pass may hurt the vertex cache: clusters end once
+	// their ACMR is within this factor of the cache-optimized order's ACMR
+	const float overdrawThreshold = 1.05f;
+
+	// Views used when estimating overdraw
+	const int overdrawDirections = 8;
+	const int overdrawResolution = 256;
+
+	// Pixels shaded vs. pixels covered, summed over all estimated views
+	// - Overdraw is 1 when every covered pixel is shaded exactly once
+	struct OverdrawStats
+	{
+		unsigned int pixelsCovered;
+		unsigned int pixelsShaded;
+		float overdraw;
+	};
+
+	// Simulated vertex fetch cache: 16 KB of 64 byte lines, replaced in FIFO order
+	const int fetchCacheLineSize = 64;
+	const int fetchCacheLines = 256;
+
+	// How well vertex buffer reads stay in the fetch cache
+	// - Overfetch: bytes read from memory per byte of vertex data (1 is ideal)
+	struct VertexFetchStats
+	{
+		float hitRate;
+		float overfetch;
+	};
+
+	// Levels of detail made at import: LOD 0 is the full mesh and each
+	// level after it aims for lodReduction of the previous one's triangles
+	const int maxLodCount = 4;
+	const float lodReduction = 0.5f;
+	const int minLodTriangles = 64;		// Meshes (or levels) smaller than this aren't simplified further
+	const float lodMaxError = 0.02f;	// Largest error any level may have, relative to the mesh's size
+
+	// One level of detail, as a range of the mesh's index list
+	// - Error is how far the simplified surface strays from the full mesh, in mesh units
+	// - Its triangles are split into meshlets[meshletStart .. meshletStart + meshletCount]
+	struct LodLevel
+	{
+		unsigned int indexStart;
+		unsigned int indexCount;
+		float error;
+		unsigned int meshletStart;
+		unsigned int meshletCount;
+	};
+
+	// Largest meshlet, the same limits mesh shader hardware is tuned for
+	const int maxMeshletVertices = 64;
+	const int maxMeshletTriangles = 124;
+
+	// A small cluster of neighbouring triangles, as a range of the mesh's index list
+	// - Every triangle normal is within the cone around coneAxis, whose
+	//   coneCutoff is the sine of its half angle (1 if it is too wide to cull with)
+	struct Meshlet
+	{
+		unsigned int indexStart;
+		unsigned int indexCount;
+		DirectX::XMFLOAT3 center;
+		float radius;
+		DirectX::XMFLOAT3 coneAxis;
+		float coneCutoff;
+	};
+
+	// The triangles of one material, as a range of the mesh's index list
+	// - materialId is the file's material index, -1 when faces have none
+	struct Submesh
+	{
+		unsigned int indexStart;
+		unsigned int indexCount;
+		int materialId;
+	};
+
+	// Everything measured while a mesh was imported, shown in the UI for tuning
+	struct ImportStats
+	{
+		WeldStats weld;
+		VertexCacheStats fifoBefore;
+		VertexCacheStats fifoAfter;
+		VertexCacheStats lruBefore;
+		VertexCacheStats lruAfter;
+		OverdrawStats overdrawBefore;
+		OverdrawStats overdrawAfter;
+		VertexFetchStats fetchBefore;
+		VertexFetchStats fetchAfter;
+	};
+
+	WeldSettings DefaultWeldSettings(WeldMode mode = WeldExact);
+
+	WeldStats WeldVertices(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, WeldSettings settings);
+
+	void OptimizeVertexCache(std::vector<unsigned int>& indices, int vertexCount);
+	VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, int vertexCount, int cacheSize, CacheModel model);
+
+	void OptimizeOverdraw(const std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float threshold);
+	OverdrawStats EstimateOverdraw(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, int directionCount, int resolution);
+
+	void OptimizeVertexFetch(std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+	VertexFetchStats AnalyzeVertexFetch(const std::vector<unsigned int>& indices, int vertexCount, int vertexSize);
+
+	float SimplifyMesh(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError,
+		std::vector<unsigned int>& simplified);
+	void GenerateLods(const std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<LodLevel>& lods);
+
+	void BuildMeshlets(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, LodLevel& lod, std::vector<Meshlet>& meshlets);
+}
@@ -0,0 +1,108 @@
+#include <cmath>
+#include "MeshletCulling.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Moves a view into a mesh's space
+// - With row vectors, clip = position * worldViewProj, so
+//   each frustum plane is a sum of its columns
+// - Only orthographic projections have _34 == 0 (no divide
+//   by view depth)
+// --------------------------------------------------------
+MeshletCulling::View MeshletCulling::MakeView(const XMFLOAT4X4& world, const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+{
+	View result = {};
+
+	XMMATRIX worldView = XMMatrixMultiply(XMLoadFloat4x4(&world), XMLoadFloat4x4(&view));
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(worldView, XMLoadFloat4x4(&proj)));
+
+	XMVECTOR column0 = XMVectorSet(m._11, m._21, m._31, m._41);
+	XMVECTOR column1 = XMVectorSet(m._12, m._22, m._32, m._42);
+	XMVECTOR column2 = XMVectorSet(m._13, m._23, m._33, m._43);
+	XMVECTOR column3 = XMVectorSet(m._14, m._24, m._34, m._44);
+
+	XMVECTOR planes[6] =
+	{
+		column3 + column0,	// Left
+		column3 - column0,	// Right
+		column3 + column1,	// Bottom
+		column3 - column1,	// Top
+		column2,			// Near (depth goes from 0 to w)
+		column3 - column2	// Far
+	};
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&result.planes[i], XMPlaneNormalize(planes[i]));
+
+	// The view's origin and forward axis, taken back to mesh space
+	XMFLOAT4X4 inverse;
+	XMStoreFloat4x4(&inverse, XMMatrixInverse(nullptr, worldView));
+	result.eye = XMFLOAT3(inverse._41, inverse._42, inverse._43);
+	XMVECTOR forward = XMVector3Normalize(XMVectorSet(inverse._31, inverse._32, inverse._33, 0.0f));
+	XMStoreFloat3(&result.forward, forward);
+	result.orthographic = proj._34 == 0.0f;
+	return result;
+}
+
+void MeshletCulling::Cull(const MeshOptimizer::Meshlet* meshlets, int meshletCount, const View& view, Stats& stats, std::vector<DrawRange>& visible)
+{
+	visible.clear();
+	stats.tested += meshletCount;
+
+	for (int i = 0; i < meshletCount; i++)
+	{
+		const MeshOptimizer::Meshlet& meshlet = meshlets[i];
+		const XMFLOAT3& c = meshlet.center;
+
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++)
+		{
+			const XMFLOAT4& plane = view.planes[p];
+			outside = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w < -meshlet.radius;
+		}
+		if (outside)
+		{
+			stats.frustumCulled++;
+			continue;
+		}
+
+		// Every triangle faces away when the direction to the meshlet is inside the
+		// cone's "back facing" region, with the sphere's radius as a safety margin
+		const XMFLOAT3& axis = meshlet.coneAxis;
+		bool backFacing;
+		if (view.orthographic)
+		{
+			backFacing = view.forward.x * axis.x + view.forward.y * axis.y + view.forward.z * axis.z >= meshlet.coneCutoff;
+		}
+		else
+		{
+			float dx = c.x - view.eye.x;
+			float dy = c.y - view.eye.y;
+			float dz = c.z - view.eye.z;
+			float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+			backFacing = dx * axis.x + dy * axis.y + dz * axis.z >= meshlet.coneCutoff * distance + meshlet.radius;
+		}
+		if (backFacing)
+		{
+			stats.coneCulled++;
+			continue;
+		}
+
+		// Extend the last range when this meshlet follows it directly
+		if (visible.size() > 0 && visible.back().indexStart + visible.back().indexCount == meshlet.indexStart)
+		{
+			visible.back().indexCount += meshlet.indexCount;
+		}
+		else
+		{
+			DrawRange range = { meshlet.indexStart, meshlet.indexCount };
+			visible.push_back(range);
+		}
+	}
+}
+
+float MeshletCulling::CulledRatio(const Stats& stats)
+{
+	return stats.tested > 0 ? (float)(stats.frustumCulled + stats.coneCulled) / stats.tested : 0.0f;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include "MeshOptimizer.h"
+
+// --------------------------------------------------------
+// CPU culling of a mesh's meshlets for one view (the camera
+// or a shadow map)
+//
+// - Works in the mesh's own space: the frustum planes come
+//   straight from world * view * proj and the eye is moved
+//   into mesh space, so meshlet bounds are never transformed
+// - A meshlet is culled when its bounding sphere is outside
+//   the frustum, or when its normal cone shows that every one
+//   of its triangles faces away from the eye (the rasterizer
+//   would cull them as back faces anyway)
+// - Visible meshlets that follow each other in the index
+//   list are merged into one range, to keep draw calls few
+// --------------------------------------------------------
+namespace MeshletCulling
+{
+	// Indices drawn by one DrawIndexed call
+	struct DrawRange
+	{
+		unsigned int indexStart;
+		unsigned int indexCount;
+	};
+
+	// Meshlets tested and culled, summed over any number of Cull() calls
+	struct Stats
+	{
+		unsigned int tested;
+		unsigned int frustumCulled;
+		unsigned int coneCulled;
+	};
+
+	// A view, in the space of the mesh being culled
+	struct View
+	{
+		DirectX::XMFLOAT4 planes[6];	// Normalized, pointing into the frustum
+		DirectX::XMFLOAT3 eye;			// Position of a perspective view
+		DirectX::XMFLOAT3 forward;		// Direction of an orthographic view
+		bool orthographic;
+	};
+
+	View MakeView(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+	void Cull(const MeshOptimizer::Meshlet* meshlets, int meshletCount, const View& view, Stats& stats, std::vector<DrawRange>& visible);
+	float CulledRatio(const Stats& stats);
+}
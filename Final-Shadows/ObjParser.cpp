@@ -0,0 +1,1144 @@
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "Helpers.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "TinyObj/tiny_obj_loader.h"
+
+using namespace DirectX;
+
+// ------------------------------------------------------------------
+// Tokenizing helpers for the Mapped backend
+// - Mapped files are not null-terminated, so every helper is given
+//   the end of the current line and never reads past it
+// ------------------------------------------------------------------
+namespace
+{
+	// Every power of ten a double can represent exactly
+	const double exactPowersOfTen[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+	inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+	inline const char* SkipBlanks(const char* p, const char* end)
+	{
+		while (p < end && IsBlank(*p))
+			p++;
+		return p;
+	}
+
+	inline const char* FindLineEnd(const char* p, const char* end)
+	{
+		const char* newline = (const char*)memchr(p, '\n', end - p);
+		return newline ? newline : end;
+	}
+
+	inline const char* NextLine(const char* lineEnd, const char* end)
+	{
+		return lineEnd < end ? lineEnd + 1 : end;
+	}
+
+	// Copies the token into a terminated string so strtof can read it
+	// - Only used for the rare values the fast path can't round exactly
+	const char* ParseFloatFallback(const char* start, const char* end, float& out)
+	{
+		const char* tokenEnd = start;
+		while (tokenEnd < end && !IsBlank(*tokenEnd))
+			tokenEnd++;
+
+		std::string token(start, tokenEnd);
+		char* parsedEnd = 0;
+		out = strtof(token.c_str(), &parsedEnd);
+		if (parsedEnd == token.c_str())
+			return 0;
+
+		return start + (parsedEnd - token.c_str());
+	}
+
+	// Parses a float exactly like sscanf_s("%f") would, returning the
+	// position after it or null if there was no number
+	// - The digits are gathered into an integer and scaled by an exact power
+	//   of ten, which is a correctly rounded double (Clinger's fast path)
+	// - Narrowing that double to a float can only round differently from a
+	//   direct conversion if it sits exactly halfway between two floats,
+	//   so those values (and anything unusual) go through strtof instead
+	const char* ParseFloat(const char* p, const char* end, float& out)
+	{
+		const char* start = p;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+		bool exact = true;
+
+		// Integer part, leading zeros don't count towards the 19 digit limit
+		for (; p < end && IsDigit(*p); p++)
+		{
+			int d = *p - '0';
+			anyDigits = true;
+			if (digits < 19)
+			{
+				if (mantissa != 0 || d != 0)
+				{
+					mantissa = mantissa * 10 + d;
+					digits++;
+				}
+			}
+			else
+			{
+				exponent++;
+				exact = exact && d == 0;
+			}
+		}
+
+		// Fractional part
+		if (p < end && *p == '.')
+		{
+			p++;
+			for (; p < end && IsDigit(*p); p++)
+			{
+				int d = *p - '0';
+				anyDigits = true;
+				if (digits < 19)
+				{
+					if (mantissa != 0 || d != 0)
+					{
+						mantissa = mantissa * 10 + d;
+						digits++;
+					}
+					exponent--;
+				}
+				else
+				{
+					exact = exact && d == 0;
+				}
+			}
+		}
+
+		// Things like "inf" and "nan"
+		if (!anyDigits)
+			return ParseFloatFallback(start, end, out);
+
+		// Exponent, only consumed if it actually has digits
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* e = p + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+'))
+			{
+				negativeExponent = *e == '-';
+				e++;
+			}
+
+			if (e < end && IsDigit(*e))
+			{
+				int exponentValue = 0;
+				for (; e < end && IsDigit(*e); e++)
+				{
+					if (exponentValue < 10000)
+						exponentValue = exponentValue * 10 + (*e - '0');
+				}
+				exponent += negativeExponent ? -exponentValue : exponentValue;
+				p = e;
+			}
+		}
+
+		if (mantissa == 0)
+		{
+			out = negative ? -0.0f : 0.0f;
+			return p;
+		}
+
+		if (!exact || mantissa > (1ull << 53) || exponent < -22 || exponent > 22)
+			return ParseFloatFallback(start, end, out);
+
+		double value = (double)mantissa;
+		value = exponent < 0 ? value / exactPowersOfTen[-exponent] : value * exactPowersOfTen[exponent];
+
+		// The 29 low bits are what a float drops, 0x10000000 is exactly half of them
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		if ((bits & 0x1FFFFFFF) == 0x10000000 || value < FLT_MIN || value > FLT_MAX)
+			return ParseFloatFallback(start, end, out);
+
+		out = negative ? -(float)value : (float)value;
+		return p;
+	}
+
+	// Parses an integer like sscanf_s("%d"), returning null if there was no number
+	const char* ParseInt(const char* p, const char* end, int& out)
+	{
+		p = SkipBlanks(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		if (p >= end || !IsDigit(*p))
+			return 0;
+
+		unsigned int value = 0;
+		for (; p < end && IsDigit(*p); p++)
+			value = value * 10 + (*p - '0');
+
+		out = negative ? -(int)value : (int)value;
+		return p;
+	}
+
+	// Reads up to count floats into out, missing values are left untouched
+	void ParseFloats(const char* p, const char* end, float* out, int count)
+	{
+		for (int n = 0; n < count && p != 0; n++)
+			p = ParseFloat(SkipBlanks(p, end), end, out[n]);
+	}
+
+	// Same result as sscanf_s(line, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d", ...)
+	int ReadFace(const char* p, const char* end, unsigned int i[12])
+	{
+		int numbersRead = 0;
+		for (int corner = 0; corner < 4; corner++)
+		{
+			for (int n = 0; n < 3; n++)
+			{
+				if (n > 0)
+				{
+					if (p >= end || *p != '/')
+						return numbersRead;
+					p++;
+				}
+
+				int value;
+				p = ParseInt(p, end, value);
+				if (p == 0)
+					return numbersRead;
+
+				i[corner * 3 + n] = (unsigned int)value;
+				numbersRead++;
+			}
+		}
+		return numbersRead;
+	}
+
+	// Same result as sscanf_s(line, "f %d//%d %d//%d %d//%d %d//%d", ...)
+	// - Fills the position and normal slots of i, leaving the uv slots alone
+	int ReadFaceWithoutUVs(const char* p, const char* end, unsigned int i[12])
+	{
+		int numbersRead = 0;
+		for (int corner = 0; corner < 4; corner++)
+		{
+			int value;
+			p = ParseInt(p, end, value);
+			if (p == 0)
+				return numbersRead;
+
+			i[corner * 3] = (unsigned int)value;
+			numbersRead++;
+
+			if (end - p < 2 || p[0] != '/' || p[1] != '/')
+				return numbersRead;
+			p += 2;
+
+			p = ParseInt(p, end, value);
+			if (p == 0)
+				return numbersRead;
+
+			i[corner * 3 + 2] = (unsigned int)value;
+			numbersRead++;
+		}
+		return numbersRead;
+	}
+
+	// Looks up one face corner (position/uv/normal, 1-based) and converts
+	// it to a left-handed vertex exactly like the Stream loader does
+	bool MakeVertex(
+		const std::vector<XMFLOAT3>& positions,
+		const std::vector<XMFLOAT2>& uvs,
+		const std::vector<XMFLOAT3>& normals,
+		const unsigned int* corner,
+		Vertex& v)
+	{
+		if (corner[0] - 1 >= positions.size() || corner[1] - 1 >= uvs.size() || corner[2] - 1 >= normals.size())
+			return false;
+
+		v = {};
+		v.position = positions[corner[0] - 1];
+		v.uv = uvs[corner[1] - 1];
+		v.normal = normals[corner[2] - 1];
+
+		v.uv.y = 1.0f - v.uv.y;
+		v.position.z *= -1.0f;
+		v.normal.z *= -1.0f;
+		return true;
+	}
+
+	void AddTriangle(const Vertex& a, const Vertex& b, const Vertex& c,
+		std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		unsigned int first = (unsigned int)verts.size();
+		verts.push_back(a);
+		verts.push_back(b);
+		verts.push_back(c);
+		indices.push_back(first);
+		indices.push_back(first + 1);
+		indices.push_back(first + 2);
+	}
+
+	// Least of the file each worker of the Parallel backend gets
+	const size_t minimumParallelBytes = 256 * 1024;
+
+	// A face that has been read but not yet turned into vertices
+	struct FaceRecord
+	{
+		unsigned int i[12];
+		int numbersRead;
+	};
+
+	// Everything one worker pulls out of its share of the file
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> uvs;
+		std::vector<FaceRecord> faces;
+
+		// The Stream loader adds a default uv the first time it sees a face
+		// without uvs, but only if no "vt" line came before that face
+		bool hasFaceWithoutUVs;
+		size_t uvsBeforeFaceWithoutUVs;
+
+		// Where this chunk's data lands in the merged arrays
+		size_t firstTriangle;
+		size_t triangleCount;
+		bool valid;
+	};
+
+	// Reads attributes and faces of one chunk without resolving any indices,
+	// since faces may refer to data in other chunks
+	void ParseChunk(ObjChunk& chunk)
+	{
+		ObjParser::ObjCounts counts = ObjParser::CountElements(chunk.begin, chunk.end - chunk.begin);
+		chunk.positions.reserve(counts.positions);
+		chunk.normals.reserve(counts.normals);
+		chunk.uvs.reserve(counts.uvs);
+		chunk.faces.reserve(counts.triangles);
+		chunk.hasFaceWithoutUVs = false;
+		chunk.uvsBeforeFaceWithoutUVs = 0;
+		chunk.triangleCount = 0;
+
+		const char* end = chunk.end;
+		for (const char* line = chunk.begin; line < end;)
+		{
+			const char* lineEnd = FindLineEnd(line, end);
+
+			if (lineEnd - line >= 2)
+			{
+				if (line[0] == 'v' && line[1] == 'n')
+				{
+					XMFLOAT3 norm = {};
+					ParseFloats(line + 2, lineEnd, &norm.x, 3);
+					chunk.normals.push_back(norm);
+				}
+				else if (line[0] == 'v' && line[1] == 't')
+				{
+					XMFLOAT2 uv = {};
+					ParseFloats(line + 2, lineEnd, &uv.x, 2);
+					chunk.uvs.push_back(uv);
+				}
+				else if (line[0] == 'v')
+				{
+					XMFLOAT3 pos = {};
+					ParseFloats(line + 1, lineEnd, &pos.x, 3);
+					chunk.positions.push_back(pos);
+				}
+				else if (line[0] == 'f')
+				{
+					FaceRecord face = {};
+					face.numbersRead = ReadFace(line + 1, lineEnd, face.i);
+
+					if (face.numbersRead == 1)
+					{
+						face.numbersRead = ReadFaceWithoutUVs(line + 1, lineEnd, face.i);
+						face.i[1] = 1;
+						face.i[4] = 1;
+						face.i[7] = 1;
+						face.i[10] = 1;
+
+						if (!chunk.hasFaceWithoutUVs)
+						{
+							chunk.hasFaceWithoutUVs = true;
+							chunk.uvsBeforeFaceWithoutUVs = chunk.uvs.size();
+						}
+					}
+
+					if (face.numbersRead == 9 || face.numbersRead == 6)
+					{
+						chunk.faces.push_back(face);
+						chunk.triangleCount += 1;
+					}
+					else if (face.numbersRead == 12 || face.numbersRead == 8)
+					{
+						chunk.faces.push_back(face);
+						chunk.triangleCount += 2;
+					}
+				}
+			}
+
+			line = NextLine(lineEnd, end);
+		}
+	}
+
+	// Turns a chunk's faces into vertices, writing straight into its own
+	// slice of the merged arrays so no two workers touch the same memory
+	void BuildChunkTriangles(
+		ObjChunk& chunk,
+		const std::vector<XMFLOAT3>& positions,
+		const std::vector<XMFLOAT2>& uvs,
+		const std::vector<XMFLOAT3>& normals,
+		Vertex* verts,
+		unsigned int* indices)
+	{
+		chunk.valid = true;
+		size_t next = chunk.firstTriangle * 3;
+
+		for (int f = 0; f < chunk.faces.size(); f++)
+		{
+			const FaceRecord& face = chunk.faces[f];
+
+			Vertex v1, v2, v3;
+			if (!MakeVertex(positions, uvs, normals, &face.i[0], v1) ||
+				!MakeVertex(positions, uvs, normals, &face.i[3], v2) ||
+				!MakeVertex(positions, uvs, normals, &face.i[6], v3))
+			{
+				chunk.valid = false;
+				return;
+			}
+
+			// Flip the winding order for left-handed space
+			verts[next] = v1;
+			verts[next + 1] = v3;
+			verts[next + 2] = v2;
+			indices[next] = (unsigned int)next;
+			indices[next + 1] = (unsigned int)next + 1;
+			indices[next + 2] = (unsigned int)next + 2;
+			next += 3;
+
+			if (face.numbersRead == 12 || face.numbersRead == 8)
+			{
+				Vertex v4;
+				if (!MakeVertex(positions, uvs, normals, &face.i[9], v4))
+				{
+					chunk.valid = false;
+					return;
+				}
+
+				verts[next] = v1;
+				verts[next + 1] = v4;
+				verts[next + 2] = v3;
+				indices[next] = (unsigned int)next;
+				indices[next + 1] = (unsigned int)next + 1;
+				indices[next + 2] = (unsigned int)next + 2;
+				next += 3;
+			}
+		}
+	}
+}
+
+bool ObjParser::Load(const wchar_t* objFile, Backend backend, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	switch (backend)
+	{
+		case Stream:
+			return LoadStream(objFile, verts, indices);
+
+		case Mapped:
+			return LoadMapped(objFile, verts, indices);
+
+		case Parallel:
+			return LoadParallel(objFile, verts, indices);
+
+		default:
+			return false;
+	}
+}
+
+bool ObjParser::LoadStream(const wchar_t* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	// Author: Chris Cascioli
+	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
+	//
+	// - You are allowed to directly copy/paste this into your code base
+	//   for assignments, given that you clearly cite that this is not
+	//   code of your own design.
+	//
+	// - NOTE: You'll need to #include <fstream>
+
+
+	// File input object
+	std::ifstream obj(objFile);
+
+	// Check for successful open
+	if (!obj.is_open())
+		return false;
+
+	// Variables used while reading the file
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;		// UVs from the file
+	int vertCounter = 0;			// Count of vertices
+	int indexCounter = 0;			// Count of indices
+	char chars[100];			// String for line reading
+
+	verts.clear();
+	indices.clear();
+
+	// Still have data left?
+	while (obj.good())
+	{
+		// Get the line (100 characters should be more than enough)
+		obj.getline(chars, 100);
+
+		// Check the type of line
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			// Read the 3 numbers directly into an XMFLOAT3
+			XMFLOAT3 norm;
+			sscanf_s(
+				chars,
+				"vn %f %f %f",
+				&norm.x, &norm.y, &norm.z);
+
+			// Add to the list of normals
+			normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			// Read the 2 numbers directly into an XMFLOAT2
+			XMFLOAT2 uv;
+			sscanf_s(
+				chars,
+				"vt %f %f",
+				&uv.x, &uv.y);
+
+			// Add to the list of uv's
+			uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			// Read the 3 numbers directly into an XMFLOAT3
+			XMFLOAT3 pos;
+			sscanf_s(
+				chars,
+				"v %f %f %f",
+				&pos.x, &pos.y, &pos.z);
+
+			// Add to the positions
+			positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			// Read the face indices into an array
+			// NOTE: This assumes the given obj file contains
+			//  vertex positions, uv coordinates AND normals.
+			unsigned int i[12];
+			int numbersRead = sscanf_s(
+				chars,
+				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2],
+				&i[3], &i[4], &i[5],
+				&i[6], &i[7], &i[8],
+				&i[9], &i[10], &i[11]);
+
+			// If we only got the first number, chances are the OBJ
+			// file has no UV coordinates.  This isn't great, but we
+			// still want to load the model without crashing, so we
+			// need to re-read a different pattern (in which we assume
+			// there are no UVs denoted for any of the vertices)
+			if (numbersRead == 1)
+			{
+				// Re-read with a different pattern
+				numbersRead = sscanf_s(
+					chars,
+					"f %d//%d %d//%d %d//%d %d//%d",
+					&i[0], &i[2],
+					&i[3], &i[5],
+					&i[6], &i[8],
+					&i[9], &i[11]);
+
+				// The following indices are where the UVs should
+				// have been, so give them a valid value
+				i[1] = 1;
+				i[4] = 1;
+				i[7] = 1;
+				i[10] = 1;
+
+				// If we have no UVs, create a single UV coordinate
+				// that will be used for all vertices
+				if (uvs.size() == 0)
+					uvs.push_back(XMFLOAT2(0, 0));
+			}
+
+			// - Create the verts by looking up
+			//    corresponding data from vectors
+			// - OBJ File indices are 1-based, so
+			//    they need to be adusted
+			Vertex v1 = {};
+			v1.position = positions[i[0] - 1];
+			v1.uv = uvs[i[1] - 1];
+			v1.normal = normals[i[2] - 1];
+
+			Vertex v2 = {};
+			v2.position = positions[i[3] - 1];
+			v2.uv = uvs[i[4] - 1];
+			v2.normal = normals[i[5] - 1];
+
+			Vertex v3 = {};
+			v3.position = positions[i[6] - 1];
+			v3.uv = uvs[i[7] - 1];
+			v3.normal = normals[i[8] - 1];
+
+			// The model is most likely in a right-handed space,
+			// especially if it came from Maya.  We want to convert
+			// to a left-handed space for DirectX.  This means we
+			// need to:
+			//  - Invert the Z position
+			//  - Invert the normal's Z
+			//  - Flip the winding order
+			// We also need to flip the UV coordinate since DirectX
+			// defines (0,0) as the top left of the texture, and many
+			// 3D modeling packages use the bottom left as (0,0)
+
+			// Flip the UV's since they're probably "upside down"
+			v1.uv.y = 1.0f - v1.uv.y;
+			v2.uv.y = 1.0f - v2.uv.y;
+			v3.uv.y = 1.0f - v3.uv.y;
+
+			// Flip Z (LH vs. RH)
+			v1.position.z *= -1.0f;
+			v2.position.z *= -1.0f;
+			v3.position.z *= -1.0f;
+
+			// Flip normal's Z
+			v1.normal.z *= -1.0f;
+			v2.normal.z *= -1.0f;
+			v3.normal.z *= -1.0f;
+
+			// Add the verts to the vector (flipping the winding order)
+			verts.push_back(v1);
+			verts.push_back(v3);
+			verts.push_back(v2);
+			vertCounter += 3;
+
+			// Add three more indices
+			indices.push_back(indexCounter); indexCounter += 1;
+			indices.push_back(indexCounter); indexCounter += 1;
+			indices.push_back(indexCounter); indexCounter += 1;
+
+			// Was there a 4th face?
+			// - 12 numbers read means 4 faces WITH uv's
+			// - 8 numbers read means 4 faces WITHOUT uv's
+			if (numbersRead == 12 || numbersRead == 8)
+			{
+				// Make the last vertex
+				Vertex v4 = {};
+				v4.position = positions[i[9] - 1];
+				v4.uv = uvs[i[10] - 1];
+				v4.normal = normals[i[11] - 1];
+
+				// Flip the UV, Z pos and normal's Z
+				v4.uv.y = 1.0f - v4.uv.y;
+				v4.position.z *= -1.0f;
+				v4.normal.z *= -1.0f;
+
+				// Add a whole triangle (flipping the winding order)
+				verts.push_back(v1);
+				verts.push_back(v4);
+				verts.push_back(v3);
+				vertCounter += 3;
+
+				// Add three more indices
+				indices.push_back(indexCounter); indexCounter += 1;
+				indices.push_back(indexCounter); indexCounter += 1;
+				indices.push_back(indexCounter); indexCounter += 1;
+			}
+		}
+	}
+
+	// Close the file
+	obj.close();
+	return true;
+}
+
+bool ObjParser::LoadMapped(const wchar_t* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	MappedFile file(objFile);
+	if (!file.IsOpen())
+		return false;
+
+	return ParseBuffer(file.GetData(), file.GetSize(), verts, indices);
+}
+
+bool ObjParser::LoadParallel(const wchar_t* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	MappedFile file(objFile);
+	if (!file.IsOpen())
+		return false;
+
+	return ParseBufferParallel(file.GetData(), file.GetSize(), verts, indices);
+}
+
+// --------------------------------------------------------
+// Quick pass over the file that only looks at the start of
+// each line, so ParseBuffer can allocate everything once
+// --------------------------------------------------------
+ObjParser::ObjCounts ObjParser::CountElements(const char* data, size_t size)
+{
+	ObjCounts counts = {};
+	const char* end = data + size;
+
+	for (const char* line = data; line < end;)
+	{
+		const char* lineEnd = FindLineEnd(line, end);
+
+		if (lineEnd - line >= 2)
+		{
+			if (line[0] == 'v' && line[1] == 'n')
+				counts.normals++;
+			else if (line[0] == 'v' && line[1] == 't')
+				counts.uvs++;
+			else if (line[0] == 'v')
+				counts.positions++;
+			else if (line[0] == 'f')
+			{
+				// Faces become one triangle, or two if they have a 4th corner
+				// (any corners past the 4th are ignored, same as the Stream loader)
+				int corners = 0;
+				const char* p = SkipBlanks(line + 1, lineEnd);
+				while (p < lineEnd && corners < 4)
+				{
+					corners++;
+					while (p < lineEnd && !IsBlank(*p))
+						p++;
+					p = SkipBlanks(p, lineEnd);
+				}
+
+				if (corners == 3)
+					counts.triangles += 1;
+				else if (corners == 4)
+					counts.triangles += 2;
+			}
+		}
+
+		line = NextLine(lineEnd, end);
+	}
+
+	return counts;
+}
+
+// --------------------------------------------------------
+// Parses an entire OBJ file that is already in memory
+//
+// - Handles the same subset of OBJ as the Stream loader:
+//   v, vt, vn and f lines with 3 or 4 "v/vt/vn" or "v//vn"
+//   corners, everything else is skipped
+// - Returns false if a face refers to data that doesn't exist
+// --------------------------------------------------------
+bool ObjParser::ParseBuffer(const char* data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	ObjCounts counts = CountElements(data, size);
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> uvs;
+	positions.reserve(counts.positions);
+	normals.reserve(counts.normals);
+	uvs.reserve(counts.uvs + 1);	// Room for the default uv of files without any
+
+	verts.clear();
+	indices.clear();
+	verts.reserve(counts.triangles * 3);
+	indices.reserve(counts.triangles * 3);
+
+	const char* end = data + size;
+	for (const char* line = data; line < end;)
+	{
+		const char* lineEnd = FindLineEnd(line, end);
+
+		if (lineEnd - line >= 2)
+		{
+			if (line[0] == 'v' && line[1] == 'n')
+			{
+				XMFLOAT3 norm = {};
+				ParseFloats(line + 2, lineEnd, &norm.x, 3);
+				normals.push_back(norm);
+			}
+			else if (line[0] == 'v' && line[1] == 't')
+			{
+				XMFLOAT2 uv = {};
+				ParseFloats(line + 2, lineEnd, &uv.x, 2);
+				uvs.push_back(uv);
+			}
+			else if (line[0] == 'v')
+			{
+				XMFLOAT3 pos = {};
+				ParseFloats(line + 1, lineEnd, &pos.x, 3);
+				positions.push_back(pos);
+			}
+			else if (line[0] == 'f')
+			{
+				unsigned int i[12] = {};
+				int numbersRead = ReadFace(line + 1, lineEnd, i);
+
+				// No uvs, re-read as "v//vn" and point every corner at a default uv
+				if (numbersRead == 1)
+				{
+					numbersRead = ReadFaceWithoutUVs(line + 1, lineEnd, i);
+					i[1] = 1;
+					i[4] = 1;
+					i[7] = 1;
+					i[10] = 1;
+
+					if (uvs.size() == 0)
+						uvs.push_back(XMFLOAT2(0, 0));
+				}
+
+				// 9/12 numbers is a triangle/quad with uvs, 6/8 without
+				if (numbersRead == 9 || numbersRead == 12 || numbersRead == 6 || numbersRead == 8)
+				{
+					Vertex v1, v2, v3;
+					if (!MakeVertex(positions, uvs, normals, &i[0], v1) ||
+						!MakeVertex(positions, uvs, normals, &i[3], v2) ||
+						!MakeVertex(positions, uvs, normals, &i[6], v3))
+						return false;
+
+					// Flip the winding order for left-handed space
+					AddTriangle(v1, v3, v2, verts, indices);
+
+					if (numbersRead == 12 || numbersRead == 8)
+					{
+						Vertex v4;
+						if (!MakeVertex(positions, uvs, normals, &i[9], v4))
+							return false;
+
+						AddTriangle(v1, v4, v3, verts, indices);
+					}
+				}
+			}
+		}
+
+		line = NextLine(lineEnd, end);
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Parses an entire OBJ file that is already in memory,
+// spreading the work across threadCount workers
+// (0 means one per hardware thread)
+//
+// - The file is cut into line-aligned chunks which are
+//   parsed independently, keeping faces as raw indices
+// - A serial merge then appends each chunk's attributes in
+//   file order, which makes OBJ's global 1-based indices
+//   valid again, and hands every chunk the offset of its
+//   first triangle (a prefix sum of triangle counts)
+// - Finally each chunk builds its vertices in parallel
+// - The result is identical to ParseBuffer, bit for bit
+//   (MeshBenchmark -verify checks this on every model)
+// --------------------------------------------------------
+bool ObjParser::ParseBufferParallel(const char* data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+	unsigned int threadCount)
+{
+	// Keep every chunk big enough to be worth a thread
+	threadCount = ResolveThreadCount(threadCount, size, minimumParallelBytes);
+	if (threadCount == 1)
+		return ParseBuffer(data, size, verts, indices);
+
+	// Split into roughly equal chunks, moving each cut forward to the next line start
+	std::vector<ObjChunk> chunks(threadCount);
+	const char* end = data + size;
+	const char* chunkBegin = data;
+	for (unsigned int c = 0; c < threadCount; c++)
+	{
+		const char* chunkEnd = end;
+		if (c + 1 < threadCount)
+		{
+			chunkEnd = data + size / threadCount * (c + 1);
+			if (chunkEnd < chunkBegin)
+				chunkEnd = chunkBegin;
+			chunkEnd = NextLine(FindLineEnd(chunkEnd, end), end);
+		}
+
+		chunks[c].begin = chunkBegin;
+		chunks[c].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	RunOnThreads(threadCount, [&chunks](unsigned int c) { ParseChunk(chunks[c]); });
+
+	// Merge: prefix sums over every chunk's counts
+	size_t positionCount = 0;
+	size_t normalCount = 0;
+	size_t uvCount = 0;
+	size_t triangleCount = 0;
+	bool addDefaultUV = false;
+	bool defaultUVDecided = false;
+	for (int c = 0; c < chunks.size(); c++)
+	{
+		// Only the first face without uvs in the whole file matters
+		if (!defaultUVDecided && chunks[c].hasFaceWithoutUVs)
+		{
+			addDefaultUV = uvCount + chunks[c].uvsBeforeFaceWithoutUVs == 0;
+			defaultUVDecided = true;
+		}
+
+		chunks[c].firstTriangle = triangleCount;
+		positionCount += chunks[c].positions.size();
+		normalCount += chunks[c].normals.size();
+		uvCount += chunks[c].uvs.size();
+		triangleCount += chunks[c].triangleCount;
+	}
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> uvs;
+	positions.reserve(positionCount);
+	normals.reserve(normalCount);
+	uvs.reserve(uvCount + 1);
+
+	// With no "vt" lines before it, the default uv becomes uv index 1
+	if (addDefaultUV)
+		uvs.push_back(XMFLOAT2(0, 0));
+
+	for (int c = 0; c < chunks.size(); c++)
+	{
+		positions.insert(positions.end(), chunks[c].positions.begin(), chunks[c].positions.end());
+		normals.insert(normals.end(), chunks[c].normals.begin(), chunks[c].normals.end());
+		uvs.insert(uvs.end(), chunks[c].uvs.begin(), chunks[c].uvs.end());
+	}
+
+	verts.clear();
+	indices.clear();
+	verts.resize(triangleCount * 3);
+	indices.resize(triangleCount * 3);
+	if (triangleCount == 0)
+		return true;
+
+	Vertex* vertData = &verts[0];
+	unsigned int* indexData = &indices[0];
+	RunOnThreads(threadCount, [&](unsigned int c)
+	{
+		BuildChunkTriangles(chunks[c], positions, uvs, normals, vertData, indexData);
+	});
+
+	for (int c = 0; c < chunks.size(); c++)
+	{
+		if (!chunks[c].valid)
+		{
+			verts.clear();
+			indices.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Loads an OBJ file with tinyobjloader, which also reads the
+// file's materials
+// - Faces are grouped by material, with each material's
+//   range of the index list in submeshes
+// - Within a material, corners keep the file's order
+// --------------------------------------------------------
+bool ObjParser::LoadTinyObj(const wchar_t* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+	std::vector<MeshOptimizer::Submesh>& submeshes, std::vector<std::string>& materialNames)
+{
+	tinyobj::ObjReaderConfig reader_config;
+	reader_config.mtl_search_path = "";
+	tinyobj::ObjReader reader;
+
+	if (!reader.ParseFromFile(WideToNarrow(objFile), reader_config))
+		return false;
+
+	auto& attributes = reader.GetAttrib();
+	auto& shapes = reader.GetShapes();
+	auto& materials = reader.GetMaterials();
+	materialNames.clear();
+	for (size_t m = 0; m < materials.size(); m++)
+		materialNames.push_back(materials[m].name);
+
+	// Count every material's face corners first (faces without one are material -1),
+	// so each corner can be written straight to its place, grouped by material
+	std::vector<unsigned int> materialCorners(materials.size() + 1, 0);
+	for (size_t s = 0; s < shapes.size(); s++)
+	{
+		for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+		{
+			int material = f < shapes[s].mesh.material_ids.size() ? shapes[s].mesh.material_ids[f] : -1;
+			material = material < (int)materials.size() ? material : -1;
+			materialCorners[material + 1] += shapes[s].mesh.num_face_vertices[f];
+		}
+	}
+
+	submeshes.clear();
+	std::vector<unsigned int> materialOffset(materialCorners.size());
+	unsigned int cornerCount = 0;
+	for (int m = 0; m < materialCorners.size(); m++)
+	{
+		materialOffset[m] = cornerCount;
+		if (materialCorners[m] > 0)
+		{
+			MeshOptimizer::Submesh submesh = { cornerCount, materialCorners[m], m - 1 };
+			submeshes.push_back(submesh);
+		}
+		cornerCount += materialCorners[m];
+	}
+
+	// Every corner gets its own vertex, like the other loaders
+	verts.assign(cornerCount, Vertex());
+	indices.assign(cornerCount, 0);
+
+	// Loop over shapes
+	for (size_t s = 0; s < shapes.size(); s++)
+	{
+		// Loop over faces(polygon)
+		size_t index_offset = 0;
+		for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+		{
+			size_t fv = size_t(shapes[s].mesh.num_face_vertices[f]);
+
+			// per-face material
+			int material = f < shapes[s].mesh.material_ids.size() ? shapes[s].mesh.material_ids[f] : -1;
+			material = material < (int)materials.size() ? material : -1;
+			unsigned int& corner = materialOffset[material + 1];
+
+			// Loop over vertices in the face.
+			for (size_t v = 0; v < fv; v++)
+			{
+				Vertex vertex = {};
+
+				// access to vertex
+				tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
+				tinyobj::real_t vx = attributes.vertices[3 * size_t(idx.vertex_index) + 0];
+				tinyobj::real_t vy = attributes.vertices[3 * size_t(idx.vertex_index) + 1];
+				tinyobj::real_t vz = attributes.vertices[3 * size_t(idx.vertex_index) + 2];
+
+				vertex.position = XMFLOAT3(vx, vy, -vz);
+
+				// Check if `normal_index` is zero or positive. negative = no normal data
+				if (idx.normal_index >= 0)
+				{
+					tinyobj::real_t nx = attributes.normals[3 * size_t(idx.normal_index) + 0];
+					tinyobj::real_t ny = attributes.normals[3 * size_t(idx.normal_index) + 1];
+					tinyobj::real_t nz = attributes.normals[3 * size_t(idx.normal_index) + 2];
+
+					vertex.normal = XMFLOAT3(nx, ny, -nz);
+				}
+
+				// Check if `texcoord_index` is zero or positive. negative = no texcoord data
+				if (idx.texcoord_index >= 0)
+				{
+					tinyobj::real_t tx = attributes.texcoords[2 * size_t(idx.texcoord_index) + 0];
+					tinyobj::real_t ty = attributes.texcoords[2 * size_t(idx.texcoord_index) + 1];
+
+					vertex.uv = XMFLOAT2(tx, 1.0f - ty);
+				}
+
+				verts[corner] = vertex;
+				indices[corner] = corner;
+				corner++;
+
+				// Optional: vertex colors
+				// tinyobj::real_t red   = attributes.colors[3*size_t(idx.vertex_index)+0];
+				// tinyobj::real_t green = attributes.colors[3*size_t(idx.vertex_index)+1];
+				// tinyobj::real_t blue  = attributes.colors[3*size_t(idx.vertex_index)+2];
+			}
+			index_offset += fv;
+		}
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Loads a file through the given backend several times and
+// reports the fastest run, which filters out one-off stalls
+// (the first run also warms the OS file cache for the rest)
+// --------------------------------------------------------
+ObjParser::BenchmarkResult ObjParser::Benchmark(const wchar_t* objFile, Backend backend, int iterations)
+{
+	BenchmarkResult result = {};
+	{
+		MappedFile file(objFile);
+		result.fileBytes = file.GetSize();
+	}
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	double fastest = DBL_MAX;
+
+	for (int i = 0; i < iterations; i++)
+	{
+		// Start every run from empty vectors so allocation is part of the cost
+		std::vector<Vertex>().swap(verts);
+		std::vector<unsigned int>().swap(indices);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		Load(objFile, backend, verts, indices);
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+		if (ms < fastest)
+			fastest = ms;
+	}
+
+	result.vertexCount = verts.size();
+	result.milliseconds = iterations > 0 ? fastest : 0.0;
+	if (result.milliseconds > 0.0)
+		result.megabytesPerSecond = (result.fileBytes / (1024.0 * 1024.0)) / (result.milliseconds / 1000.0);
+
+	return result;
+}
+
+const char* ObjParser::BackendToString(Backend backend)
+{
+	switch (backend)
+	{
+		case Stream:
+			return "Stream";
+
+		case Mapped:
+			return "Mapped";
+
+		case Parallel:
+			return "Parallel";
+
+		default:
+			return "Unknown";
+	}
+}
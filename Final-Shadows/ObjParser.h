@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include "Vertex.h"
+#include "MeshOptimizer.h"
+
+// --------------------------------------------------------
+// OBJ model loading into CPU-side vertex and index lists
+//
+// - Nothing here touches Direct3D, so these can be run and
+//   timed without a device
+// - Every backend produces exactly the same vertices, in
+//   the same order, as the original Stream loader
+// --------------------------------------------------------
+namespace ObjParser
+{
+	enum Backend
+	{
+		Stream,		// std::ifstream::getline + sscanf_s, one line at a time
+		Mapped,		// Memory mapped file, tokenized in place
+		Parallel	// Memory mapped file, split into chunks that are parsed on worker threads
+	};
+
+	// Number of each element in a file, used to size arrays up front
+	struct ObjCounts
+	{
+		size_t positions;
+		size_t uvs;
+		size_t normals;
+		size_t triangles;
+	};
+
+	struct BenchmarkResult
+	{
+		size_t fileBytes;
+		size_t vertexCount;
+		double milliseconds;		// Fastest of all iterations
+		double megabytesPerSecond;
+	};
+
+	bool Load(const wchar_t* objFile, Backend backend, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+	bool LoadStream(const wchar_t* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+	bool LoadMapped(const wchar_t* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+	bool LoadParallel(const wchar_t* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// tinyobjloader isn't one of the backends, since it groups faces by
+	// material and so gives vertices in a different order
+	bool LoadTinyObj(const wchar_t* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+		std::vector<MeshOptimizer::Submesh>& submeshes, std::vector<std::string>& materialNames);
+
+	ObjCounts CountElements(const char* data, size_t size);
+	bool ParseBuffer(const char* data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+	bool ParseBufferParallel(const char* data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+		unsigned int threadCount = 0);
+
+	BenchmarkResult Benchmark(const wchar_t* objFile, Backend backend, int iterations);
+	const char* BackendToString(Backend backend);
+}
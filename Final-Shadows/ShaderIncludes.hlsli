@@ -61,6 +61,52 @@ struct VertexShaderInput
 	float2 uv				: TEXCOORD;
 };
 
+// Quantized version of VertexShaderInput
+// - Must match CompactVertex in Vertex.h, the input layout converts
+//   the 16-bit UNORM/SNORM values to floats before the shader runs
+struct CompactVertexShaderInput
+{
+	float4 localPosition	: POSITION;     // 0-1 within the mesh bounds
+	float2 normal			: NORMAL;       // Octahedral encoding
+	float2 tangent			: TANGENT;      // Octahedral encoding
+	float2 uv				: TEXCOORD;     // 0-1 within the mesh uv bounds
+};
+
+// Position-only streams of a mesh, drawn by Mesh::DrawDepth()
+// - Must match PositionVertex and CompactPositionVertex in Vertex.h
+// - Only POSITION is in the input signature, so the input layout
+//   matches the tightly packed stream instead of a whole vertex
+struct DepthVertexShaderInput
+{
+	float3 localPosition	: POSITION;
+};
+
+struct CompactDepthVertexShaderInput
+{
+	float4 localPosition	: POSITION;     // UNORM16, 0-1 within the mesh bounds
+};
+
+// Unfolds an octahedral encoded direction back onto the unit sphere
+// - Must match DecodeOctahedral() in VertexCompression.cpp
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 direction = float3(encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-direction.z);
+	direction.xy += direction.xy >= 0.0f ? -fold : fold;
+	return normalize(direction);
+}
+
+// Turns a compact vertex back into a full one using its mesh's bounds
+VertexShaderInput DecodeCompactVertex(CompactVertexShaderInput input, float3 positionOffset, float3 positionScale, float2 uvOffset, float2 uvScale)
+{
+	VertexShaderInput output;
+	output.localPosition = positionOffset + input.localPosition.xyz * positionScale;
+	output.normal = DecodeOctahedral(input.normal);
+	output.tangent = DecodeOctahedral(input.tangent);
+	output.uv = uvOffset + input.uv * uvScale;
+	return output;
+}
+
 // Struct representing the data we're sending down the pipeline
 // - Should match our pixel shader's input (hence the name: Vertex to Pixel)
 // - At a minimum, we need a piece of data defined tagged as SV_POSITION
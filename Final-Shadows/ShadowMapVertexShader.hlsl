@@ -2,13 +2,32 @@
 
 cbuffer ExternalData : register(b0)
 {
-	matrix world;
+	row_major float3x4 world;	// Affine, like VertexShader.hlsl's
 	matrix view;
 	matrix proj;
+#ifdef COMPACT_VERTEX
+	float3 positionOffset;
+	float3 positionScale;
+#endif
 }
 
-float4 main( VertexShaderInput input ) : SV_POSITION
+float4 TransformPosition( float3 localPosition )
 {
-	matrix wvp = mul(proj, mul(view, world));
-	return mul(wvp, float4(input.localPosition, 1.0f));
-}
\ No newline at end of file
+	float4 worldPosition = float4(mul(world, float4(localPosition, 1.0f)), 1.0f);
+	return mul(proj, mul(view, worldPosition));
+}
+
+// CompactShadowMapVertexShader.hlsl compiles this file again with COMPACT_VERTEX
+// defined, for meshes uploaded as CompactVertex data (only the position is decoded)
+// - Both read the position-only stream bound by Mesh::DrawDepth()
+#ifdef COMPACT_VERTEX
+float4 main( CompactDepthVertexShaderInput input ) : SV_POSITION
+{
+	return TransformPosition(positionOffset + input.localPosition.xyz * positionScale);
+}
+#else
+float4 main( DepthVertexShaderInput input ) : SV_POSITION
+{
+	return TransformPosition(input.localPosition);
+}
+#endif
\ No newline at end of file
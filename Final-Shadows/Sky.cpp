@@ -1,4 +1,5 @@
 #include "Sky.h"
+#include "VertexFormat.h"
 
 using namespace std;
 using namespace DirectX;
@@ -51,6 +52,10 @@ Sky::~Sky()
 
 void Sky::Draw(std::shared_ptr<Camera> camera, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
 {
+	// The vertex shader is null if its input layout couldn't be made
+	if (!vertexShader)
+		return;
+
 	// Change necessary render states
 	context->RSSetState(rasterizerState.Get());
 	context->OMSetDepthStencilState(depthState.Get(), 0);
@@ -187,7 +192,7 @@ void Sky::InitResources(
 	Microsoft::WRL::ComPtr<ID3D11Device> device,
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
 {
-	vertexShader = make_shared<SimpleVertexShader>(device, context, vertexShaderPath);
+	vertexShader = LoadVertexShader<Vertex>(device, context, vertexShaderPath);
 	pixelShader = make_shared<SimplePixelShader>(device, context, pixelShaderPath);
 
 	D3D11_RASTERIZER_DESC rastDesc = {};
@@ -0,0 +1,349 @@
+#include <emmintrin.h>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include "TangentGenerator.h"
+#include "Helpers.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Least triangles each thread of Calculate() gets
+	const unsigned int minimumTrianglesPerThread = 16 * 1024;
+
+	// One thread's running tangent sums, as separate x, y and z arrays
+	struct TangentSums
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+	};
+
+	// --------------------------------------------------------
+	// Adds the tangents of triangles [firstTriangle, endTriangle)
+	// to each of their vertices' sums
+	// - Four triangles are gathered into SoA registers at a time
+	//   (the last block repeats its final triangle as padding)
+	// - Each lane does exactly the scalar version's operations,
+	//   and sums are added in the same triangle and corner order
+	// --------------------------------------------------------
+	void AccumulateTriangles(const Vertex* verts, const unsigned int* indices, int firstTriangle, int endTriangle, TangentSums& sums)
+	{
+		alignas(16) float px[3][4], py[3][4], pz[3][4];
+		alignas(16) float u[3][4], v[3][4];
+		alignas(16) float tx[4], ty[4], tz[4];
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		for (int block = firstTriangle; block < endTriangle; block += 4)
+		{
+			int lanes = endTriangle - block < 4 ? endTriangle - block : 4;
+
+			// Stage the block's corners
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const unsigned int* triangle = &indices[(block + (lane < lanes ? lane : lanes - 1)) * 3];
+				for (int corner = 0; corner < 3; corner++)
+				{
+					const Vertex& vertex = verts[triangle[corner]];
+					px[corner][lane] = vertex.position.x;
+					py[corner][lane] = vertex.position.y;
+					pz[corner][lane] = vertex.position.z;
+					u[corner][lane] = vertex.uv.x;
+					v[corner][lane] = vertex.uv.y;
+				}
+			}
+
+			// Vectors relative to the first corner's position and uv
+			__m128 p0x = _mm_load_ps(px[0]);
+			__m128 p0y = _mm_load_ps(py[0]);
+			__m128 p0z = _mm_load_ps(pz[0]);
+			__m128 x1 = _mm_sub_ps(_mm_load_ps(px[1]), p0x);
+			__m128 y1 = _mm_sub_ps(_mm_load_ps(py[1]), p0y);
+			__m128 z1 = _mm_sub_ps(_mm_load_ps(pz[1]), p0z);
+			__m128 x2 = _mm_sub_ps(_mm_load_ps(px[2]), p0x);
+			__m128 y2 = _mm_sub_ps(_mm_load_ps(py[2]), p0y);
+			__m128 z2 = _mm_sub_ps(_mm_load_ps(pz[2]), p0z);
+
+			__m128 u0 = _mm_load_ps(u[0]);
+			__m128 v0 = _mm_load_ps(v[0]);
+			__m128 s1 = _mm_sub_ps(_mm_load_ps(u[1]), u0);
+			__m128 t1 = _mm_sub_ps(_mm_load_ps(v[1]), v0);
+			__m128 s2 = _mm_sub_ps(_mm_load_ps(u[2]), u0);
+			__m128 t2 = _mm_sub_ps(_mm_load_ps(v[2]), v0);
+
+			// A real divide, not _mm_rcp_ps, so results match the scalar version
+			__m128 r = _mm_div_ps(one, _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1)));
+
+			_mm_store_ps(tx, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r));
+			_mm_store_ps(ty, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r));
+			_mm_store_ps(tz, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r));
+
+			// Scatter to the corners, which has to stay scalar since corners can repeat
+			for (int lane = 0; lane < lanes; lane++)
+			{
+				const unsigned int* triangle = &indices[(block + lane) * 3];
+				for (int corner = 0; corner < 3; corner++)
+				{
+					unsigned int index = triangle[corner];
+					sums.x[index] += tx[lane];
+					sums.y[index] += ty[lane];
+					sums.z[index] += tz[lane];
+				}
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Adds up every thread's sums for vertices [firstVertex,
+	// endVertex), always in thread order, then makes each
+	// tangent orthogonal to its normal (Gram-Schmidt) and
+	// normalizes it, four vertices at a time
+	// - Zero length tangents stay zero, like XMVector3Normalize
+	// --------------------------------------------------------
+	void ResolveTangents(Vertex* verts, const std::vector<TangentSums>& threadSums, int firstVertex, int endVertex)
+	{
+		alignas(16) float nx[4], ny[4], nz[4];
+		alignas(16) float tx[4], ty[4], tz[4];
+		const __m128 zero = _mm_setzero_ps();
+
+		for (int block = firstVertex; block < endVertex; block += 4)
+		{
+			int lanes = endVertex - block < 4 ? endVertex - block : 4;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				int i = block + (lane < lanes ? lane : lanes - 1);
+				nx[lane] = verts[i].normal.x;
+				ny[lane] = verts[i].normal.y;
+				nz[lane] = verts[i].normal.z;
+			}
+
+			__m128 sumX = _mm_loadu_ps(&threadSums[0].x[block]);
+			__m128 sumY = _mm_loadu_ps(&threadSums[0].y[block]);
+			__m128 sumZ = _mm_loadu_ps(&threadSums[0].z[block]);
+			for (int t = 1; t < threadSums.size(); t++)
+			{
+				sumX = _mm_add_ps(sumX, _mm_loadu_ps(&threadSums[t].x[block]));
+				sumY = _mm_add_ps(sumY, _mm_loadu_ps(&threadSums[t].y[block]));
+				sumZ = _mm_add_ps(sumZ, _mm_loadu_ps(&threadSums[t].z[block]));
+			}
+
+			__m128 normalX = _mm_load_ps(nx);
+			__m128 normalY = _mm_load_ps(ny);
+			__m128 normalZ = _mm_load_ps(nz);
+			__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, sumX), _mm_mul_ps(normalY, sumY)), _mm_mul_ps(normalZ, sumZ));
+			sumX = _mm_sub_ps(sumX, _mm_mul_ps(normalX, dot));
+			sumY = _mm_sub_ps(sumY, _mm_mul_ps(normalY, dot));
+			sumZ = _mm_sub_ps(sumZ, _mm_mul_ps(normalZ, dot));
+
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sumX, sumX), _mm_mul_ps(sumY, sumY)), _mm_mul_ps(sumZ, sumZ)));
+			__m128 nonZero = _mm_cmpneq_ps(length, zero);
+			_mm_store_ps(tx, _mm_and_ps(_mm_div_ps(sumX, length), nonZero));
+			_mm_store_ps(ty, _mm_and_ps(_mm_div_ps(sumY, length), nonZero));
+			_mm_store_ps(tz, _mm_and_ps(_mm_div_ps(sumZ, length), nonZero));
+
+			for (int lane = 0; lane < lanes; lane++)
+				verts[block + lane].tangent = XMFLOAT3(tx[lane], ty[lane], tz[lane]);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Calculates the tangents of the vertices in a mesh
+// - Triangles are split into one contiguous range per
+//   thread, and each thread sums into its own buffers (padded
+//   to whole blocks of four, for the SSE loads)
+// - Vertices are then split the same way for the reduction,
+//   which reads every thread's buffer in a fixed order
+// - With one thread the sums are added in exactly the same
+//   order as CalculateScalar(), and more threads only change
+//   how the partial sums are grouped
+// --------------------------------------------------------
+void TangentGenerator::Calculate(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices, unsigned int threadCount)
+{
+	if (numVerts == 0)
+		return;
+
+	int triangleCount = numIndices / 3;
+	threadCount = ResolveThreadCount(threadCount, triangleCount, minimumTrianglesPerThread);
+
+	int paddedVerts = (numVerts + 3) & ~3;
+	std::vector<TangentSums> threadSums(threadCount);
+	RunOnThreads(threadCount, [&](unsigned int t)
+	{
+		threadSums[t].x.assign(paddedVerts, 0.0f);
+		threadSums[t].y.assign(paddedVerts, 0.0f);
+		threadSums[t].z.assign(paddedVerts, 0.0f);
+
+		int firstTriangle = (int)((long long)triangleCount * t / threadCount);
+		int endTriangle = (int)((long long)triangleCount * (t + 1) / threadCount);
+		AccumulateTriangles(verts, indices, firstTriangle, endTriangle, threadSums[t]);
+	});
+
+	// Vertex ranges start on blocks of four, so no two threads write the same block
+	int blockCount = paddedVerts / 4;
+	RunOnThreads(threadCount, [&](unsigned int t)
+	{
+		int firstVertex = (int)((long long)blockCount * t / threadCount) * 4;
+		int endVertex = (int)((long long)blockCount * (t + 1) / threadCount) * 4;
+		endVertex = endVertex < numVerts ? endVertex : numVerts;
+		if (firstVertex < endVertex)
+			ResolveTangents(verts, threadSums, firstVertex, endVertex);
+	});
+}
+
+// --------------------------------------------------------
+// Author: Chris Cascioli
+// Purpose: Calculates the tangents of the vertices in a mesh
+//
+// - You are allowed to directly copy/paste this into your code base
+//   for assignments, given that you clearly cite that this is not
+//   code of your own design.
+//
+// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+//
+// - Note: For this code to work, your Vertex format must
+//         contain an XMFLOAT3 called Tangent
+//
+// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// --------------------------------------------------------
+void TangentGenerator::CalculateScalar(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices)
+{
+	// Reset tangents
+	for (int i = 0; i < numVerts; i++)
+	{
+		verts[i].tangent = XMFLOAT3(0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (int i = 0; i < numIndices;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->position.x - v1->position.x;
+		float y1 = v2->position.y - v1->position.y;
+		float z1 = v2->position.z - v1->position.z;
+
+		float x2 = v3->position.x - v1->position.x;
+		float y2 = v3->position.y - v1->position.y;
+		float z2 = v3->position.z - v1->position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->uv.x - v1->uv.x;
+		float t1 = v2->uv.y - v1->uv.y;
+
+		float s2 = v3->uv.x - v1->uv.x;
+		float t2 = v3->uv.y - v1->uv.y;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Adjust tangents of each vert of the triangle
+		v1->tangent.x += tx;
+		v1->tangent.y += ty;
+		v1->tangent.z += tz;
+
+		v2->tangent.x += tx;
+		v2->tangent.y += ty;
+		v2->tangent.z += tz;
+
+		v3->tangent.x += tx;
+		v3->tangent.y += ty;
+		v3->tangent.z += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (int i = 0; i < numVerts; i++)
+	{
+		// Grab the two vectors
+		XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].tangent);
+
+		// Use Gram-Schmidt orthonormalize to ensure
+		// the normal and tangent are exactly 90 degrees apart
+		tangent = XMVector3Normalize(
+			tangent - normal * XMVector3Dot(normal, tangent));
+
+		// Store the tangent
+		XMStoreFloat3(&verts[i].tangent, tangent);
+	}
+}
+
+// --------------------------------------------------------
+// Times the scalar, single thread SSE and multithreaded SSE
+// versions on the same data, and checks they agree
+// - Times are the fastest of all iterations, and every run
+//   starts from a fresh copy of the vertices
+// - Tangents that are NaN in both (triangles with no uv
+//   area) count as matching
+// --------------------------------------------------------
+TangentGenerator::BenchmarkResult TangentGenerator::Benchmark(const std::vector<Vertex>& verts, const unsigned int* indices, int numIndices, int iterations)
+{
+	BenchmarkResult result = {};
+	result.triangleCount = numIndices / 3;
+	result.threadCount = ResolveThreadCount(0, result.triangleCount, minimumTrianglesPerThread);
+	if (verts.size() == 0 || numIndices == 0)
+		return result;
+
+	int numVerts = (int)verts.size();
+	std::vector<Vertex> scalar;
+	std::vector<Vertex> work;
+	double* times[] = { &result.scalarMilliseconds, &result.simdMilliseconds, &result.threadedMilliseconds };
+
+	for (int version = 0; version < 3; version++)
+	{
+		double fastest = DBL_MAX;
+		for (int i = 0; i < iterations; i++)
+		{
+			work = verts;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			switch (version)
+			{
+				case 0: CalculateScalar(&work[0], numVerts, indices, numIndices); break;
+				case 1: Calculate(&work[0], numVerts, indices, numIndices, 1); break;
+				case 2: Calculate(&work[0], numVerts, indices, numIndices, result.threadCount); break;
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+
+			double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+			if (ms < fastest)
+				fastest = ms;
+		}
+		*times[version] = iterations > 0 ? fastest : 0.0;
+
+		if (version == 0)
+		{
+			scalar = work;
+			continue;
+		}
+
+		for (int i = 0; i < numVerts && iterations > 0; i++)
+		{
+			const float* a = &scalar[i].tangent.x;
+			const float* b = &work[i].tangent.x;
+			for (int c = 0; c < 3; c++)
+			{
+				float difference = (a[c] != a[c] || b[c] != b[c]) ?
+					((a[c] != a[c]) == (b[c] != b[c]) ? 0.0f : FLT_MAX) :
+					fabsf(a[c] - b[c]);
+				result.maxDifference = difference > result.maxDifference ? difference : result.maxDifference;
+			}
+		}
+	}
+
+	return result;
+}
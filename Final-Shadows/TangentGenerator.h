@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Per-vertex tangent generation for normal mapping
+//
+// - Calculate() is the one meshes use: SSE math over four
+//   triangles at a time, gathered into SoA registers, with
+//   large meshes split across threads
+// - Every thread sums into its own tangent buffer, and the
+//   buffers are added up in thread order afterwards, so the
+//   result never depends on thread timing
+// - CalculateScalar() is the original one triangle at a time
+//   version, kept as the reference for the benchmark
+// --------------------------------------------------------
+namespace TangentGenerator
+{
+	struct BenchmarkResult
+	{
+		int triangleCount;
+		unsigned int threadCount;		// Threads used by the multithreaded run
+		double scalarMilliseconds;		// Fastest time of each version
+		double simdMilliseconds;		// SSE on the calling thread only
+		double threadedMilliseconds;	// SSE on threadCount threads
+		float maxDifference;			// Largest tangent component difference to the scalar version
+	};
+
+	// threadCount 0 means one per hardware thread (small meshes always use one)
+	void Calculate(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices, unsigned int threadCount = 0);
+	void CalculateScalar(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices);
+
+	BenchmarkResult Benchmark(const std::vector<Vertex>& verts, const unsigned int* indices, int numIndices, int iterations);
+}
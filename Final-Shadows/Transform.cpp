@@ -1,5 +1,6 @@
 #include <cmath>
 #include "Transform.h"
+#include "TransformSystem.h"
 using namespace DirectX;
 
 Transform::Transform()
@@ -13,15 +14,29 @@ Transform::Transform()
 
 Transform::Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale, DirectX::XMFLOAT4 rotationQuat)
 	:
-	position(position),
-	scale(scale),
-	transformChanged(true),
-	rotationChanged(true)
+	index(TransformSystem::GetInstance().Create(position, scale, rotationQuat))
 {
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
-	SetRotation(rotationQuat);
-	pitchYawRoll = GetRotationPitchYawRoll();
+	UpdatePitchYawRoll();
+}
+
+Transform::Transform(const Transform& other)
+	:
+	index(TransformSystem::GetInstance().Create(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1), XMFLOAT4(0, 0, 0, 1)))
+{
+	TransformSystem::GetInstance().Copy(other.index, index);
+}
+
+Transform& Transform::operator=(const Transform& other)
+{
+	if (&other != this)
+		TransformSystem::GetInstance().Copy(other.index, index);
+
+	return *this;
+}
+
+Transform::~Transform()
+{
+	TransformSystem::GetInstance().Destroy(index);
 }
 
 // ------------------------------------------------------------------
@@ -29,116 +44,87 @@ Transform::Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale, Direct
 // ------------------------------------------------------------------
 void Transform::SetPosition(float x, float y, float z)
 {
-	position.x = x;
-	position.y = y;
-	position.z = z;
+	TransformSystem& system = TransformSystem::GetInstance();
+	system.positionX[index] = x;
+	system.positionY[index] = y;
+	system.positionZ[index] = z;
 
-	transformChanged = true;
+	system.dirty[index] = 1;
 }
 
 void Transform::SetPosition(DirectX::XMFLOAT3 pos)
 {
-	position = pos;
-
-	transformChanged = true;
+	SetPosition(pos.x, pos.y, pos.z);
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
-	scale.x = x;
-	scale.y = y;
-	scale.z = z;
-	
-	transformChanged = true;
+	TransformSystem& system = TransformSystem::GetInstance();
+	system.scaleX[index] = x;
+	system.scaleY[index] = y;
+	system.scaleZ[index] = z;
+
+	system.dirty[index] = 1;
 }
 
 void Transform::SetScale(float s)
 {
-	scale.x = s;
-	scale.y = s;
-	scale.z = s;
-
-	transformChanged = true;
+	SetScale(s, s, s);
 }
 
 void Transform::SetScale(DirectX::XMFLOAT3 size)
 {
-	scale = size;
-
-	transformChanged = true;
+	SetScale(size.x, size.y, size.z);
 }
 
 void Transform::SetRotation(DirectX::XMMATRIX m)
 {
-	XMFLOAT4X4 rotMat;
-	XMStoreFloat4x4(&rotMat, m);
-
-	rightVector = XMFLOAT3(rotMat._11, rotMat._12, rotMat._13);
-	upVector = XMFLOAT3(rotMat._21, rotMat._22, rotMat._23);
-	forwardVector = XMFLOAT3(rotMat._31, rotMat._32, rotMat._33);
-
-	transformChanged = true;
-	rotationChanged = true;
+	SetRotation(XMQuaternionRotationMatrix(m));
 }
 
 void Transform::SetRotation(DirectX::XMFLOAT4X4 m)
 {
-	rightVector = XMFLOAT3(m._11, m._12, m._13);
-	upVector = XMFLOAT3(m._21, m._22, m._23);
-	forwardVector = XMFLOAT3(m._31, m._32, m._33);
-
-	transformChanged = true;
-	rotationChanged = true;
+	SetRotation(XMLoadFloat4x4(&m));
 }
 
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
-	SetRotation(XMMatrixRotationRollPitchYaw(pitch, yaw, roll));
-
-	transformChanged = true;
-	rotationChanged = true;
+	SetRotation(XMFLOAT3(pitch, yaw, roll));
 }
 
+// The angles are kept, so reading them back doesn't have to work them out from the rotation
 void Transform::SetRotation(DirectX::XMFLOAT3 pitchYawRoll)
 {
-	SetRotation(XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)));
+	TransformSystem& system = TransformSystem::GetInstance();
+	system.SetRotation(index, XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)));
 
-	transformChanged = true;
-	rotationChanged = true;
+	system.pitchYawRolls[index] = pitchYawRoll;
+	system.rotationChanged[index] = 0;
 }
 
 void Transform::SetRotation(DirectX::XMFLOAT4 q)
 {
-	SetRotation(XMMatrixRotationQuaternion(XMLoadFloat4(&q)));
-
-	transformChanged = true;
-	rotationChanged = true;
+	SetRotation(XMLoadFloat4(&q));
 }
 
 void Transform::SetRotation(DirectX::XMVECTOR q)
 {
-	SetRotation(XMMatrixRotationQuaternion(q));
-
-	transformChanged = true;
-	rotationChanged = true;
+	TransformSystem::GetInstance().SetRotation(index, q);
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
 {
-	position.x += x;
-	position.y += y;
-	position.z += z;
+	TransformSystem& system = TransformSystem::GetInstance();
+	system.positionX[index] += x;
+	system.positionY[index] += y;
+	system.positionZ[index] += z;
 
-	transformChanged = true;
+	system.dirty[index] = 1;
 }
 
 void Transform::MoveAbsolute(DirectX::XMFLOAT3 move)
 {
-	position.x += move.x;
-	position.y += move.y;
-	position.z += move.z;
-
-	transformChanged = true;
+	MoveAbsolute(move.x, move.y, move.z);
 }
 
 // ------------------------------------------------------------------
@@ -146,159 +132,205 @@ void Transform::MoveAbsolute(DirectX::XMFLOAT3 move)
 // ------------------------------------------------------------------
 void Transform::MoveRelative(float x, float y, float z)
 {
-	XMVECTOR moveAbsolute = XMVectorSet(x, y, z, 1.0f);
-	XMVECTOR rot = XMQuaternionRotationMatrix(GetRotationMatrix());
-	XMVECTOR moveRelative = XMVector3Rotate(moveAbsolute, rot);
-
-	XMStoreFloat3(&position, XMLoadFloat3(&position) + moveRelative);
-	
-	transformChanged = true;
+	MoveRelative(XMFLOAT3(x, y, z));
 }
 
 void Transform::MoveRelative(DirectX::XMFLOAT3 move)
 {
-	XMVECTOR moveAbsolute = XMLoadFloat3(&move);
-	XMVECTOR rot = XMQuaternionRotationMatrix(GetRotationMatrix());
-	XMVECTOR moveRelative = XMVector3Rotate(moveAbsolute, rot);
-
-	XMStoreFloat3(&position, XMLoadFloat3(&position) + moveRelative);
-
-	transformChanged = true;
+	TransformSystem::GetInstance().MoveRelative(index, move);
 }
 
 void Transform::Scale(float x, float y, float z)
 {
-	scale.x *= x;
-	scale.y *= y;
-	scale.z *= z;
+	TransformSystem& system = TransformSystem::GetInstance();
+	system.scaleX[index] *= x;
+	system.scaleY[index] *= y;
+	system.scaleZ[index] *= z;
 
-	transformChanged = true;
+	system.dirty[index] = 1;
 }
 
 void Transform::Scale(float s)
 {
-	scale.x *= s;
-	scale.y *= s;
-	scale.z *= s;
-
-	transformChanged = true;
+	Scale(s, s, s);
 }
 
 void Transform::Scale(DirectX::XMFLOAT3 size)
 {
-	scale.x *= size.x;
-	scale.y *= size.y;
-	scale.z *= size.z;
-
-	transformChanged = true;
+	Scale(size.x, size.y, size.z);
 }
 
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
-	XMVECTOR newQuaternion = XMQuaternionRotationRollPitchYaw(pitch, yaw, roll);
-	XMVECTOR combinedQuaternion = XMQuaternionMultiply(newQuaternion, XMQuaternionRotationMatrix(GetRotationMatrix()));
+	TransformSystem::GetInstance().Rotate(index, XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+}
 
-	SetRotation(combinedQuaternion);
+void Transform::Rotate(float radians, DirectX::XMFLOAT3 rotateAround)
+{
+	TransformSystem::GetInstance().Rotate(index, XMQuaternionRotationNormal(XMLoadFloat3(&rotateAround), radians));
+}
 
-	pitchYawRoll.x += pitch;
-	pitchYawRoll.y += yaw;
-	pitchYawRoll.z += roll;
+// ------------------------------------------------------------------
+// Get Transform Properties
+// ------------------------------------------------------------------
+DirectX::XMFLOAT3 Transform::GetPosition()
+{
+	TransformSystem& system = TransformSystem::GetInstance();
+	return XMFLOAT3(system.positionX[index], system.positionY[index], system.positionZ[index]);
+}
 
-	transformChanged = true;
-	rotationChanged = true;
+DirectX::XMFLOAT3 Transform::GetScale()
+{
+	TransformSystem& system = TransformSystem::GetInstance();
+	return XMFLOAT3(system.scaleX[index], system.scaleY[index], system.scaleZ[index]);
 }
 
-void Transform::Rotate(float radians, DirectX::XMFLOAT3 rotateAround)
+// The axes are worked out from the rotation each time, which costs less than keeping them
+DirectX::XMFLOAT3 Transform::GetRight()
 {
-	XMVECTOR newQuaternion = XMQuaternionRotationNormal(XMLoadFloat3(&rotateAround), radians);
-	XMVECTOR combinedQuaternion = XMQuaternionMultiply(newQuaternion, XMQuaternionRotationMatrix(GetRotationMatrix()));
+	XMFLOAT3 right, up, forward;
+	TransformSystem::GetInstance().GetAxes(index, right, up, forward);
+	return right;
+}
 
-	SetRotation(combinedQuaternion);
+DirectX::XMFLOAT3 Transform::GetUp()
+{
+	XMFLOAT3 right, up, forward;
+	TransformSystem::GetInstance().GetAxes(index, right, up, forward);
+	return up;
+}
 
-	transformChanged = true;
-	rotationChanged = true;
+DirectX::XMFLOAT3 Transform::GetForward()
+{
+	XMFLOAT3 right, up, forward;
+	TransformSystem::GetInstance().GetAxes(index, right, up, forward);
+	return forward;
 }
 
-// ------------------------------------------------------------------
-// Get Transform Properties
-// ------------------------------------------------------------------
 DirectX::XMFLOAT4X4 Transform::GetRotationFloat4X4()
 {
 	XMFLOAT4X4 rotMat;
-	XMStoreFloat4x4(&rotMat, XMMatrixSet(rightVector.x, rightVector.y, rightVector.z, 0,
-		upVector.x, upVector.y, upVector.z, 0,
-		forwardVector.x, forwardVector.y, forwardVector.z, 0,
-		0, 0, 0, 1));
+	XMStoreFloat4x4(&rotMat, GetRotationMatrix());
 
 	return rotMat;
 }
 
 DirectX::XMMATRIX Transform::GetRotationMatrix()
 {
-	return XMMatrixSet(rightVector.x, rightVector.y, rightVector.z, 0,
-		upVector.x, upVector.y, upVector.z, 0,
-		forwardVector.x, forwardVector.y, forwardVector.z, 0,
-		0, 0, 0, 1);
+	return XMMatrixRotationQuaternion(TransformSystem::GetInstance().GetRotation(index));
+}
+
+DirectX::XMFLOAT4 Transform::GetRotationQuaternion()
+{
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, TransformSystem::GetInstance().GetRotation(index));
+	return rotation;
 }
 
 DirectX::XMFLOAT3 Transform::GetRotationPitchYawRoll()
 {
 	UpdatePitchYawRoll();
 
-	return pitchYawRoll;
+	return TransformSystem::GetInstance().pitchYawRolls[index];
+}
+
+unsigned int Transform::GetWorldMatrixVersion()
+{
+	return TransformSystem::GetInstance().worldMatrixVersions[index];
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
+{
+	XMFLOAT3X4 world = GetWorldMatrix3x4();
+
+	XMFLOAT4X4 worldMat;
+	XMStoreFloat4x4(&worldMat, XMLoadFloat3x4(&world));
+	return worldMat;
+}
+
+// World's inverse transpose, for normals; it has no translation
+DirectX::XMFLOAT4X4 Transform::GetNormalMatrix()
+{
+	XMFLOAT3X4 normal = GetNormalMatrix3x4();
+
+	XMFLOAT4X4 normalMat;
+	XMStoreFloat4x4(&normalMat, XMLoadFloat3x4(&normal));
+	return normalMat;
+}
+
+// Stored form of the world matrix: transposed, without its (0, 0, 0, 1) column, for row_major float3x4 in shaders
+DirectX::XMFLOAT3X4 Transform::GetWorldMatrix3x4()
 {
 	UpdateWorldMatrix();
 
-	return worldMatrix;
+	return TransformSystem::GetInstance().worldMatrices[index];
 }
 
-DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
+DirectX::XMFLOAT3X4 Transform::GetNormalMatrix3x4()
 {
 	UpdateWorldMatrix();
 
-	return worldInverseTransposeMatrix;
+	return TransformSystem::GetInstance().normalMatrices[index];
+}
+
+// ------------------------------------------------------------------
+// Hierarchy
+// ------------------------------------------------------------------
+
+// Null detaches; false (and no change) if parent is this or below it
+bool Transform::SetParent(Transform* parent, bool keepWorldTransform)
+{
+	unsigned int parentIndex = parent ? parent->index : TransformSystem::noParent;
+	return TransformSystem::GetInstance().SetParent(index, parentIndex, keepWorldTransform);
+}
+
+bool Transform::HasParent()
+{
+	return TransformSystem::GetInstance().GetParent(index) != TransformSystem::noParent;
+}
+
+// TransformSystem::noParent without one
+unsigned int Transform::GetParentIndex()
+{
+	return TransformSystem::GetInstance().GetParent(index);
+}
+
+// Id listed in TransformSystem's change journal whenever the world matrix changes
+void Transform::SetJournalId(unsigned int id)
+{
+	TransformSystem::GetInstance().SetJournalId(index, id);
 }
 
 // ------------------------------------------------------------------
 // Update Class Fields When Transform Has Been Changed
 // ------------------------------------------------------------------
+
+// Usually already done by TransformSystem::UpdateWorldMatrices(), for every transform at once
 void Transform::UpdateWorldMatrix()
 {
-	if (transformChanged)
-	{
-		XMMATRIX scaleMatrix = XMMatrixScaling(scale.x, scale.y, scale.z);
-		XMMATRIX rotationMatrix = XMMatrixSet(rightVector.x, rightVector.y, rightVector.z, 0,
-			upVector.x, upVector.y, upVector.z, 0,
-			forwardVector.x, forwardVector.y, forwardVector.z, 0,
-			0, 0, 0, 1);
-		XMMATRIX translationMatrix = XMMatrixTranslation(position.x, position.y, position.z);
-		XMMATRIX world = scaleMatrix * rotationMatrix * translationMatrix;
-
-		XMStoreFloat4x4(&worldMatrix, world);
-		XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixInverse(nullptr, XMMatrixTranspose(world)));
-
-		transformChanged = false;
-	}
+	TransformSystem::GetInstance().UpdateWorldMatrix(index);
 }
 
 void Transform::UpdatePitchYawRoll()
 {
-	if (rotationChanged)
+	TransformSystem& system = TransformSystem::GetInstance();
+	if (system.rotationChanged[index])
 	{
+		XMFLOAT3 right, up, forward;
+		system.GetAxes(index, right, up, forward);
+
 		// Solution derived from:
 		// https://stackoverflow.com/questions/60350349/directx-get-pitch-yaw-roll-from-xmmatrix
-		pitchYawRoll.x = XMScalarASin(-forwardVector.y);
+		XMFLOAT3& pitchYawRoll = system.pitchYawRolls[index];
+		pitchYawRoll.x = XMScalarASin(-forward.y);
 
-		XMVECTOR from(XMVectorSet(rightVector.y, forwardVector.x, 0.0f, 0.0f));
-		XMVECTOR to(XMVectorSet(upVector.y, forwardVector.z, 0.0f, 0.0f));
+		XMVECTOR from(XMVectorSet(right.y, forward.x, 0.0f, 0.0f));
+		XMVECTOR to(XMVectorSet(up.y, forward.z, 0.0f, 0.0f));
 		XMVECTOR result(XMVectorATan2(from, to));
 
 		pitchYawRoll.z = XMVectorGetX(result);
 		pitchYawRoll.y = XMVectorGetY(result);
 
-		rotationChanged = false;
+		system.rotationChanged[index] = 0;
 	}
-}
\ No newline at end of file
+}
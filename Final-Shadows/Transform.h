@@ -2,13 +2,27 @@
 
 #include <DirectXMath.h>
 
+// --------------------------------------------------------
+// Position, rotation and scale of one object
+// - Only an index: the data lives in TransformSystem, with
+//   every other transform's, and copies get a slot of their
+//   own there
+// - Rotation is kept as a quaternion; its axes and Euler
+//   angles are worked out from it when asked for, and the
+//   angles (for the editor) are kept until it changes
+// - With a parent, position, rotation and scale are local
+//   to the parent's, and it moves along with the parent
+// --------------------------------------------------------
 class Transform
 {
 public:
 	Transform();
 	Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale,
 		DirectX::XMFLOAT4 rotationQuat);
-	
+	Transform(const Transform& other);
+	Transform& operator=(const Transform& other);
+	~Transform();
+
 	void SetPosition(float x, float y, float z);
 	void SetPosition(DirectX::XMFLOAT3 pos);
 	void SetScale(float x, float y, float z);
@@ -21,18 +35,28 @@ public:
 	void SetRotation(DirectX::XMFLOAT4 q);
 	void SetRotation(DirectX::XMVECTOR q);
 
-	DirectX::XMFLOAT3 GetPosition() { return position; }
-	DirectX::XMFLOAT3 GetScale() { return scale; }
+	DirectX::XMFLOAT3 GetPosition();
+	DirectX::XMFLOAT3 GetScale();
 	DirectX::XMFLOAT4X4 GetRotationFloat4X4();
 	DirectX::XMMATRIX GetRotationMatrix();
+	DirectX::XMFLOAT4 GetRotationQuaternion();
 
 	void UpdatePitchYawRoll();
 	DirectX::XMFLOAT3 GetRotationPitchYawRoll();
 
 	void UpdateWorldMatrix();
+	unsigned int GetWorldMatrixVersion();
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
-	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+	DirectX::XMFLOAT4X4 GetNormalMatrix();
+	DirectX::XMFLOAT3X4 GetWorldMatrix3x4();
+	DirectX::XMFLOAT3X4 GetNormalMatrix3x4();
+	unsigned int GetIndex() { return index; }
+
+	bool SetParent(Transform* parent, bool keepWorldTransform = false);
+	bool HasParent();
+	unsigned int GetParentIndex();
 
+	void SetJournalId(unsigned int id);
 
 	void MoveAbsolute(float x, float y, float z);
 	void MoveAbsolute(DirectX::XMFLOAT3 move);
@@ -43,24 +67,11 @@ public:
 	void Scale(DirectX::XMFLOAT3 size);
 	void Rotate(float pitch, float yaw, float roll);
 	void Rotate(float radians, DirectX::XMFLOAT3 rotateAround = DirectX::XMFLOAT3(0, 0, -1.0f));
-	
-	DirectX::XMFLOAT3 GetRight() {return rightVector; }
-	DirectX::XMFLOAT3 GetUp() { return upVector; }
-	DirectX::XMFLOAT3 GetForward() { return forwardVector; }
-
-private:
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
 
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 scale;
-	DirectX::XMFLOAT3 pitchYawRoll;
+	DirectX::XMFLOAT3 GetRight();
+	DirectX::XMFLOAT3 GetUp();
+	DirectX::XMFLOAT3 GetForward();
 
-	DirectX::XMFLOAT3 rightVector;
-	DirectX::XMFLOAT3 upVector;
-	DirectX::XMFLOAT3 forwardVector;
-
-	bool transformChanged;
-	bool rotationChanged;
+private:
+	unsigned int index;	// Slot in TransformSystem's arrays
 };
-
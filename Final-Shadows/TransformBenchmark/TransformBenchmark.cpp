@@ -0,0 +1,107 @@
+#include <Windows.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../TransformSystem.h"
+#include "../Helpers.h"
+
+// --------------------------------------------------------
+// Transform update benchmark
+//
+// Rebuilds the world matrices of 1k, 100k and 1M random
+// transforms (or the counts given with -c) and reports, for
+// each count:
+// - The original one at a time version, with a general
+//   matrix inverse
+// - The SSE batch pass on one thread, then on every thread
+// - The largest difference between their matrices
+// - Moving, then rotating, every transform once
+//
+// The table it prints is also saved to the -o file as JSON
+//
+// Usage: TransformBenchmark [-c count]... [-n iterations] [-o results.json]
+// --------------------------------------------------------
+
+namespace
+{
+	bool WriteJson(const char* outputPath, const std::vector<TransformSystem::BenchmarkResult>& results, int iterations)
+	{
+		FILE* out = OpenBenchmarkJson(outputPath, iterations);
+		if (!out)
+			return false;
+
+		fprintf(out, "  \"runs\": [\n");
+		for (size_t r = 0; r < results.size(); r++)
+		{
+			const TransformSystem::BenchmarkResult& result = results[r];
+			fprintf(out, "    {\n");
+			fprintf(out, "      \"transforms\": %d,\n", result.transformCount);
+			fprintf(out, "      \"threads\": %u,\n", result.threadCount);
+			fprintf(out, "      \"scalarMilliseconds\": %.4f,\n", result.scalarMilliseconds);
+			fprintf(out, "      \"simdMilliseconds\": %.4f,\n", result.simdMilliseconds);
+			fprintf(out, "      \"threadedMilliseconds\": %.4f,\n", result.threadedMilliseconds);
+			fprintf(out, "      \"maxDifference\": %g,\n", result.maxDifference);
+			fprintf(out, "      \"moveMilliseconds\": %.4f,\n", result.moveMilliseconds);
+			fprintf(out, "      \"rotateMilliseconds\": %.4f\n", result.rotateMilliseconds);
+			fprintf(out, "    }%s\n", r + 1 < results.size() ? "," : "");
+		}
+		fprintf(out, "  ]\n");
+		fprintf(out, "}\n");
+
+		fclose(out);
+		return true;
+	}
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	std::vector<int> counts;
+	int iterations = 5;
+	std::string outputPath = "TransformBenchmark.json";
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::wstring option = argv[i];
+		if (option == L"-c")
+		{
+			int count = _wtoi(argv[i + 1]);
+			if (count > 0)
+				counts.push_back(count);
+		}
+		else if (option == L"-n")
+		{
+			iterations = _wtoi(argv[i + 1]);
+			iterations = iterations > 0 ? iterations : 1;
+		}
+		else if (option == L"-o")
+		{
+			outputPath = WideToNarrow(argv[i + 1]);
+		}
+	}
+
+	if (counts.size() == 0)
+		counts = { 1000, 100000, 1000000 };
+
+	printf("%12s %8s %12s %12s %12s %10s %12s %10s %10s\n", "Transforms", "Threads", "Scalar ms", "SIMD ms", "Threaded ms", "Speedup", "Max diff", "Move ms", "Rotate ms");
+
+	std::vector<TransformSystem::BenchmarkResult> results;
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		TransformSystem::BenchmarkResult result = TransformSystem::Benchmark(counts[c], iterations);
+		results.push_back(result);
+
+		double speedup = result.threadedMilliseconds > 0.0 ? result.scalarMilliseconds / result.threadedMilliseconds : 0.0;
+		printf("%12d %8u %12.3f %12.3f %12.3f %9.1fx %12g %10.3f %10.3f\n", result.transformCount, result.threadCount,
+			result.scalarMilliseconds, result.simdMilliseconds, result.threadedMilliseconds, speedup, result.maxDifference,
+			result.moveMilliseconds, result.rotateMilliseconds);
+	}
+
+	if (!WriteJson(outputPath.c_str(), results, iterations))
+	{
+		printf("Could not write %s\n", outputPath.c_str());
+		return 1;
+	}
+
+	printf("Results written to %s\n", outputPath.c_str());
+	return 0;
+}
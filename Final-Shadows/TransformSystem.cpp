@@ -0,0 +1,714 @@
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#include <chrono>
+#include <random>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include "TransformSystem.h"
+#include "Helpers.h"
+
+using namespace DirectX;
+
+TransformSystem* TransformSystem::instance;
+
+namespace
+{
+	// Least transforms each thread of a world matrix pass gets
+	const unsigned int minimumTransformsPerThread = 16 * 1024;
+
+	// Writes row "row" of four matrices, one per lane, keeping lanes not in the mask as they were
+	void StoreRow(XMFLOAT3X4* matrices, int row, __m128 x, __m128 y, __m128 z, __m128 w, unsigned int mask)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		__m128 rows[4] = { x, y, z, w };
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (mask & (1 << lane))
+				_mm_storeu_ps(matrices[lane].m[row], rows[lane]);
+		}
+	}
+}
+
+TransformSystem::TransformSystem()
+	:
+	hierarchyChanged(false),
+	changedCount(0),
+	journalFrame(0),
+	lastChangedCount(0),
+	lastUpdateCount(0)
+{
+}
+
+// --------------------------------------------------------
+// Makes a new transform, reusing a destroyed one's slot if
+// there is one
+// - Slots are added four at a time, so the SIMD pass always
+//   has whole blocks of four to work on
+// --------------------------------------------------------
+unsigned int TransformSystem::Create(XMFLOAT3 position, XMFLOAT3 scale, XMFLOAT4 rotationQuat)
+{
+	if (freeSlots.size() == 0)
+	{
+		unsigned int first = (unsigned int)dirty.size();
+		unsigned int size = first + 4;
+		std::vector<float>* floats[] = { &positionX, &positionY, &positionZ, &scaleX, &scaleY, &scaleZ,
+			&rotationX, &rotationY, &rotationZ, &rotationW };
+		for (int i = 0; i < sizeof(floats) / sizeof(floats[0]); i++)
+			floats[i]->resize(size, 0.0f);
+
+		// Free slots still get the math done in their lane, so they need a scale that divides cleanly
+		for (unsigned int i = first; i < size; i++)
+		{
+			scaleX[i] = scaleY[i] = scaleZ[i] = 1.0f;
+			rotationW[i] = 1.0f;
+		}
+
+		XMFLOAT3X4 identity;
+		XMStoreFloat3x4(&identity, XMMatrixIdentity());
+		worldMatrices.resize(size, identity);
+		normalMatrices.resize(size, identity);
+		worldMatrixVersions.resize(size, 0);
+		pitchYawRolls.resize(size, XMFLOAT3(0, 0, 0));
+		rotationChanged.resize(size, 0);
+		parents.resize(size, noParent);
+		childCounts.resize(size, 0);
+		parentVersions.resize(size, 0);
+		journalIds.resize(size, noJournalId);
+		journalFrames.resize(size, noJournalId);
+		changedIds.resize(size, noJournalId);
+		dirty.resize(size, 0);
+
+		// Lowest slot on top, so transforms fill the arrays in order
+		for (unsigned int i = size; i > first; i--)
+			freeSlots.push_back(i - 1);
+	}
+
+	unsigned int index = freeSlots.back();
+	freeSlots.pop_back();
+
+	StoreLocal(index, position, scale, rotationQuat);
+	pitchYawRolls[index] = XMFLOAT3(0, 0, 0);
+	return index;
+}
+
+// --------------------------------------------------------
+// Frees a transform's slot
+// - Its children become roots where they are now, so
+//   nothing jumps when a parent goes away first
+// --------------------------------------------------------
+void TransformSystem::Destroy(unsigned int index)
+{
+	for (unsigned int i = 0; i < parents.size() && childCounts[index] > 0; i++)
+	{
+		if (parents[i] == index)
+			SetParent(i, noParent, true);
+	}
+	SetParent(index, noParent, false);
+	SetJournalId(index, noJournalId);
+
+	dirty[index] = 0;
+	freeSlots.push_back(index);
+}
+
+// --------------------------------------------------------
+// Copies one transform over another, which then rebuilds
+// its matrices like any changed transform
+// - The parent link isn't copied: the values just become
+//   local to whatever parent the target already has
+// --------------------------------------------------------
+void TransformSystem::Copy(unsigned int from, unsigned int to)
+{
+	std::vector<float>* floats[] = { &positionX, &positionY, &positionZ, &scaleX, &scaleY, &scaleZ,
+		&rotationX, &rotationY, &rotationZ, &rotationW };
+	for (int i = 0; i < sizeof(floats) / sizeof(floats[0]); i++)
+		(*floats[i])[to] = (*floats[i])[from];
+
+	pitchYawRolls[to] = pitchYawRolls[from];
+	rotationChanged[to] = rotationChanged[from];
+	dirty[to] = 1;
+}
+
+// --------------------------------------------------------
+// Attaches a transform to a parent (or detaches it, with
+// noParent), making its values local to the parent's
+// - keepWorldTransform swaps the local values for ones that
+//   leave it where it is; otherwise the current values are
+//   just read relative to the new parent
+// - A scaled parent with a rotated child can skew it, which
+//   position, rotation and scale can't express, so kept
+//   transforms get the nearest of those
+// --------------------------------------------------------
+bool TransformSystem::SetParent(unsigned int index, unsigned int parent, bool keepWorldTransform)
+{
+	for (unsigned int above = parent; above != noParent; above = parents[above])
+	{
+		if (above == index)
+			return false;
+	}
+
+	if (parents[index] == parent)
+		return true;
+
+	if (keepWorldTransform)
+	{
+		UpdateWorldMatrix(index);
+		XMMATRIX local = XMLoadFloat3x4(&worldMatrices[index]);
+		if (parent != noParent)
+		{
+			UpdateWorldMatrix(parent);
+			local = XMMatrixMultiply(local, XMMatrixInverse(nullptr, XMLoadFloat3x4(&worldMatrices[parent])));
+		}
+
+		XMVECTOR scale, rotation, translation;
+		if (XMMatrixDecompose(&scale, &rotation, &translation, local))
+		{
+			XMFLOAT3 newPosition, newScale;
+			XMFLOAT4 newRotation;
+			XMStoreFloat3(&newPosition, translation);
+			XMStoreFloat3(&newScale, scale);
+			XMStoreFloat4(&newRotation, rotation);
+			StoreLocal(index, newPosition, newScale, newRotation);
+		}
+	}
+
+	if (parents[index] != noParent)
+		childCounts[parents[index]]--;
+	if (parent != noParent)
+		childCounts[parent]++;
+
+	parents[index] = parent;
+	dirty[index] = 1;
+	hierarchyChanged = true;
+	return true;
+}
+
+// Sets a transform's position, scale and rotation, marking it dirty
+void TransformSystem::StoreLocal(unsigned int index, XMFLOAT3 position, XMFLOAT3 scale, XMFLOAT4 rotationQuat)
+{
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+	positionZ[index] = position.z;
+	scaleX[index] = scale.x;
+	scaleY[index] = scale.y;
+	scaleZ[index] = scale.z;
+
+	SetRotation(index, XMLoadFloat4(&rotationQuat));
+}
+
+// Normalized as it's stored, so rotations built up over time don't drift into scaling
+void TransformSystem::SetRotation(unsigned int index, XMVECTOR rotationQuat)
+{
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionNormalize(rotationQuat));
+	rotationX[index] = rotation.x;
+	rotationY[index] = rotation.y;
+	rotationZ[index] = rotation.z;
+	rotationW[index] = rotation.w;
+
+	rotationChanged[index] = 1;
+	dirty[index] = 1;
+}
+
+XMVECTOR TransformSystem::GetRotation(unsigned int index)
+{
+	return XMVectorSet(rotationX[index], rotationY[index], rotationZ[index], rotationW[index]);
+}
+
+// --------------------------------------------------------
+// The rotation's right, up and forward axes (the rows of
+// its matrix), from the quaternion
+// - The same operations as a BuildMatrices4() lane
+// --------------------------------------------------------
+void TransformSystem::GetAxes(unsigned int i, XMFLOAT3& right, XMFLOAT3& up, XMFLOAT3& forward)
+{
+	float x2 = rotationX[i] + rotationX[i];
+	float y2 = rotationY[i] + rotationY[i];
+	float z2 = rotationZ[i] + rotationZ[i];
+	float xx = rotationX[i] * x2;
+	float yy = rotationY[i] * y2;
+	float zz = rotationZ[i] * z2;
+	float xy = rotationX[i] * y2;
+	float xz = rotationX[i] * z2;
+	float yz = rotationY[i] * z2;
+	float wx = rotationW[i] * x2;
+	float wy = rotationW[i] * y2;
+	float wz = rotationW[i] * z2;
+
+	right = XMFLOAT3(1.0f - (yy + zz), xy + wz, xz - wy);
+	up = XMFLOAT3(xy - wz, 1.0f - (xx + zz), yz + wx);
+	forward = XMFLOAT3(xz + wy, yz - wx, 1.0f - (xx + yy));
+}
+
+// Moves along the transform's own axes
+void TransformSystem::MoveRelative(unsigned int index, XMFLOAT3 move)
+{
+	XMFLOAT3 moved;
+	XMStoreFloat3(&moved, XMVector3Rotate(XMLoadFloat3(&move), GetRotation(index)));
+	positionX[index] += moved.x;
+	positionY[index] += moved.y;
+	positionZ[index] += moved.z;
+
+	dirty[index] = 1;
+}
+
+// Applies rotationQuat before the current rotation, so it turns the transform about its own axes
+void TransformSystem::Rotate(unsigned int index, XMVECTOR rotationQuat)
+{
+	SetRotation(index, XMQuaternionMultiply(rotationQuat, GetRotation(index)));
+}
+
+// --------------------------------------------------------
+// Rebuilds every dirty world matrix, in blocks of four
+// - Blocks with nothing dirty are skipped after one 4 byte
+//   check, so a frame where little moved costs a scan of
+//   the dirty flags and not much more
+// - Each thread gets its own whole blocks, so no two write
+//   the same matrix
+// - Transforms with a parent are left to one pass after,
+//   since they need their parent's finished matrices
+// - Past 32k transforms the work is split over threads that
+//   are started and joined on every call, so every frame;
+//   that's tens of microseconds per thread, small next to
+//   the 16k or more transforms each thread goes through
+// --------------------------------------------------------
+void TransformSystem::UpdateWorldMatrices(unsigned int threadCount)
+{
+	unsigned int count = (unsigned int)dirty.size();
+	threadCount = ResolveThreadCount(threadCount, count, minimumTransformsPerThread);
+	if (threadCount == 1)
+	{
+		lastUpdateCount = UpdateRange(0, count);
+	}
+	else
+	{
+		unsigned int blocks = count / 4;
+		std::vector<unsigned int> updated(threadCount);
+		RunOnThreads(threadCount, [&](unsigned int t)
+		{
+			unsigned int first = (unsigned int)((unsigned long long)blocks * t / threadCount) * 4;
+			unsigned int end = (unsigned int)((unsigned long long)blocks * (t + 1) / threadCount) * 4;
+			updated[t] = UpdateRange(first, end);
+		});
+
+		lastUpdateCount = 0;
+		for (unsigned int t = 0; t < threadCount; t++)
+			lastUpdateCount += updated[t];
+	}
+
+	lastUpdateCount += UpdateHierarchy();
+}
+
+// The original one matrix at a time version, with a general inverse, kept as the reference for the benchmark
+void TransformSystem::UpdateWorldMatricesScalar()
+{
+	lastUpdateCount = 0;
+	for (unsigned int i = 0; i < dirty.size(); i++)
+	{
+		if (!dirty[i] || parents[i] != noParent)
+			continue;
+
+		XMMATRIX scaleMatrix = XMMatrixScaling(scaleX[i], scaleY[i], scaleZ[i]);
+		XMMATRIX rotationMatrix = XMMatrixRotationQuaternion(GetRotation(i));
+		XMMATRIX translationMatrix = XMMatrixTranslation(positionX[i], positionY[i], positionZ[i]);
+		XMMATRIX world = scaleMatrix * rotationMatrix * translationMatrix;
+
+		XMStoreFloat3x4(&worldMatrices[i], world);
+		XMStoreFloat3x4(&normalMatrices[i], XMMatrixInverse(nullptr, XMMatrixTranspose(world)));
+
+		dirty[i] = 0;
+		worldMatrixVersions[i]++;
+		Journal(i);
+		lastUpdateCount++;
+	}
+
+	lastUpdateCount += UpdateHierarchy();
+}
+
+// Rebuilds one transform's matrices now, if they're out of date, along with any out of date ones above it
+void TransformSystem::UpdateWorldMatrix(unsigned int index)
+{
+	if (parents[index] != noParent)
+	{
+		UpdateWorldMatrix(parents[index]);
+		UpdateChild(index);
+		return;
+	}
+
+	if (!dirty[index])
+		return;
+
+	BuildMatrices(index, worldMatrices[index], normalMatrices[index]);
+	dirty[index] = 0;
+	worldMatrixVersions[index]++;
+	Journal(index);
+}
+
+unsigned int TransformSystem::UpdateRange(unsigned int first, unsigned int end)
+{
+	unsigned int updated = 0;
+	for (unsigned int i = first; i < end; i += 4)
+	{
+		unsigned int flags;
+		memcpy(&flags, &dirty[i], sizeof(flags));
+		if (flags == 0)
+			continue;
+
+		unsigned int mask = 0;
+		for (unsigned int lane = 0; lane < 4; lane++)
+		{
+			if (!dirty[i + lane] || parents[i + lane] != noParent)
+				continue;
+
+			mask |= 1 << lane;
+			dirty[i + lane] = 0;
+			worldMatrixVersions[i + lane]++;
+			Journal(i + lane);
+			updated++;
+		}
+
+		if (mask != 0)
+			BuildMatrices4(i, mask);
+	}
+	return updated;
+}
+
+// --------------------------------------------------------
+// Rebuilds every child whose matrices are out of date, in
+// one walk over the children, parents first
+// - A child is out of date when it changed itself or its
+//   parent's matrix has a newer version than the one it was
+//   built from, so changes carry down only their own subtree
+// --------------------------------------------------------
+unsigned int TransformSystem::UpdateHierarchy()
+{
+	if (hierarchyChanged)
+		SortHierarchy();
+
+	unsigned int updated = 0;
+	for (unsigned int i = 0; i < hierarchyOrder.size(); i++)
+	{
+		if (UpdateChild(hierarchyOrder[i]))
+			updated++;
+	}
+	return updated;
+}
+
+// --------------------------------------------------------
+// Local matrices times the parent's, for a child whose
+// parent is already up to date
+// - The inverse transpose of local * parent is the local
+//   one times the parent's, so the normal matrix needs no
+//   inverse either
+// --------------------------------------------------------
+bool TransformSystem::UpdateChild(unsigned int index)
+{
+	unsigned int parent = parents[index];
+	if (!dirty[index] && parentVersions[index] == worldMatrixVersions[parent])
+		return false;
+
+	XMFLOAT3X4 local;
+	XMFLOAT3X4 localNormal;
+	BuildMatrices(index, local, localNormal);
+
+	XMStoreFloat3x4(&worldMatrices[index],
+		XMMatrixMultiply(XMLoadFloat3x4(&local), XMLoadFloat3x4(&worldMatrices[parent])));
+	XMStoreFloat3x4(&normalMatrices[index],
+		XMMatrixMultiply(XMLoadFloat3x4(&localNormal), XMLoadFloat3x4(&normalMatrices[parent])));
+
+	parentVersions[index] = worldMatrixVersions[parent];
+	dirty[index] = 0;
+	worldMatrixVersions[index]++;
+	Journal(index);
+	return true;
+}
+
+// --------------------------------------------------------
+// Gives a transform the id its changes are journaled under
+// (noJournalId to leave them out)
+// - A slot already journaled this frame under another id
+//   can be journaled again under the new one
+// --------------------------------------------------------
+void TransformSystem::SetJournalId(unsigned int index, unsigned int id)
+{
+	journalIds[index] = id;
+	journalFrames[index] = noJournalId;
+}
+
+// Starts a new journal, once everything that reads the current one has
+void TransformSystem::NextFrame()
+{
+	lastChangedCount = GetChangedCount();
+	changedCount.store(0, std::memory_order_relaxed);
+
+	// Skips noJournalId, which marks slots never journaled
+	journalFrame = journalFrame + 1 != noJournalId ? journalFrame + 1 : 0;
+}
+
+unsigned int TransformSystem::GetChangedCount()
+{
+	unsigned int count = changedCount.load(std::memory_order_relaxed);
+	return count < changedIds.size() ? count : (unsigned int)changedIds.size();
+}
+
+bool TransformSystem::JournalOverflowed()
+{
+	return changedCount.load(std::memory_order_relaxed) > changedIds.size();
+}
+
+// --------------------------------------------------------
+// Adds a transform whose world matrix was just rebuilt to
+// the journal, if it has an id and isn't listed yet
+// - A slot is only ever rebuilt by one thread at a time, so
+//   its frame stamp needs no atomics; the shared count does
+// - Only ids that changed after a slot was reused can run
+//   past the room for every slot once, and those are counted
+//   but not listed, which JournalOverflowed() reports
+// --------------------------------------------------------
+void TransformSystem::Journal(unsigned int index)
+{
+	if (journalIds[index] == noJournalId || journalFrames[index] == journalFrame)
+		return;
+
+	journalFrames[index] = journalFrame;
+	unsigned int position = changedCount.fetch_add(1, std::memory_order_relaxed);
+	if (position < changedIds.size())
+		changedIds[position] = journalIds[index];
+}
+
+// Lists every child by its depth below its root, so parents always come before their children
+void TransformSystem::SortHierarchy()
+{
+	std::vector<unsigned int> children;
+	std::vector<unsigned int> depths;
+	unsigned int deepest = 0;
+	for (unsigned int i = 0; i < parents.size(); i++)
+	{
+		if (parents[i] == noParent)
+			continue;
+
+		unsigned int depth = 0;
+		for (unsigned int above = i; parents[above] != noParent; above = parents[above])
+			depth++;
+
+		children.push_back(i);
+		depths.push_back(depth);
+		deepest = depth > deepest ? depth : deepest;
+	}
+
+	// Counting sort: where each depth starts, then each child into its depth's place
+	std::vector<unsigned int> starts(deepest + 2, 0);
+	for (unsigned int c = 0; c < children.size(); c++)
+		starts[depths[c] + 1]++;
+	for (unsigned int d = 1; d < starts.size(); d++)
+		starts[d] += starts[d - 1];
+
+	hierarchyOrder.resize(children.size());
+	for (unsigned int c = 0; c < children.size(); c++)
+		hierarchyOrder[starts[depths[c]]++] = children[c];
+
+	hierarchyChanged = false;
+}
+
+// --------------------------------------------------------
+// World and normal matrices of one transform
+// - World is scale * rotation * translation, which is just
+//   the rotation rows scaled, over the position
+// - The normal matrix (world's inverse transpose) needs no
+//   general inverse: rotation's inverse is its transpose
+//   and scale's is 1 / scale, so it's the rotation rows
+//   divided by their scale, for any scale, uniform or not
+// - Both are stored transposed (see worldMatrices), so each
+//   row here is a column of the usual 4x4 matrix
+// - Does exactly the operations of a BuildMatrices4() lane
+// - For a child these are its local matrices
+// --------------------------------------------------------
+void TransformSystem::BuildMatrices(unsigned int i, XMFLOAT3X4& world, XMFLOAT3X4& normal)
+{
+	XMFLOAT3 right, up, forward;
+	GetAxes(i, right, up, forward);
+
+	float inverseScaleX = 1.0f / scaleX[i];
+	float inverseScaleY = 1.0f / scaleY[i];
+	float inverseScaleZ = 1.0f / scaleZ[i];
+
+	world = XMFLOAT3X4(
+		scaleX[i] * right.x, scaleY[i] * up.x, scaleZ[i] * forward.x, positionX[i],
+		scaleX[i] * right.y, scaleY[i] * up.y, scaleZ[i] * forward.y, positionY[i],
+		scaleX[i] * right.z, scaleY[i] * up.z, scaleZ[i] * forward.z, positionZ[i]);
+
+	normal = XMFLOAT3X4(
+		right.x * inverseScaleX, up.x * inverseScaleY, forward.x * inverseScaleZ, 0.0f,
+		right.y * inverseScaleX, up.y * inverseScaleY, forward.y * inverseScaleZ, 0.0f,
+		right.z * inverseScaleX, up.z * inverseScaleY, forward.z * inverseScaleZ, 0.0f);
+}
+
+// BuildMatrices() for transforms [first, first + 4), one per SSE lane, storing only lanes in the mask
+void TransformSystem::BuildMatrices4(unsigned int first, unsigned int mask)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	__m128 px = _mm_loadu_ps(&positionX[first]);
+	__m128 py = _mm_loadu_ps(&positionY[first]);
+	__m128 pz = _mm_loadu_ps(&positionZ[first]);
+	__m128 sx = _mm_loadu_ps(&scaleX[first]);
+	__m128 sy = _mm_loadu_ps(&scaleY[first]);
+	__m128 sz = _mm_loadu_ps(&scaleZ[first]);
+	__m128 qx = _mm_loadu_ps(&rotationX[first]);
+	__m128 qy = _mm_loadu_ps(&rotationY[first]);
+	__m128 qz = _mm_loadu_ps(&rotationZ[first]);
+	__m128 qw = _mm_loadu_ps(&rotationW[first]);
+
+	// The rotation's axes, as in GetAxes()
+	__m128 x2 = _mm_add_ps(qx, qx);
+	__m128 y2 = _mm_add_ps(qy, qy);
+	__m128 z2 = _mm_add_ps(qz, qz);
+	__m128 xx = _mm_mul_ps(qx, x2);
+	__m128 yy = _mm_mul_ps(qy, y2);
+	__m128 zz = _mm_mul_ps(qz, z2);
+	__m128 xy = _mm_mul_ps(qx, y2);
+	__m128 xz = _mm_mul_ps(qx, z2);
+	__m128 yz = _mm_mul_ps(qy, z2);
+	__m128 wx = _mm_mul_ps(qw, x2);
+	__m128 wy = _mm_mul_ps(qw, y2);
+	__m128 wz = _mm_mul_ps(qw, z2);
+
+	__m128 rx = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+	__m128 ry = _mm_add_ps(xy, wz);
+	__m128 rz = _mm_sub_ps(xz, wy);
+	__m128 ux = _mm_sub_ps(xy, wz);
+	__m128 uy = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+	__m128 uz = _mm_add_ps(yz, wx);
+	__m128 fx = _mm_add_ps(xz, wy);
+	__m128 fy = _mm_sub_ps(yz, wx);
+	__m128 fz = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+
+	XMFLOAT3X4* world = &worldMatrices[first];
+	StoreRow(world, 0, _mm_mul_ps(sx, rx), _mm_mul_ps(sy, ux), _mm_mul_ps(sz, fx), px, mask);
+	StoreRow(world, 1, _mm_mul_ps(sx, ry), _mm_mul_ps(sy, uy), _mm_mul_ps(sz, fy), py, mask);
+	StoreRow(world, 2, _mm_mul_ps(sx, rz), _mm_mul_ps(sy, uz), _mm_mul_ps(sz, fz), pz, mask);
+
+	// A real divide, not _mm_rcp_ps, so results match the scalar version
+	__m128 isx = _mm_div_ps(one, sx);
+	__m128 isy = _mm_div_ps(one, sy);
+	__m128 isz = _mm_div_ps(one, sz);
+
+	XMFLOAT3X4* normal = &normalMatrices[first];
+	StoreRow(normal, 0, _mm_mul_ps(rx, isx), _mm_mul_ps(ux, isy), _mm_mul_ps(fx, isz), zero, mask);
+	StoreRow(normal, 1, _mm_mul_ps(ry, isx), _mm_mul_ps(uy, isy), _mm_mul_ps(fy, isz), zero, mask);
+	StoreRow(normal, 2, _mm_mul_ps(rz, isx), _mm_mul_ps(uz, isy), _mm_mul_ps(fz, isz), zero, mask);
+}
+
+// --------------------------------------------------------
+// Times a full rebuild of transformCount random transforms
+// with each version, on a system of its own, then moving
+// and rotating each of them
+// --------------------------------------------------------
+TransformSystem::BenchmarkResult TransformSystem::Benchmark(int transformCount, int iterations)
+{
+	BenchmarkResult result = {};
+	result.transformCount = transformCount;
+	result.threadCount = ResolveThreadCount(0, transformCount, minimumTransformsPerThread);
+	if (transformCount <= 0)
+		return result;
+
+	TransformSystem system;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> positions(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> scales(0.1f, 10.0f);
+	std::uniform_real_distribution<float> angles(-XM_PI, XM_PI);
+	for (int i = 0; i < transformCount; i++)
+	{
+		XMFLOAT3 position(positions(random), positions(random), positions(random));
+		XMFLOAT3 scale(scales(random), scales(random), scales(random));
+		XMFLOAT4 rotation;
+		XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(angles(random), angles(random), angles(random)));
+		system.Create(position, scale, rotation);
+	}
+
+	std::vector<XMFLOAT3X4> scalarWorld;
+	std::vector<XMFLOAT3X4> scalarNormal;
+	double* times[] = { &result.scalarMilliseconds, &result.simdMilliseconds, &result.threadedMilliseconds };
+
+	for (int version = 0; version < 3; version++)
+	{
+		double fastest = DBL_MAX;
+		for (int i = 0; i < iterations; i++)
+		{
+			memset(&system.dirty[0], 1, transformCount);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			switch (version)
+			{
+				case 0: system.UpdateWorldMatricesScalar(); break;
+				case 1: system.UpdateWorldMatrices(1); break;
+				case 2: system.UpdateWorldMatrices(result.threadCount); break;
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+
+			double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+			if (ms < fastest)
+				fastest = ms;
+		}
+		*times[version] = iterations > 0 ? fastest : 0.0;
+
+		if (version == 0)
+		{
+			scalarWorld = system.worldMatrices;
+			scalarNormal = system.normalMatrices;
+			continue;
+		}
+
+		for (int i = 0; i < transformCount && iterations > 0; i++)
+		{
+			// Relative to the matrix's largest element (once that's over 1), since translations can be large
+			const XMFLOAT3X4* scalarMatrices[] = { &scalarWorld[i], &scalarNormal[i] };
+			const XMFLOAT3X4* matrices[] = { &system.worldMatrices[i], &system.normalMatrices[i] };
+			for (int m = 0; m < 2; m++)
+			{
+				float largest = 1.0f;
+				float difference = 0.0f;
+				for (int e = 0; e < 12; e++)
+				{
+					float a = scalarMatrices[m]->m[e / 4][e % 4];
+					float b = matrices[m]->m[e / 4][e % 4];
+					largest = fabsf(a) > largest ? fabsf(a) : largest;
+					difference = fabsf(a - b) > difference ? fabsf(a - b) : difference;
+				}
+				result.maxDifference = difference / largest > result.maxDifference ? difference / largest : result.maxDifference;
+			}
+		}
+	}
+
+	// Moving and turning every transform once, which only touches its position or rotation
+	XMFLOAT3 move(0.01f, 0.02f, 0.03f);
+	XMVECTOR turn = XMQuaternionRotationRollPitchYaw(0.01f, 0.02f, 0.03f);
+	double* operationTimes[] = { &result.moveMilliseconds, &result.rotateMilliseconds };
+	for (int operation = 0; operation < 2; operation++)
+	{
+		double fastest = DBL_MAX;
+		for (int i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			if (operation == 0)
+			{
+				for (int t = 0; t < transformCount; t++)
+					system.MoveRelative(t, move);
+			}
+			else
+			{
+				for (int t = 0; t < transformCount; t++)
+					system.Rotate(t, turn);
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+
+			double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+			if (ms < fastest)
+				fastest = ms;
+		}
+		*operationTimes[operation] = iterations > 0 ? fastest : 0.0;
+	}
+
+	return result;
+}
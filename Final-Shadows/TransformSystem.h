@@ -0,0 +1,156 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <atomic>
+#include <vector>
+
+// --------------------------------------------------------
+// Storage for every Transform, kept as structure-of-arrays
+//
+// - Each Transform is an index into these arrays, so
+//   positions, rotations and scales of all transforms sit
+//   next to each other in memory
+// - Rotations are unit quaternions; the rotation's axes are
+//   worked out from them where needed, and Euler angles only
+//   for the editor
+// - Changes only mark a transform dirty; UpdateWorldMatrices()
+//   then rebuilds every dirty world and normal matrix in one
+//   pass, four transforms at a time in SSE registers, with
+//   large counts split across threads
+// - Both are kept as 3x4 affine matrices, laid out the way a
+//   row_major float3x4 is in HLSL, so they upload as is
+// - A matrix read before that pass is rebuilt on its own,
+//   with the same operations a SIMD lane does, so results
+//   don't depend on which path made them
+// - A transform can have a parent, making its values local
+//   to the parent's: children are then visited parents first
+//   and get local * parent's world, redone only when they or
+//   something above them changed
+// - Every rebuilt matrix with a journal id adds that id to
+//   the frame's change journal, so other systems can visit
+//   just what moved instead of checking everything
+// - Only used from the render thread (the pass's workers
+//   each write their own range of transforms, and append to
+//   the journal without locks)
+// --------------------------------------------------------
+class TransformSystem
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static TransformSystem& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new TransformSystem();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	TransformSystem(TransformSystem const&) = delete;
+	void operator=(TransformSystem const&) = delete;
+
+private:
+	static TransformSystem* instance;
+	TransformSystem();
+#pragma endregion
+
+public:
+	struct BenchmarkResult
+	{
+		int transformCount;
+		unsigned int threadCount;		// Threads used by the multithreaded run
+		double scalarMilliseconds;		// Fastest time of each version
+		double simdMilliseconds;		// SSE on the calling thread only
+		double threadedMilliseconds;	// SSE on threadCount threads
+		float maxDifference;			// Largest matrix element difference to the scalar version, relative to the matrix's size
+		double moveMilliseconds;		// MoveRelative() on every transform
+		double rotateMilliseconds;		// Rotate() on every transform
+	};
+
+	unsigned int Create(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale, DirectX::XMFLOAT4 rotationQuat);
+	void Destroy(unsigned int index);
+	void Copy(unsigned int from, unsigned int to);
+
+	void SetRotation(unsigned int index, DirectX::XMVECTOR rotationQuat);
+	DirectX::XMVECTOR GetRotation(unsigned int index);
+	void GetAxes(unsigned int index, DirectX::XMFLOAT3& right, DirectX::XMFLOAT3& up, DirectX::XMFLOAT3& forward);
+	void MoveRelative(unsigned int index, DirectX::XMFLOAT3 move);
+	void Rotate(unsigned int index, DirectX::XMVECTOR rotationQuat);
+
+	// noParent detaches; false (and no change) if it would make a loop
+	bool SetParent(unsigned int index, unsigned int parent, bool keepWorldTransform);
+	unsigned int GetParent(unsigned int index) { return parents[index]; }
+	static constexpr unsigned int noParent = 0xFFFFFFFF;
+
+	// threadCount 0 means one per hardware thread (few dirty transforms always use one)
+	void UpdateWorldMatrices(unsigned int threadCount = 0);
+	void UpdateWorldMatricesScalar();
+	void UpdateWorldMatrix(unsigned int index);
+
+	unsigned int GetCount() { return (unsigned int)(dirty.size() - freeSlots.size()); }
+	unsigned int GetLastUpdateCount() { return lastUpdateCount; }
+
+	// Change journal: the ids (entity indices, say) of transforms whose world matrix changed
+	// since NextFrame(), each listed once
+	static constexpr unsigned int noJournalId = 0xFFFFFFFF;
+	void SetJournalId(unsigned int index, unsigned int id);
+	void NextFrame();
+	unsigned int GetChangedCount();
+	const unsigned int* GetChangedIds() { return changedIds.data(); }
+	bool JournalOverflowed();	// Some changes weren't listed, so readers should check everything
+	unsigned int GetLastChangedCount() { return lastChangedCount; }
+
+	static BenchmarkResult Benchmark(int transformCount, int iterations);
+
+private:
+	friend class Transform;
+
+	void StoreLocal(unsigned int index, DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale, DirectX::XMFLOAT4 rotationQuat);
+	void BuildMatrices(unsigned int index, DirectX::XMFLOAT3X4& world, DirectX::XMFLOAT3X4& normal);
+	void BuildMatrices4(unsigned int first, unsigned int dirtyMask);
+	unsigned int UpdateRange(unsigned int first, unsigned int end);
+	unsigned int UpdateHierarchy();
+	bool UpdateChild(unsigned int index);
+	void SortHierarchy();
+	void Journal(unsigned int index);
+
+	// Local position, scale and rotation (as a unit quaternion)
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+
+	// One row per output coordinate, the (0, 0, 0, 1) row left off
+	// - XMLoadFloat3x4() turns them back into XMMATRIX's layout
+	// - Normal matrices are the world ones' inverse transpose, with
+	//   no translation (normals don't move)
+	std::vector<DirectX::XMFLOAT3X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT3X4> normalMatrices;
+	std::vector<unsigned int> worldMatrixVersions;	// Counts rebuilds of each world matrix, so dependent data knows when it's stale
+
+	// Only the editor and mouse look use these, so they're made on
+	// request, or kept when the rotation was set from them
+	std::vector<DirectX::XMFLOAT3> pitchYawRolls;
+	std::vector<unsigned char> rotationChanged;	// 1 when pitchYawRolls is out of date
+
+	// Hierarchy, with children listed parents first in hierarchyOrder
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> childCounts;
+	std::vector<unsigned int> parentVersions;	// Parent's world matrix version each child's was built from
+	std::vector<unsigned int> hierarchyOrder;
+	bool hierarchyChanged;					// hierarchyOrder needs sorting again
+
+	// Change journal, with room for every slot once
+	std::vector<unsigned int> journalIds;
+	std::vector<unsigned int> journalFrames;	// Frame each slot was last journaled in
+	std::vector<unsigned int> changedIds;
+	std::atomic<unsigned int> changedCount;
+	unsigned int journalFrame;
+	unsigned int lastChangedCount;			// Ids journaled in the frame before this one
+
+	std::vector<unsigned char> dirty;		// 1 when the world matrix is out of date, always 0 for free slots
+	std::vector<unsigned int> freeSlots;
+	unsigned int lastUpdateCount;			// Matrices the last UpdateWorldMatrices() rebuilt
+};
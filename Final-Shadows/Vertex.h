@@ -13,4 +13,34 @@ struct Vertex
 	DirectX::XMFLOAT3 normal;
 	DirectX::XMFLOAT3 tangent;
 	DirectX::XMFLOAT2 uv;
-};
\ No newline at end of file
+};
+
+// --------------------------------------------------------
+// A quantized version of Vertex, 20 bytes instead of 44
+//
+// - Made from a Vertex by VertexCompression, and decoded in
+//   the "Compact" vertex shaders using the mesh's bounds
+// - Must match CompactVertexShaderInput in ShaderIncludes.hlsli,
+//   its input layout is described by VertexFormat<CompactVertex>
+// --------------------------------------------------------
+struct CompactVertex
+{
+	unsigned short position[4];	    // UNORM16 within the mesh bounds, w is unused padding
+	short normal[2];				// Octahedral encoding, SNORM16
+	short tangent[2];				// Octahedral encoding, SNORM16
+	unsigned short uv[2];			// UNORM16 within the mesh's uv bounds
+};
+
+// --------------------------------------------------------
+// Position-only streams, made from the vertices above when
+// a mesh is uploaded and drawn by Mesh::DrawDepth()
+// --------------------------------------------------------
+struct PositionVertex
+{
+	DirectX::XMFLOAT3 position;
+};
+
+struct CompactPositionVertex
+{
+	unsigned short position[4];	    // Same encoding as CompactVertex::position
+};
@@ -0,0 +1,182 @@
+#include <cmath>
+#include "VertexCompression.h"
+
+using namespace DirectX;
+
+namespace
+{
+	unsigned short EncodeUnorm16(float value)
+	{
+		value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+		return (unsigned short)(value * 65535.0f + 0.5f);
+	}
+
+	float DecodeUnorm16(unsigned short value)
+	{
+		return value / 65535.0f;
+	}
+
+	short EncodeSnorm16(float value)
+	{
+		value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+		return (short)floorf(value * 32767.0f + 0.5f);
+	}
+
+	float DecodeSnorm16(short value)
+	{
+		// Same as the GPU: both -32768 and -32767 are -1
+		float decoded = value / 32767.0f;
+		return decoded < -1.0f ? -1.0f : decoded;
+	}
+
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// Projects a direction onto an octahedron and unfolds it into a square
+	void EncodeOctahedral(const XMFLOAT3& direction, short encoded[2])
+	{
+		float length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+		if (length == 0.0f)
+		{
+			encoded[0] = 0;
+			encoded[1] = 0;
+			return;
+		}
+
+		float x = direction.x / length;
+		float y = direction.y / length;
+
+		// Fold the lower half over the diagonals
+		if (direction.z < 0.0f)
+		{
+			float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+			float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		encoded[0] = EncodeSnorm16(x);
+		encoded[1] = EncodeSnorm16(y);
+	}
+
+	// Must match DecodeOctahedral() in ShaderIncludes.hlsli
+	XMFLOAT3 DecodeOctahedral(const short encoded[2])
+	{
+		XMFLOAT3 direction;
+		direction.x = DecodeSnorm16(encoded[0]);
+		direction.y = DecodeSnorm16(encoded[1]);
+		direction.z = 1.0f - fabsf(direction.x) - fabsf(direction.y);
+
+		float fold = direction.z < 0.0f ? -direction.z : 0.0f;
+		direction.x += direction.x >= 0.0f ? -fold : fold;
+		direction.y += direction.y >= 0.0f ? -fold : fold;
+
+		XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+		return direction;
+	}
+
+	float AngleBetween(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR va = XMLoadFloat3(&a);
+		if (XMVectorGetX(XMVector3LengthSq(va)) == 0.0f)
+			return 0.0f;
+
+		float cosAngle = XMVectorGetX(XMVector3Dot(XMVector3Normalize(va), XMVector3Normalize(XMLoadFloat3(&b))));
+		cosAngle = cosAngle > 1.0f ? 1.0f : (cosAngle < -1.0f ? -1.0f : cosAngle);
+		return acosf(cosAngle) * 180.0f / XM_PI;
+	}
+}
+
+VertexCompression::DecodeParams VertexCompression::ComputeDecodeParams(const Vertex* verts, int vertexCount)
+{
+	DecodeParams params = {};
+	if (vertexCount == 0)
+		return params;
+
+	XMFLOAT3 minPos = verts[0].position, maxPos = verts[0].position;
+	XMFLOAT2 minUv = verts[0].uv, maxUv = verts[0].uv;
+	for (int i = 1; i < vertexCount; i++)
+	{
+		const Vertex& v = verts[i];
+		minPos.x = v.position.x < minPos.x ? v.position.x : minPos.x;
+		minPos.y = v.position.y < minPos.y ? v.position.y : minPos.y;
+		minPos.z = v.position.z < minPos.z ? v.position.z : minPos.z;
+		maxPos.x = v.position.x > maxPos.x ? v.position.x : maxPos.x;
+		maxPos.y = v.position.y > maxPos.y ? v.position.y : maxPos.y;
+		maxPos.z = v.position.z > maxPos.z ? v.position.z : maxPos.z;
+		minUv.x = v.uv.x < minUv.x ? v.uv.x : minUv.x;
+		minUv.y = v.uv.y < minUv.y ? v.uv.y : minUv.y;
+		maxUv.x = v.uv.x > maxUv.x ? v.uv.x : maxUv.x;
+		maxUv.y = v.uv.y > maxUv.y ? v.uv.y : maxUv.y;
+	}
+
+	params.positionOffset = minPos;
+	params.positionScale = XMFLOAT3(maxPos.x - minPos.x, maxPos.y - minPos.y, maxPos.z - minPos.z);
+	params.uvOffset = minUv;
+	params.uvScale = XMFLOAT2(maxUv.x - minUv.x, maxUv.y - minUv.y);
+	return params;
+}
+
+CompactVertex VertexCompression::Encode(const Vertex& vertex, const DecodeParams& params)
+{
+	// A zero scale means every vertex has the same value on that axis, so store 0
+	const DecodeParams& p = params;
+	CompactVertex compact = {};
+	compact.position[0] = EncodeUnorm16(p.positionScale.x > 0.0f ? (vertex.position.x - p.positionOffset.x) / p.positionScale.x : 0.0f);
+	compact.position[1] = EncodeUnorm16(p.positionScale.y > 0.0f ? (vertex.position.y - p.positionOffset.y) / p.positionScale.y : 0.0f);
+	compact.position[2] = EncodeUnorm16(p.positionScale.z > 0.0f ? (vertex.position.z - p.positionOffset.z) / p.positionScale.z : 0.0f);
+	compact.uv[0] = EncodeUnorm16(p.uvScale.x > 0.0f ? (vertex.uv.x - p.uvOffset.x) / p.uvScale.x : 0.0f);
+	compact.uv[1] = EncodeUnorm16(p.uvScale.y > 0.0f ? (vertex.uv.y - p.uvOffset.y) / p.uvScale.y : 0.0f);
+	EncodeOctahedral(vertex.normal, compact.normal);
+	EncodeOctahedral(vertex.tangent, compact.tangent);
+	return compact;
+}
+
+// Must match DecodeCompactVertex() in ShaderIncludes.hlsli
+Vertex VertexCompression::Decode(const CompactVertex& compact, const DecodeParams& params)
+{
+	const DecodeParams& p = params;
+	Vertex vertex = {};
+	vertex.position.x = p.positionOffset.x + DecodeUnorm16(compact.position[0]) * p.positionScale.x;
+	vertex.position.y = p.positionOffset.y + DecodeUnorm16(compact.position[1]) * p.positionScale.y;
+	vertex.position.z = p.positionOffset.z + DecodeUnorm16(compact.position[2]) * p.positionScale.z;
+	vertex.uv.x = p.uvOffset.x + DecodeUnorm16(compact.uv[0]) * p.uvScale.x;
+	vertex.uv.y = p.uvOffset.y + DecodeUnorm16(compact.uv[1]) * p.uvScale.y;
+	vertex.normal = DecodeOctahedral(compact.normal);
+	vertex.tangent = DecodeOctahedral(compact.tangent);
+	return vertex;
+}
+
+void VertexCompression::EncodeVertices(const Vertex* verts, int vertexCount, const DecodeParams& params, std::vector<CompactVertex>& compact)
+{
+	compact.resize(vertexCount);
+	for (int i = 0; i < vertexCount; i++)
+		compact[i] = Encode(verts[i], params);
+}
+
+// --------------------------------------------------------
+// Decodes every compact vertex again and compares it with
+// the original, to check the quantization on real meshes
+// --------------------------------------------------------
+VertexCompression::ErrorStats VertexCompression::MeasureError(const Vertex* verts, const CompactVertex* compact, int vertexCount, const DecodeParams& params)
+{
+	ErrorStats stats = {};
+	for (int i = 0; i < vertexCount; i++)
+	{
+		Vertex decoded = Decode(compact[i], params);
+		const Vertex& original = verts[i];
+
+		float positionError = fabsf(decoded.position.x - original.position.x);
+		positionError = fmaxf(positionError, fabsf(decoded.position.y - original.position.y));
+		positionError = fmaxf(positionError, fabsf(decoded.position.z - original.position.z));
+		float uvError = fmaxf(fabsf(decoded.uv.x - original.uv.x), fabsf(decoded.uv.y - original.uv.y));
+
+		stats.maxPositionError = fmaxf(stats.maxPositionError, positionError);
+		stats.maxUvError = fmaxf(stats.maxUvError, uvError);
+		stats.maxNormalError = fmaxf(stats.maxNormalError, AngleBetween(original.normal, decoded.normal));
+		stats.maxTangentError = fmaxf(stats.maxTangentError, AngleBetween(original.tangent, decoded.tangent));
+	}
+	return stats;
+}
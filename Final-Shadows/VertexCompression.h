@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Converts full Vertex data to and from CompactVertex
+//
+// - Positions and uvs are stored relative to the mesh's own
+//   bounds, so the shader needs that mesh's DecodeParams
+// - Normals and tangents use an octahedral encoding, which
+//   keeps their precision even in all directions
+// --------------------------------------------------------
+namespace VertexCompression
+{
+	// Decoded value = offset + stored value (0 - 1) * scale
+	struct DecodeParams
+	{
+		DirectX::XMFLOAT3 positionOffset;
+		DirectX::XMFLOAT3 positionScale;
+		DirectX::XMFLOAT2 uvOffset;
+		DirectX::XMFLOAT2 uvScale;
+	};
+
+	// Largest difference between original and decoded vertices
+	// - Position and uv errors are at most half a quantization
+	//   step, so (mesh size / 65535) / 2 along each axis
+	// - Normal and tangent errors are angles in degrees
+	struct ErrorStats
+	{
+		float maxPositionError;
+		float maxNormalError;
+		float maxTangentError;
+		float maxUvError;
+	};
+
+	DecodeParams ComputeDecodeParams(const Vertex* verts, int vertexCount);
+
+	CompactVertex Encode(const Vertex& vertex, const DecodeParams& params);
+	Vertex Decode(const CompactVertex& vertex, const DecodeParams& params);
+
+	void EncodeVertices(const Vertex* verts, int vertexCount, const DecodeParams& params, std::vector<CompactVertex>& compact);
+	ErrorStats MeasureError(const Vertex* verts, const CompactVertex* compact, int vertexCount, const DecodeParams& params);
+}
@@ -0,0 +1,109 @@
+#include "VertexFormat.h"
+#include "Helpers.h"
+
+#pragma comment(lib, "d3dcompiler.lib")
+#include <d3dcompiler.h>
+#include <cstdio>
+#include <cstring>
+
+// Storage for the in-class constexpr arrays, which are passed around by pointer
+constexpr const char* VertexFormat<Vertex>::name;
+constexpr D3D11_INPUT_ELEMENT_DESC VertexFormat<Vertex>::inputElements[];
+constexpr const char* VertexFormat<CompactVertex>::name;
+constexpr D3D11_INPUT_ELEMENT_DESC VertexFormat<CompactVertex>::inputElements[];
+constexpr const char* VertexFormat<PositionVertex>::name;
+constexpr D3D11_INPUT_ELEMENT_DESC VertexFormat<PositionVertex>::inputElements[];
+constexpr const char* VertexFormat<CompactPositionVertex>::name;
+constexpr D3D11_INPUT_ELEMENT_DESC VertexFormat<CompactPositionVertex>::inputElements[];
+
+namespace
+{
+	void LogFormatError(const std::string& message)
+	{
+		printf("%s", message.c_str());
+		OutputDebugStringA(message.c_str());
+	}
+}
+
+// --------------------------------------------------------
+// Makes an input layout from a format's elements, once the
+// shader's input signature has been checked against them
+// - Every attribute the shader reads must be in the format,
+//   and the format must give it at least as many components
+//   (a shader reading float3 from a float2 would get garbage
+//   defaults, not an error, from Direct3D)
+// - System values like SV_VertexID aren't in vertex buffers,
+//   so they're skipped
+// - Returns an empty layout if the check or creation fails
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11InputLayout> VertexFormats::CreateInputLayout(Microsoft::WRL::ComPtr<ID3D11Device> device,
+	const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int elementCount, const char* formatName, const std::wstring& csoFile)
+{
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+
+	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+	if (FAILED(D3DReadFileToBlob(csoFile.c_str(), shaderBlob.GetAddressOf())))
+	{
+		LogFormatError("Could not read " + WideToNarrow(csoFile) + "\n");
+		return inputLayout;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
+	if (FAILED(D3DReflect(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), IID_ID3D11ShaderReflection, (void**)refl.GetAddressOf())))
+	{
+		LogFormatError("Could not reflect " + WideToNarrow(csoFile) + "\n");
+		return inputLayout;
+	}
+
+	D3D11_SHADER_DESC shaderDesc;
+	refl->GetDesc(&shaderDesc);
+
+	bool matches = true;
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+		if (paramDesc.SystemValueType != D3D_NAME_UNDEFINED)
+			continue;
+
+		// Semantics aren't case sensitive
+		int element = 0;
+		while (element < (int)elementCount &&
+			(_stricmp(elements[element].SemanticName, paramDesc.SemanticName) != 0 || elements[element].SemanticIndex != paramDesc.SemanticIndex))
+			element++;
+
+		if (element == (int)elementCount)
+		{
+			LogFormatError(WideToNarrow(csoFile) + " reads " + paramDesc.SemanticName + std::to_string(paramDesc.SemanticIndex) +
+				", which " + formatName + " doesn't have\n");
+			matches = false;
+			continue;
+		}
+
+		// Highest component in the mask is how many the shader declares
+		unsigned int components = paramDesc.Mask >= 8 ? 4 : (paramDesc.Mask >= 4 ? 3 : (paramDesc.Mask >= 2 ? 2 : 1));
+		if (components > FormatComponents(elements[element].Format))
+		{
+			LogFormatError(WideToNarrow(csoFile) + " reads " + std::to_string(components) + " components of " + paramDesc.SemanticName +
+				", but " + formatName + " only has " + std::to_string(FormatComponents(elements[element].Format)) + "\n");
+			matches = false;
+		}
+	}
+
+	if (!matches)
+		return inputLayout;
+
+	HRESULT hr = device->CreateInputLayout(
+		elements,
+		elementCount,
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize(),
+		inputLayout.GetAddressOf());
+	if (FAILED(hr))
+	{
+		LogFormatError("Could not create the " + std::string(formatName) + " input layout for " + WideToNarrow(csoFile) + "\n");
+		inputLayout.Reset();
+	}
+
+	return inputLayout;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
+#include <cstddef>
+#include <memory>
+#include <string>
+#include "Vertex.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Compile-time descriptions of the vertex formats in Vertex.h
+//
+// - Each VertexFormat<T> lists the input elements of T, with
+//   offsets taken from the struct itself, so an input layout
+//   can't drift from the C++ type it describes
+// - The static_asserts at the bottom check that the elements
+//   cover every byte of their struct, in order
+// - LoadVertexShader<T>() builds the input layout from these
+//   arrays, after checking the shader only reads attributes
+//   the format has (reflection only sees 32-bit types, so it
+//   can't make layouts for the 16-bit formats by itself)
+// --------------------------------------------------------
+template<typename T>
+struct VertexFormat;
+
+template<>
+struct VertexFormat<Vertex>
+{
+	static constexpr const char* name = "Vertex";
+	static constexpr D3D11_INPUT_ELEMENT_DESC inputElements[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(Vertex, position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(Vertex, normal), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(Vertex, tangent), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(Vertex, uv), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+};
+
+template<>
+struct VertexFormat<CompactVertex>
+{
+	static constexpr const char* name = "CompactVertex";
+	static constexpr D3D11_INPUT_ELEMENT_DESC inputElements[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, offsetof(CompactVertex, position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(CompactVertex, normal), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(CompactVertex, tangent), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, offsetof(CompactVertex, uv), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+};
+
+template<>
+struct VertexFormat<PositionVertex>
+{
+	static constexpr const char* name = "PositionVertex";
+	static constexpr D3D11_INPUT_ELEMENT_DESC inputElements[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(PositionVertex, position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+};
+
+template<>
+struct VertexFormat<CompactPositionVertex>
+{
+	static constexpr const char* name = "CompactPositionVertex";
+	static constexpr D3D11_INPUT_ELEMENT_DESC inputElements[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, offsetof(CompactPositionVertex, position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+};
+
+namespace VertexFormats
+{
+	// Bytes taken by one element of a format (only the formats used above)
+	constexpr unsigned int FormatSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+			case DXGI_FORMAT_R32G32B32A32_FLOAT: return 16;
+			case DXGI_FORMAT_R32G32B32_FLOAT: return 12;
+			case DXGI_FORMAT_R32G32_FLOAT: return 8;
+			case DXGI_FORMAT_R16G16B16A16_UNORM: return 8;
+			case DXGI_FORMAT_R16G16_UNORM: return 4;
+			case DXGI_FORMAT_R16G16_SNORM: return 4;
+			default: return 0;
+		}
+	}
+
+	// Values a format gives the shader, any it reads past these are filled in by the input assembler
+	constexpr unsigned int FormatComponents(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+			case DXGI_FORMAT_R32G32B32A32_FLOAT: return 4;
+			case DXGI_FORMAT_R32G32B32_FLOAT: return 3;
+			case DXGI_FORMAT_R32G32_FLOAT: return 2;
+			case DXGI_FORMAT_R16G16B16A16_UNORM: return 4;
+			case DXGI_FORMAT_R16G16_UNORM: return 2;
+			case DXGI_FORMAT_R16G16_SNORM: return 2;
+			default: return 0;
+		}
+	}
+
+	// True when elements sit back to back from offset 0 and end exactly at the end of the vertex
+	template<size_t N>
+	constexpr bool IsTightlyPacked(const D3D11_INPUT_ELEMENT_DESC(&elements)[N], size_t vertexSize)
+	{
+		unsigned int offset = 0;
+		for (size_t i = 0; i < N; i++)
+		{
+			if (elements[i].AlignedByteOffset != offset || FormatSize(elements[i].Format) == 0)
+				return false;
+			offset += FormatSize(elements[i].Format);
+		}
+		return offset == vertexSize;
+	}
+
+	template<typename T>
+	constexpr unsigned int ElementCount()
+	{
+		return sizeof(VertexFormat<T>::inputElements) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> CreateInputLayout(Microsoft::WRL::ComPtr<ID3D11Device> device,
+		const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int elementCount, const char* formatName, const std::wstring& csoFile);
+}
+
+static_assert(VertexFormats::IsTightlyPacked(VertexFormat<Vertex>::inputElements, sizeof(Vertex)), "VertexFormat<Vertex> doesn't match Vertex");
+static_assert(VertexFormats::IsTightlyPacked(VertexFormat<CompactVertex>::inputElements, sizeof(CompactVertex)), "VertexFormat<CompactVertex> doesn't match CompactVertex");
+static_assert(VertexFormats::IsTightlyPacked(VertexFormat<PositionVertex>::inputElements, sizeof(PositionVertex)), "VertexFormat<PositionVertex> doesn't match PositionVertex");
+static_assert(VertexFormats::IsTightlyPacked(VertexFormat<CompactPositionVertex>::inputElements, sizeof(CompactPositionVertex)), "VertexFormat<CompactPositionVertex> doesn't match CompactPositionVertex");
+
+// --------------------------------------------------------
+// Loads a vertex shader that reads vertices of type T
+// - The input layout comes from VertexFormat<T>, so nothing
+//   is guessed from reflection; reflection is only used to
+//   check the shader against the format
+// - Returns null if the layout can't be made, rather than
+//   letting the shader make one by reflection, which would
+//   read the 16-bit formats as 32-bit floats
+// --------------------------------------------------------
+template<typename T>
+std::shared_ptr<SimpleVertexShader> LoadVertexShader(Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const std::wstring& csoFile)
+{
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout = VertexFormats::CreateInputLayout(device,
+		VertexFormat<T>::inputElements, VertexFormats::ElementCount<T>(), VertexFormat<T>::name, csoFile);
+	if (!inputLayout)
+		return 0;
+
+	return std::make_shared<SimpleVertexShader>(device, context, csoFile.c_str(), inputLayout, false);
+}
@@ -2,22 +2,28 @@
 
 cbuffer ExternalData : register(b0)
 {
-	matrix world;
-	matrix worldInvTranspose;
+	// Affine, so their constant last row isn't sent (see TransformSystem)
+	row_major float3x4 world;
+	row_major float3x4 normalMatrix;
 	matrix view;
 	matrix proj;
 	matrix lightViews[MAX_NUM_SHADOW_MAPS];
 	matrix lightProjs[MAX_NUM_SHADOW_MAPS];
+#ifdef COMPACT_VERTEX
+	float3 positionOffset;
+	float3 positionScale;
+	float2 uvOffset;
+	float2 uvScale;
+#endif
 }
 
 // --------------------------------------------------------
-// The entry point (main method) for our vertex shader
+// Transforms one vertex worth of data
 // 
 // - Input is exactly one vertex worth of data (defined by a struct)
 // - Output is a single struct of data to pass down the pipeline
-// - Named "main" because that's the default the shader compiler looks for
 // --------------------------------------------------------
-VertexToPixel main( VertexShaderInput input )
+VertexToPixel TransformVertex( VertexShaderInput input )
 {
 	// Set up output struct
 	VertexToPixel output;
@@ -30,15 +36,16 @@ VertexToPixel main( VertexShaderInput input )
 	// - Each of these components is then automatically divided by the W component, 
 	//   which we're leaving at 1.0 for now (this is more useful when dealing with 
 	//   a perspective projection matrix, which we'll get to in the future).
-	matrix wvp = mul(proj, mul(view, world));
-	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+	// - The world position is found once and reused, rather than
+	//   multiplying whole matrices together for every vertex
+	float4 worldPosition = float4(mul(world, float4(input.localPosition, 1.0f)), 1.0f);
+	output.screenPosition = mul(proj, mul(view, worldPosition));
 	
 	// Do an additional position calculation for each Shadow Map being used
 	// using the view and projection matrices specific to the light casting this shadow
 	for (int i = 0; i < MAX_NUM_SHADOW_MAPS; i++)
 	{
-		matrix lightWvp = mul(lightProjs[i], mul(lightViews[i], world));
-		output.shadowPositions[i] = mul(lightWvp, float4(input.localPosition, 1.0f));
+		output.shadowPositions[i] = mul(lightProjs[i], mul(lightViews[i], worldPosition));
 	}
 
 	// Pass the uv value through 
@@ -46,11 +53,30 @@ VertexToPixel main( VertexShaderInput input )
 	// - We don't need to alter it here, but we do need to send it to the pixel shader
 	output.uv = input.uv;
 
-	output.normal = mul((float3x3)worldInvTranspose, input.normal);
+	output.normal = mul((float3x3)normalMatrix, input.normal);
 	output.tangent = mul((float3x3)world, input.tangent);
-	output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
+	output.worldPosition = worldPosition.xyz;
 
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
 	return output;
-}
\ No newline at end of file
+}
+
+// --------------------------------------------------------
+// The entry point (main method) for our vertex shader
+// 
+// - Named "main" because that's the default the shader compiler looks for
+// - CompactVertexShader.hlsl compiles this file again with COMPACT_VERTEX
+//   defined, for meshes uploaded as CompactVertex data
+// --------------------------------------------------------
+#ifdef COMPACT_VERTEX
+VertexToPixel main( CompactVertexShaderInput input )
+{
+	return TransformVertex(DecodeCompactVertex(input, positionOffset, positionScale, uvOffset, uvScale));
+}
+#else
+VertexToPixel main( VertexShaderInput input )
+{
+	return TransformVertex(input);
+}
+#endif
\ No newline at end of file